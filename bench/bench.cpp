@@ -0,0 +1,1082 @@
+// bench.cpp - Micro-benchmarks for the audio, metadata and playlist hot paths
+//
+// Runs each benchmark for a fixed number of repetitions after a warmup pass and
+// reports the median time per operation. Synthetic inputs are generated from
+// fixed seeds so results are comparable between runs and machines.
+//
+//   harmonic_bench                       # human readable
+//   harmonic_bench --json bench.json     # machine readable, for trend tracking
+//   harmonic_bench --filter fft --tracks 20000
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <lame/lame.h>
+
+#include "fft.h"
+#include "coder_mode.h"
+#include "pcm_utils.h"
+#include "metadata_parser.h"
+#include "text_encoding.h"
+#include "playlist_manager.h"
+#include "config.h"
+#include "logger.h"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+    int repetitions = 5;
+    double min_time_s = 0.1; // Per repetition
+    size_t library_tracks = 100000;
+    size_t corpus_files = 2000;
+    std::string filter;
+    std::string json_path;
+    std::string work_dir;
+};
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations = 0;     // Per repetition
+    double items_per_op = 1.0;   // e.g. samples, files, tracks processed per op
+    std::string item_unit;
+    std::vector<double> ns_per_op; // One entry per repetition
+
+    double median() const
+    {
+        std::vector<double> sorted = ns_per_op;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted.empty() ? 0.0 : sorted[sorted.size() / 2];
+    }
+    double min() const
+    {
+        return ns_per_op.empty() ? 0.0 : *std::min_element(ns_per_op.begin(), ns_per_op.end());
+    }
+    double max() const
+    {
+        return ns_per_op.empty() ? 0.0 : *std::max_element(ns_per_op.begin(), ns_per_op.end());
+    }
+};
+
+class BenchRunner
+{
+public:
+    explicit BenchRunner(const BenchOptions &opts) : opts(opts) {}
+
+    bool selected(const std::string &name) const
+    {
+        return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+    }
+
+    // `op` runs the benchmarked operation `n` times. Iteration count is
+    // calibrated once so a repetition lasts at least min_time_s.
+    void run(const std::string &name, double items_per_op, const std::string &unit,
+             const std::function<void(uint64_t)> &op)
+    {
+        if (!selected(name))
+            return;
+
+        BenchResult result;
+        result.name = name;
+        result.items_per_op = items_per_op;
+        result.item_unit = unit;
+
+        // Warmup + calibration
+        uint64_t n = 1;
+        while (true)
+        {
+            double elapsed = time_once(op, n);
+            if (elapsed >= opts.min_time_s || n >= (1ull << 30))
+                break;
+            double scale = elapsed > 0 ? (opts.min_time_s * 1.2) / elapsed : 10.0;
+            n = static_cast<uint64_t>(std::max(2.0, std::min(scale, 10.0)) * n);
+        }
+        result.iterations = n;
+
+        for (int rep = 0; rep < opts.repetitions; ++rep)
+        {
+            double elapsed = time_once(op, n);
+            result.ns_per_op.push_back(elapsed * 1e9 / n);
+        }
+
+        report(result);
+        results.push_back(result);
+    }
+
+    // For operations that need untimed per-iteration setup (e.g. re-shuffling
+    // before a sort): `op` returns the elapsed seconds of the timed portion.
+    void run_manual(const std::string &name, double items_per_op, const std::string &unit,
+                    const std::function<double()> &op)
+    {
+        if (!selected(name))
+            return;
+
+        BenchResult result;
+        result.name = name;
+        result.items_per_op = items_per_op;
+        result.item_unit = unit;
+        result.iterations = 1;
+
+        op(); // Warmup
+        for (int rep = 0; rep < opts.repetitions; ++rep)
+        {
+            result.ns_per_op.push_back(op() * 1e9);
+        }
+
+        report(result);
+        results.push_back(result);
+    }
+
+    bool write_json(const std::string &path) const
+    {
+        std::ofstream out(path);
+        if (!out.is_open())
+            return false;
+
+        out << std::fixed << std::setprecision(2);
+        out << "{\n  \"version\": 1,\n  \"timestamp\": " << std::time(nullptr) << ",\n";
+        out << "  \"repetitions\": " << opts.repetitions << ",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const BenchResult &r = results[i];
+            double median = r.median();
+            out << "    {\"name\": \"" << r.name << "\", "
+                << "\"iterations\": " << r.iterations << ", "
+                << "\"ns_per_op_median\": " << median << ", "
+                << "\"ns_per_op_min\": " << r.min() << ", "
+                << "\"ns_per_op_max\": " << r.max() << ", "
+                << "\"items_per_op\": " << r.items_per_op << ", "
+                << "\"item_unit\": \"" << r.item_unit << "\", "
+                << "\"items_per_second\": " << (median > 0 ? r.items_per_op * 1e9 / median : 0.0) << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+        return true;
+    }
+
+private:
+    const BenchOptions &opts;
+    std::vector<BenchResult> results;
+
+    static double time_once(const std::function<void(uint64_t)> &op, uint64_t n)
+    {
+        Clock::time_point start = Clock::now();
+        op(n);
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    static void report(const BenchResult &r)
+    {
+        double median = r.median();
+        std::cout << std::left << std::setw(36) << r.name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(14) << median << " ns/op"
+                  << std::setw(16) << std::setprecision(0)
+                  << (median > 0 ? r.items_per_op * 1e9 / median : 0.0) << " " << r.item_unit << "/s"
+                  << "   (min " << std::setprecision(1) << r.min() << ", max " << r.max() << ")"
+                  << std::endl;
+    }
+};
+
+// Prevent the optimizer from discarding benchmark results
+template <typename T>
+static void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic inputs
+// ---------------------------------------------------------------------------
+
+static std::vector<float> make_test_signal(size_t samples, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    std::vector<float> out(samples);
+    for (size_t i = 0; i < samples; ++i)
+    {
+        float t = static_cast<float>(i) / 44100.0f;
+        out[i] = 0.5f * std::sin(2.0f * static_cast<float>(M_PI) * 440.0f * t) +
+                 0.3f * std::sin(2.0f * static_cast<float>(M_PI) * 3000.0f * t) + noise(rng);
+    }
+    return out;
+}
+
+static void put_be32(std::string &out, uint32_t v)
+{
+    out += static_cast<char>((v >> 24) & 0xFF);
+    out += static_cast<char>((v >> 16) & 0xFF);
+    out += static_cast<char>((v >> 8) & 0xFF);
+    out += static_cast<char>(v & 0xFF);
+}
+
+static void put_le32(std::string &out, uint32_t v)
+{
+    out += static_cast<char>(v & 0xFF);
+    out += static_cast<char>((v >> 8) & 0xFF);
+    out += static_cast<char>((v >> 16) & 0xFF);
+    out += static_cast<char>((v >> 24) & 0xFF);
+}
+
+static void put_synchsafe(std::string &out, uint32_t v)
+{
+    out += static_cast<char>((v >> 21) & 0x7F);
+    out += static_cast<char>((v >> 14) & 0x7F);
+    out += static_cast<char>((v >> 7) & 0x7F);
+    out += static_cast<char>(v & 0x7F);
+}
+
+static std::string id3v2_text_frame(const char *id, const std::string &text)
+{
+    std::string frame(id, 4);
+    put_be32(frame, static_cast<uint32_t>(text.size() + 1));
+    frame += std::string(2, '\0'); // Flags
+    frame += '\0';                 // ISO-8859-1
+    frame += text;
+    return frame;
+}
+
+struct SyntheticTags
+{
+    std::string title, artist, album, year, genre, track_number;
+};
+
+static SyntheticTags make_tags(size_t i, std::mt19937 &rng)
+{
+    static const char *genres[] = {"Rock", "Jazz", "Techno", "Ambient", "Hip-Hop", "Classical"};
+    SyntheticTags t;
+    t.artist = "Artist " + std::to_string(rng() % 5000);
+    t.album = "Album " + std::to_string(rng() % 20000);
+    t.title = "Track " + std::to_string(i) + " " + std::to_string(rng());
+    t.year = std::to_string(1960 + rng() % 65);
+    t.genre = genres[rng() % 6];
+    t.track_number = std::to_string(1 + rng() % 14);
+    return t;
+}
+
+// `bytes` of 128 kbps MPEG-1 Layer III frames: real headers, silent payload
+static std::string mpeg_frames(size_t bytes)
+{
+    const size_t frame_length = 417; // 144 * 128000 / 44100
+    std::string body;
+    body.reserve(bytes);
+    while (body.size() + frame_length <= bytes)
+    {
+        body += std::string("\xFF\xFB\x90\x00", 4);
+        body += std::string(frame_length - 4, '\x55');
+    }
+    body.resize(bytes, '\x55');
+    return body;
+}
+
+// Vorbis comment block, shared by FLAC and Ogg
+static std::string vorbis_comments(const SyntheticTags &tags)
+{
+    std::vector<std::string> comments = {"TITLE=" + tags.title, "ARTIST=" + tags.artist,
+                                         "ALBUM=" + tags.album, "DATE=" + tags.year,
+                                         "GENRE=" + tags.genre, "TRACKNUMBER=" + tags.track_number};
+    std::string block;
+    std::string vendor = "harmonic-bench";
+    put_le32(block, static_cast<uint32_t>(vendor.size()));
+    block += vendor;
+    put_le32(block, static_cast<uint32_t>(comments.size()));
+    for (const auto &c : comments)
+    {
+        put_le32(block, static_cast<uint32_t>(c.size()));
+        block += c;
+    }
+    return block;
+}
+
+// One Ogg page holding `payload` as a single packet (no CRC; nothing checks it)
+static std::string ogg_page(uint64_t granule, const std::string &payload, uint8_t flags)
+{
+    std::string page = "OggS";
+    page += '\0';
+    page += static_cast<char>(flags);
+    put_le32(page, static_cast<uint32_t>(granule));
+    put_le32(page, static_cast<uint32_t>(granule >> 32));
+    put_le32(page, 1); // Serial
+    put_le32(page, 0); // Sequence
+    put_le32(page, 0); // CRC
+    size_t segments = payload.size() / 255 + 1;
+    page += static_cast<char>(segments);
+    page += std::string(segments - 1, '\xFF');
+    page += static_cast<char>(payload.size() % 255);
+    page += payload;
+    return page;
+}
+
+static std::string mp4_box(const char *type, const std::string &payload)
+{
+    std::string box;
+    put_be32(box, static_cast<uint32_t>(payload.size() + 8));
+    box.append(type, 4);
+    box += payload;
+    return box;
+}
+
+static std::string mp4_item(const char *type, const std::string &text)
+{
+    std::string data;
+    put_be32(data, 1); // UTF-8
+    put_be32(data, 0); // Locale
+    return mp4_box(type, mp4_box("data", data + text));
+}
+
+// Writes one file in one of the formats MetadataParser understands,
+// with `body_bytes` standing in for audio data.
+static void write_synthetic_track(const fs::path &path, size_t i, size_t body_bytes, std::mt19937 &rng)
+{
+    SyntheticTags tags = make_tags(i, rng);
+    std::string data;
+    std::string ext;
+
+    switch (i % 6)
+    {
+    case 0: // ID3v2.3 MP3
+    case 1:
+    {
+        std::string frames = id3v2_text_frame("TIT2", tags.title) + id3v2_text_frame("TPE1", tags.artist) +
+                             id3v2_text_frame("TALB", tags.album) + id3v2_text_frame("TYER", tags.year) +
+                             id3v2_text_frame("TCON", tags.genre) + id3v2_text_frame("TRCK", tags.track_number);
+        frames += std::string(256, '\0'); // Padding
+        data = "ID3";
+        data += static_cast<char>(3);
+        data += static_cast<char>(0);
+        data += static_cast<char>(0);
+        put_synchsafe(data, static_cast<uint32_t>(frames.size()));
+        data += frames;
+        data += mpeg_frames(body_bytes);
+        ext = ".mp3";
+        break;
+    }
+    case 2: // FLAC with VORBIS_COMMENT
+    {
+        std::string block = vorbis_comments(tags);
+
+        data = "fLaC";
+        data += static_cast<char>(0x00); // STREAMINFO, not last
+        data += std::string("\x00\x00\x22", 3);
+        std::string streaminfo(34, '\0');
+        const uint64_t samples = body_bytes / 4; // 16-bit stereo, uncompressed
+        streaminfo[10] = '\x0A';                 // 44100 Hz, 2 channels, 16 bits
+        streaminfo[11] = '\xC4';
+        streaminfo[12] = '\x42';
+        streaminfo[13] = static_cast<char>(0xF0 | ((samples >> 32) & 0x0F));
+        for (int b = 0; b < 4; ++b)
+            streaminfo[14 + b] = static_cast<char>((samples >> (24 - 8 * b)) & 0xFF);
+        data += streaminfo;
+        data += static_cast<char>(0x84); // VORBIS_COMMENT, last
+        data += static_cast<char>((block.size() >> 16) & 0xFF);
+        data += static_cast<char>((block.size() >> 8) & 0xFF);
+        data += static_cast<char>(block.size() & 0xFF);
+        data += block;
+        data += std::string(body_bytes, '\x55');
+        ext = ".flac";
+        break;
+    }
+    case 3: // Ogg Vorbis
+    {
+        std::string id = "\x01vorbis";
+        put_le32(id, 0);         // Version
+        id += '\x02';            // Channels
+        put_le32(id, 44100);     // Sample rate
+        id += std::string(14, '\0');
+        id += '\x01';            // Framing
+        data = ogg_page(0, id, 0x02);
+        data += ogg_page(0, "\x03vorbis" + vorbis_comments(tags) + '\x01', 0);
+
+        // Audio pages of up to 16 segments, granules at 128 kbps
+        const size_t page_bytes = 16 * 255;
+        for (size_t done = 0; done < body_bytes; done += page_bytes)
+        {
+            size_t n = std::min(page_bytes, body_bytes - done);
+            uint64_t granule = static_cast<uint64_t>(done + n) * 44100 / 16000;
+            data += ogg_page(granule, std::string(n, '\x55'), done + n >= body_bytes ? 0x04 : 0);
+        }
+        ext = ".ogg";
+        break;
+    }
+    case 4: // MP4 with the moov box after the media data
+    {
+        std::string mvhd(4, '\0'); // Version 0
+        put_be32(mvhd, 0);          // Created
+        put_be32(mvhd, 0);          // Modified
+        put_be32(mvhd, 1000);       // Timescale
+        put_be32(mvhd, static_cast<uint32_t>(body_bytes / 16)); // 128 kbps
+        mvhd += std::string(80, '\0');
+
+        std::string hdlr(8, '\0');
+        hdlr += "mdirappl";
+        hdlr += std::string(9, '\0');
+        std::string ilst = mp4_item("\xA9" "nam", tags.title) + mp4_item("\xA9" "ART", tags.artist) +
+                           mp4_item("\xA9" "alb", tags.album) + mp4_item("\xA9" "day", tags.year) +
+                           mp4_item("\xA9" "gen", tags.genre);
+        std::string trkn = mp4_box("data", std::string(16, '\0')); // Type, locale; reserved, number, total
+        trkn[19] = static_cast<char>(std::stoi(tags.track_number));
+        ilst += mp4_box("trkn", trkn);
+        std::string meta = std::string(4, '\0') + mp4_box("hdlr", hdlr) + mp4_box("ilst", ilst);
+
+        data = mp4_box("ftyp", std::string("M4A ") + std::string(4, '\0'));
+        data += mp4_box("mdat", std::string(body_bytes, '\x55'));
+        data += mp4_box("moov", mp4_box("mvhd", mvhd) + mp4_box("udta", mp4_box("meta", meta)));
+        ext = ".m4a";
+        break;
+    }
+    default: // ID3v1 trailer
+    {
+        auto field = [](const std::string &s, size_t width)
+        {
+            std::string f = s.substr(0, width);
+            f.resize(width, '\0');
+            return f;
+        };
+        data = mpeg_frames(body_bytes);
+        data += "TAG" + field(tags.title, 30) + field(tags.artist, 30) + field(tags.album, 30) +
+                field(tags.year, 4) + field("", 30);
+        data += static_cast<char>(rng() % 27);
+        ext = ".mp3";
+        break;
+    }
+    }
+
+    std::ofstream out(path.string() + ext, std::ios::binary);
+    out.write(data.data(), data.size());
+}
+
+static void generate_corpus(const fs::path &dir, size_t count, size_t body_bytes, uint32_t seed)
+{
+    fs::create_directories(dir);
+    std::mt19937 rng(seed);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Spread files over subdirectories like an artist/album layout
+        fs::path sub = dir / ("d" + std::to_string(i / 500));
+        if (i % 500 == 0)
+            fs::create_directories(sub);
+        write_synthetic_track(sub / ("t" + std::to_string(i)), i, body_bytes, rng);
+    }
+}
+
+static std::vector<std::string> list_files(const fs::path &dir)
+{
+    std::vector<std::string> files;
+    for (const auto &entry : fs::recursive_directory_iterator(dir))
+    {
+        if (entry.is_regular_file())
+            files.push_back(entry.path().string());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// UTF-8 to UTF-16 code units, for writing test tags
+static std::u16string to_utf16(const std::string &utf8)
+{
+    std::u16string out;
+    for (size_t i = 0; i < utf8.size();)
+    {
+        unsigned char c = static_cast<unsigned char>(utf8[i]);
+        size_t length = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        uint32_t cp = length == 1 ? c : c & (0xFF >> (length + 1));
+        for (size_t k = 1; k < length && i + k < utf8.size(); ++k)
+            cp = cp << 6 | (static_cast<unsigned char>(utf8[i + k]) & 0x3F);
+        i += length;
+        if (cp >= 0x10000)
+        {
+            out += static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10));
+            out += static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        }
+        else
+        {
+            out += static_cast<char16_t>(cp);
+        }
+    }
+    return out;
+}
+
+// Frame text in ID3v2 encoding 1 (UTF-16 with BOM), 2 (UTF-16BE) or 3 (UTF-8)
+static std::string id3v2_encode(const std::string &utf8, uint8_t encoding)
+{
+    std::string out(1, static_cast<char>(encoding));
+    if (encoding == 3)
+        return out + utf8;
+    bool big_endian = encoding == 2;
+    if (!big_endian)
+        out += "\xFF\xFE";
+    for (char16_t u : to_utf16(utf8))
+    {
+        out += static_cast<char>(big_endian ? u >> 8 : u & 0xFF);
+        out += static_cast<char>(big_endian ? u & 0xFF : u >> 8);
+    }
+    return out;
+}
+
+// A tag in one of v2.2 (UTF-16), v2.3 (UTF-16) or v2.4 (UTF-8 or UTF-16BE)
+static std::string id3v2_tag(size_t i, const SyntheticTags &tags)
+{
+    static const char *ids[2][6] = {{"TT2", "TP1", "TAL", "TYE", "TCO", "TRK"},
+                                    {"TIT2", "TPE1", "TALB", "TYER", "TCON", "TRCK"}};
+    const std::string *values[6] = {&tags.title, &tags.artist, &tags.album, &tags.year, &tags.genre, &tags.track_number};
+    uint8_t version = i % 4 == 0 ? 2 : i % 4 == 1 ? 3 : 4;
+    uint8_t encoding = version < 4 ? 1 : i % 4 == 2 ? 3 : 2;
+
+    std::string frames;
+    for (int f = 0; f < 6; ++f)
+    {
+        std::string body = id3v2_encode(*values[f], encoding);
+        if (version == 2)
+        {
+            frames += ids[0][f];
+            for (int shift = 16; shift >= 0; shift -= 8)
+                frames += static_cast<char>((body.size() >> shift) & 0xFF);
+        }
+        else
+        {
+            frames += ids[1][f];
+            if (version == 3)
+                put_be32(frames, static_cast<uint32_t>(body.size()));
+            else
+                put_synchsafe(frames, static_cast<uint32_t>(body.size()));
+            frames += std::string(2, '\0'); // Flags
+        }
+        frames += body;
+    }
+    frames += std::string(128, '\0'); // Padding
+
+    std::string tag = "ID3";
+    tag += static_cast<char>(version);
+    tag += std::string(2, '\0');
+    put_synchsafe(tag, static_cast<uint32_t>(frames.size()));
+    return tag + frames;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+static void bench_fft(BenchRunner &runner)
+{
+    for (size_t size : {256, 512, 1024, 2048})
+    {
+        std::vector<float> signal = make_test_signal(size, 42);
+        runner.run("fft_analyze/" + std::to_string(size), static_cast<double>(size), "samples",
+                   [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           std::vector<float> mags = SimpleFFT::analyze(signal.data(), signal.size(), 64);
+                           do_not_optimize(mags.data());
+                       }
+                   });
+    }
+}
+
+static void bench_coder_mix(BenchRunner &runner, const Config &config)
+{
+    const size_t frames = config.buffer_size;
+    for (int voices : {1, 8, 32, 64})
+    {
+        std::unique_ptr<CoderMode> coder;
+        std::vector<float> out(frames * 2);
+        // Samples are 0.5 s long; re-trigger before they expire to hold polyphony
+        const uint64_t retrigger_every = std::max<uint64_t>(1, (config.sample_rate / 2) / frames - 1);
+
+        runner.run("coder_process/" + std::to_string(voices) + "_voices", static_cast<double>(frames), "frames",
+                   [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           if (i % retrigger_every == 0)
+                           {
+                               coder = std::make_unique<CoderMode>(config.sample_rate);
+                               for (int v = 0; v < voices; ++v)
+                                   coder->trigger_sample(v % 5, 0.5f);
+                           }
+                           coder->process(out.data(), frames);
+                           do_not_optimize(out.data());
+                       }
+                   });
+    }
+}
+
+static void bench_conversion(BenchRunner &runner, const Config &config)
+{
+    for (size_t frames : {static_cast<size_t>(config.buffer_size), static_cast<size_t>(4096)})
+    {
+        std::vector<float> in = make_test_signal(frames * 2, 7);
+        std::vector<int16_t> out(in.size());
+        runner.run("float_to_int16/" + std::to_string(frames) + "_frames", static_cast<double>(in.size()), "samples",
+                   [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           float_to_int16(in.data(), out.data(), in.size());
+                           do_not_optimize(out.data());
+                       }
+                   });
+    }
+}
+
+static void bench_lame(BenchRunner &runner, const Config &config)
+{
+    // Same encoder settings as NetworkServer::send_audio_stream
+    lame_t lame = lame_init();
+    if (!lame)
+        return;
+    lame_set_in_samplerate(lame, config.sample_rate);
+    lame_set_num_channels(lame, 2);
+    lame_set_brate(lame, 320);
+    lame_set_mode(lame, STEREO);
+    lame_set_quality(lame, 0);
+    lame_set_VBR(lame, vbr_off);
+    if (lame_init_params(lame) < 0)
+    {
+        lame_close(lame);
+        return;
+    }
+
+    // One second of audio, fed in buffer_size chunks exactly as the stream loop does
+    const size_t chunk = config.buffer_size;
+    std::vector<float> signal = make_test_signal(static_cast<size_t>(config.sample_rate) * 2, 11);
+    std::vector<int16_t> pcm(signal.size());
+    float_to_int16(signal.data(), pcm.data(), signal.size());
+    std::vector<unsigned char> mp3(16384);
+
+    runner.run("lame_encode/1s_audio", 1.0, "audio_seconds",
+               [&](uint64_t n)
+               {
+                   for (uint64_t i = 0; i < n; ++i)
+                   {
+                       for (size_t off = 0; off + chunk * 2 <= pcm.size(); off += chunk * 2)
+                       {
+                           int bytes = lame_encode_buffer_interleaved(lame, pcm.data() + off, static_cast<int>(chunk),
+                                                                      mp3.data(), static_cast<int>(mp3.size()));
+                           do_not_optimize(bytes);
+                       }
+                   }
+               });
+
+    lame_close(lame);
+}
+
+static void bench_metadata(BenchRunner &runner, const BenchOptions &opts)
+{
+    if (!runner.selected("metadata_parse"))
+        return;
+
+    fs::path dir = fs::path(opts.work_dir) / "corpus";
+    generate_corpus(dir, opts.corpus_files, 32 * 1024, 1234);
+    std::vector<std::string> files = list_files(dir);
+
+    runner.run("metadata_parse/corpus", static_cast<double>(files.size()), "files",
+               [&](uint64_t n)
+               {
+                   for (uint64_t i = 0; i < n; ++i)
+                   {
+                       for (const auto &f : files)
+                       {
+                           TrackMetadata meta = MetadataParser::parse(f);
+                           do_not_optimize(meta.duration_seconds);
+                       }
+                   }
+               });
+
+    // The same with the corpus dropped from the page cache before each pass,
+    // as on a first scan. Dirty pages cannot be dropped, so sync them first.
+    auto evict = [&]()
+    {
+        for (const auto &f : files)
+        {
+            int fd = ::open(f.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                continue;
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    };
+    runner.run_manual("metadata_parse_cold/corpus", static_cast<double>(files.size()), "files", [&]()
+                      {
+        evict();
+        Clock::time_point start = Clock::now();
+        for (const auto &f : files)
+        {
+            TrackMetadata meta = MetadataParser::parse(f);
+            do_not_optimize(meta.duration_seconds);
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+}
+
+static void bench_id3(BenchRunner &runner)
+{
+    if (!runner.selected("id3v2") && !runner.selected("utf16_to_utf8"))
+        return;
+
+    // International text in every version and encoding, parsed from memory
+    static const char *titles[] = {"Пусть всё будет так", "東京の夜景", "Für Elise", "Hoppípolla",
+                                   "Ελληνικό τραγούδι", "사랑해요", "Nuit blanche à Paris", "Night Drive 🎵"};
+    std::mt19937 rng(99);
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        SyntheticTags tags = make_tags(i, rng);
+        tags.title = titles[i % 8] + (" " + std::to_string(i));
+        tags.artist = titles[(i + 3) % 8];
+        corpus.push_back(id3v2_tag(i, tags) + mpeg_frames(4 * 417));
+    }
+
+    const std::string name = "bench.mp3";
+    runner.run("id3v2_parse/tag_corpus", static_cast<double>(corpus.size()), "tags",
+               [&](uint64_t n)
+               {
+                   for (uint64_t i = 0; i < n; ++i)
+                   {
+                       for (const auto &tag : corpus)
+                       {
+                           TrackMetadata meta = MetadataParser::parse(tag, name);
+                           do_not_optimize(meta.title.data());
+                       }
+                   }
+               });
+
+    // Mostly ASCII, as typical tags are, with some accented and CJK text
+    std::string utf16;
+    for (int k = 0; k < 64; ++k)
+        utf16 += id3v2_encode(k % 4 == 0 ? titles[k % 8] : "The Quick Brown Fox Jumps", 2).substr(1);
+    std::string out;
+    runner.run("utf16_to_utf8/mixed", static_cast<double>(utf16.size() / 2), "chars",
+               [&](uint64_t n)
+               {
+                   for (uint64_t i = 0; i < n; ++i)
+                   {
+                       out.clear();
+                       TextEncoding::utf16_to_utf8(utf16, true, out);
+                       do_not_optimize(out.data());
+                   }
+               });
+}
+
+static void bench_playlist(BenchRunner &runner, const BenchOptions &opts, Config config)
+{
+    if (!runner.selected("playlist"))
+        return;
+
+    fs::path dir = fs::path(opts.work_dir) / "library";
+    std::cout << "Generating " << opts.library_tracks << " track library in " << dir << "..." << std::endl;
+    generate_corpus(dir, opts.library_tracks, 256, 5678);
+
+    config.music_directory = dir.string();
+    config.playlist_file.clear();
+    config.library_index_file.clear();
+    config.watch_library = false;
+    config.lazy_metadata = false;
+
+    PlaylistManager playlist(config);
+
+    double tracks = static_cast<double>(playlist.get_track_count());
+    std::cout << "Track table: " << std::fixed << std::setprecision(1)
+              << playlist.get_library_memory_bytes() / tracks << " bytes/track" << std::endl;
+
+    // Every file parsed
+    runner.run_manual("playlist_scan/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        playlist.scan_music_directory();
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    // Warm restart: everything reused from an up-to-date library index
+    Config indexed_config = config;
+    indexed_config.library_index_file = (fs::path(opts.work_dir) / "library.idx").string();
+    fs::remove(indexed_config.library_index_file);
+    PlaylistManager indexed(indexed_config);
+
+    runner.run_manual("playlist_scan_indexed/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        indexed.scan_music_directory();
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    // Switching to a smart playlist filters the loaded library by its rules
+    std::string rules = (fs::path(opts.work_dir) / "bench.smart").string();
+    std::ofstream(rules) << "genre in Rock, Jazz, Ambient\nyear 1970..1999\n";
+    runner.run_manual("playlist_smart_filter/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        indexed.load_playlist_file(rules);
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    // Loading a saved playlist: parse and publish, checks run in the background
+    std::string m3u = (fs::path(opts.work_dir) / "bench.m3u").string();
+    playlist.save_playlist(m3u);
+    runner.run_manual("playlist_load_m3u/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        indexed.load_playlist_file(m3u);
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    // The same playlist in the binary format: standalone, then as a
+    // selection of the scanned library
+    std::string hpl = (fs::path(opts.work_dir) / "bench.hpl").string();
+    playlist.save_playlist(hpl, PlaylistFormat::BINARY);
+    runner.run_manual("playlist_load_binary/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        indexed.load_playlist_file(hpl);
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+    runner.run_manual("playlist_load_binary_library/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        playlist.load_playlist_file(hpl);
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    runner.run_manual("playlist_shuffle/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        playlist.shuffle(ShuffleMode::RANDOM);
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    runner.run_manual("playlist_shuffle_smart/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        Clock::time_point start = Clock::now();
+        playlist.shuffle(ShuffleMode::SMART);
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    runner.run_manual("playlist_unshuffle/" + std::to_string(opts.library_tracks), tracks, "tracks", [&]()
+                      {
+        playlist.shuffle(); // Untimed
+        Clock::time_point start = Clock::now();
+        playlist.unshuffle();
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    // Queue a few hundred tracks, then play through them; each step publishes
+    const size_t queued = 256;
+    runner.run_manual("playlist_queue_play", static_cast<double>(queued), "tracks", [&]()
+                      {
+        std::shared_ptr<const PlaylistSnapshot> view = playlist.snapshot();
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < queued; ++i)
+            playlist.enqueue((*view->order)[(i * 7919) % view->size()]);
+        for (size_t i = 0; i <= queued; ++i)
+            playlist.next();
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    // Reader path used by every TUI frame and HTTP request
+    const size_t reads = 100000;
+    runner.run_manual("playlist_snapshot_read", static_cast<double>(reads), "reads", [&]()
+                      {
+        size_t sum = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < reads; ++i)
+            sum += playlist.snapshot()->current_index;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        do_not_optimize(sum);
+        return seconds; });
+
+    const std::pair<const char *, SortCriteria> criteria[] = {
+        {"title", SortCriteria::TITLE},
+        {"artist", SortCriteria::ARTIST},
+        {"album", SortCriteria::ALBUM},
+        {"duration", SortCriteria::DURATION}};
+
+    for (const auto &c : criteria)
+    {
+        runner.run_manual("playlist_sort_" + std::string(c.first) + "/" + std::to_string(opts.library_tracks),
+                          tracks, "tracks", [&]()
+                          {
+            playlist.shuffle(); // Untimed: sort from a random order every repetition
+            Clock::time_point start = Clock::now();
+            playlist.sort_by(c.second);
+            return std::chrono::duration<double>(Clock::now() - start).count(); });
+    }
+}
+
+static void bench_search(BenchRunner &runner, const BenchOptions &opts)
+{
+    if (!runner.selected("search"))
+        return;
+
+    // Titles and names from a vocabulary of made-up words, built in memory:
+    // the index does not care where the strings came from
+    static const char *syllables[] = {"ka", "lo", "mi", "ren", "tas", "vo", "shi", "da", "mor", "el",
+                                      "qui", "bra", "nu", "fen", "gal", "ti", "zor", "pa", "wen", "ul"};
+    std::mt19937 rng(4242);
+    std::vector<std::string> vocabulary(20000);
+    for (auto &word : vocabulary)
+    {
+        size_t parts = 2 + rng() % 3;
+        for (size_t i = 0; i < parts; ++i)
+            word += syllables[rng() % 20];
+    }
+    auto words = [&](size_t count)
+    {
+        std::string text;
+        for (size_t i = 0; i < count; ++i)
+            text += (i ? " " : "") + vocabulary[rng() % vocabulary.size()];
+        return text;
+    };
+
+    auto table = std::make_shared<TrackTable>();
+    std::vector<std::string> artists(opts.library_tracks / 10 + 1), albums(opts.library_tracks / 12 + 1);
+    for (auto &a : artists)
+        a = words(2);
+    for (auto &a : albums)
+        a = words(2);
+    for (size_t i = 0; i < opts.library_tracks; ++i)
+    {
+        Track track("/music/t" + std::to_string(i) + ".mp3");
+        track.title = words(1 + rng() % 4);
+        track.artist = artists[rng() % artists.size()];
+        track.album = albums[rng() % albums.size()];
+        track.genre = vocabulary[rng() % 50];
+        table->add(track);
+    }
+    std::shared_ptr<const TrackTable> tracks = table;
+    double rows = static_cast<double>(opts.library_tracks);
+
+    runner.run_manual("search_build/" + std::to_string(opts.library_tracks), rows, "tracks", [&]()
+                      {
+        SearchIndex index;
+        Clock::time_point start = Clock::now();
+        index.sync(tracks);
+        return std::chrono::duration<double>(Clock::now() - start).count(); });
+
+    SearchIndex index;
+    index.sync(tracks);
+    std::cout << "Search index: " << index.term_count() << " terms" << std::endl;
+
+    // Queries drawn from real titles so they all have hits
+    std::vector<std::string> exact, prefix, typo, two_words;
+    for (int i = 0; i < 100; ++i)
+    {
+        std::vector<std::string> title;
+        SearchIndex::tokenize(tracks->title(rng() % opts.library_tracks), title);
+        std::string word = title[0];
+        exact.push_back(word);
+        prefix.push_back(word.substr(0, 3));
+        std::string mistyped = word;
+        std::swap(mistyped[1], mistyped[2]);
+        typo.push_back(mistyped);
+        two_words.push_back(word + " " + std::string(tracks->artist(rng() % opts.library_tracks)).substr(0, 4));
+    }
+
+    const std::pair<const char *, std::vector<std::string> *> kinds[] = {
+        {"exact", &exact}, {"prefix", &prefix}, {"typo", &typo}, {"two_words", &two_words}};
+    for (const auto &kind : kinds)
+    {
+        const std::vector<std::string> &queries = *kind.second;
+        runner.run("search_" + std::string(kind.first) + "/" + std::to_string(opts.library_tracks),
+                   static_cast<double>(queries.size()), "queries", [&](uint64_t n)
+                   {
+                       for (uint64_t i = 0; i < n; ++i)
+                       {
+                           for (const auto &q : queries)
+                           {
+                               std::vector<SearchHit> hits = index.search(q, 20);
+                               do_not_optimize(hits.size());
+                           }
+                       }
+                   });
+    }
+}
+
+static void print_usage(const char *argv0)
+{
+    std::cout << "Usage: " << argv0 << " [options]\n"
+              << "  --json PATH          Write results as JSON to PATH\n"
+              << "  --filter SUBSTRING   Only run benchmarks whose name contains SUBSTRING\n"
+              << "  --repetitions N      Timed repetitions per benchmark (default 5)\n"
+              << "  --min-time SECONDS   Minimum duration of one repetition (default 0.1)\n"
+              << "  --tracks N           Synthetic library size for playlist and search benchmarks (default 100000)\n"
+              << "  --corpus N           Synthetic files for the metadata benchmark (default 2000)\n"
+              << "  --work-dir PATH      Scratch directory for generated files (default: system temp)\n";
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--json" && has_value)
+            opts.json_path = argv[++i];
+        else if (arg == "--filter" && has_value)
+            opts.filter = argv[++i];
+        else if (arg == "--repetitions" && has_value)
+            opts.repetitions = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-time" && has_value)
+            opts.min_time_s = std::atof(argv[++i]);
+        else if (arg == "--tracks" && has_value)
+            opts.library_tracks = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--corpus" && has_value)
+            opts.corpus_files = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--work-dir" && has_value)
+            opts.work_dir = argv[++i];
+        else
+        {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+
+    bool own_work_dir = opts.work_dir.empty();
+    if (own_work_dir)
+    {
+        opts.work_dir = (fs::temp_directory_path() / ("harmonic_bench_" + std::to_string(::getpid()))).string();
+    }
+    fs::create_directories(opts.work_dir);
+
+    Config config;
+    config.load_defaults();
+
+    // Keep per-scan progress messages out of the timings
+    Logger::set_level(LogLevel::WARN);
+
+    BenchRunner runner(opts);
+    bench_fft(runner);
+    bench_coder_mix(runner, config);
+    bench_conversion(runner, config);
+    bench_lame(runner, config);
+    bench_metadata(runner, opts);
+    bench_id3(runner);
+    bench_playlist(runner, opts, config);
+    bench_search(runner, opts);
+
+    if (own_work_dir)
+    {
+        std::error_code ec;
+        fs::remove_all(opts.work_dir, ec);
+    }
+
+    if (!opts.json_path.empty())
+    {
+        if (!runner.write_json(opts.json_path))
+        {
+            std::cerr << "Failed to write " << opts.json_path << std::endl;
+            return 1;
+        }
+        std::cout << "Results written to " << opts.json_path << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+// fuzz_metadata.cpp - Fuzz target for tag parsing and the duration probe
+//
+// The input is a whole audio file. MetadataParser identifies the container
+// from the bytes, so this one target reaches the ID3v1/ID3v2, FLAC, Ogg and
+// MP4 tag parsers and DurationProbe. The seed corpus in corpus/metadata has a
+// file of each kind, plus files that once stalled or crashed a parser.
+//
+//   harmonic_fuzz_metadata -timeout=2 -rss_limit_mb=512 work ../fuzz/corpus/metadata
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include "metadata_parser.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    // No parse deadline: a slow input should trip the fuzzer's timeout
+    // rather than be cut short
+    static const bool configured = []()
+    {
+        ParseLimits limits;
+        limits.timeout_ms = 0;
+        MetadataParser::set_limits(limits);
+        return true;
+    }();
+    (void)configured;
+
+    std::string_view file(reinterpret_cast<const char *>(data), size);
+    TrackMetadata meta = MetadataParser::parse(file, "fuzz.mp3");
+
+    // The art location is served from the file later; it must lie inside it
+    if (meta.art_length > 0 && (meta.art_offset > size || meta.art_length > size - meta.art_offset))
+        abort();
+    return 0;
+}
@@ -0,0 +1,22 @@
+// fuzz_playlist.cpp - Fuzz target for the M3U and PLS playlist parsers
+//
+// The input is playlist text; both parsers read every input, as a playlist
+// with the wrong extension would be.
+//
+//   harmonic_fuzz_playlist -timeout=2 -rss_limit_mb=512 work ../fuzz/corpus/playlist
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "playlist_parser.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    std::string_view text(reinterpret_cast<const char *>(data), size);
+    std::vector<Track> tracks;
+    PlaylistParser::parse_m3u_text(text, "/music", tracks);
+    tracks.clear();
+    PlaylistParser::parse_pls_text(text, "/music", tracks);
+    return 0;
+}
@@ -0,0 +1,129 @@
+// replay_main.cpp - Runs inputs through a fuzz target without libFuzzer
+//
+// Linked into the fuzz targets when the compiler has no libFuzzer. Each file
+// named on the command line, and each file in each directory named, is
+// passed to LLVMFuzzerTestOneInput once, which makes the seed corpus a
+// regression suite. With no arguments a single input is read from stdin,
+// which is how afl-fuzz drives a target. A crash fails the run through the
+// sanitizers; an input slower than --timeout-ms fails it too.
+//
+//   harmonic_fuzz_metadata ../fuzz/corpus/metadata
+//   harmonic_fuzz_metadata --timeout-ms 100 crash-1234
+//   afl-fuzz -i ../fuzz/corpus/metadata -o findings -- ./harmonic_fuzz_metadata
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace
+{
+    constexpr size_t MAX_INPUT = 64 * 1024 * 1024;
+
+    bool read_input(std::istream &in, std::vector<uint8_t> &input)
+    {
+        input.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return input.size() <= MAX_INPUT;
+    }
+
+    // Runs one input; returns its time in milliseconds
+    double run(const std::vector<uint8_t> &input)
+    {
+        auto start = std::chrono::steady_clock::now();
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double timeout_ms = 1000;
+    std::vector<fs::path> inputs;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--timeout-ms" && i + 1 < argc)
+        {
+            timeout_ms = atof(argv[++i]);
+        }
+        else if (arg == "--help")
+        {
+            std::cout << "Usage: " << argv[0] << " [--timeout-ms N] [file|directory ...]\n"
+                      << "Replays each input once; reads stdin when none are given\n";
+            return 0;
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+
+    std::vector<uint8_t> input;
+    if (inputs.empty())
+    {
+        if (!read_input(std::cin, input))
+            return 1;
+        run(input);
+        return 0;
+    }
+
+    // Expand directories, in a stable order
+    std::vector<fs::path> files;
+    for (const auto &path : inputs)
+    {
+        std::error_code ec;
+        if (fs::is_directory(path, ec))
+        {
+            for (const auto &entry : fs::directory_iterator(path, ec))
+            {
+                if (entry.is_regular_file(ec))
+                    files.push_back(entry.path());
+            }
+        }
+        else
+        {
+            files.push_back(path);
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    size_t slow = 0;
+    double slowest = 0;
+    fs::path slowest_file;
+    for (const auto &file : files)
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in || !read_input(in, input))
+        {
+            std::cerr << "Cannot read " << file.string() << " (missing or over " << MAX_INPUT / (1024 * 1024)
+                      << " MB)\n";
+            return 1;
+        }
+
+        double ms = run(input);
+        if (ms > timeout_ms)
+        {
+            std::cerr << "SLOW " << file.string() << ": " << ms << " ms\n";
+            slow++;
+        }
+        if (ms >= slowest)
+        {
+            slowest = ms;
+            slowest_file = file;
+        }
+    }
+
+    printf("Replayed %zu inputs, slowest %.2f ms (%s), %zu over %.0f ms\n", files.size(), slowest,
+           slowest_file.string().c_str(), slow, timeout_ms);
+    return slow > 0 ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+// art_cache.h - Embedded cover images extracted to a size-bounded disk cache
+#ifndef ART_CACHE_H
+#define ART_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Where a track's cover image lies in its audio file, as recorded when the
+// file was indexed
+struct ArtSource
+{
+    std::string path;
+    uint64_t file_size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t offset = 0;
+    uint32_t length = 0;
+};
+
+struct CachedArt
+{
+    int fd = -1;      // Open on the cached image; the caller closes it
+    uint64_t size = 0;
+    std::string hash; // SHA-256 of the image bytes; a strong validator
+    const char *mime_type = "application/octet-stream";
+};
+
+// Images are copied out of the audio file on first request and stored under
+// the SHA-256 of their bytes, so tracks sharing an album cover share one file
+// and the hash doubles as the ETag. The copy is streamed outside the lock;
+// images over 16 MB are refused. Once the total exceeds the limit the least
+// recently served images are deleted. The directory is created and its
+// existing contents adopted on first use. All methods are thread-safe.
+class ArtCache
+{
+public:
+    ArtCache(const std::string &directory, uint64_t max_bytes);
+
+    ArtCache(const ArtCache &) = delete;
+    ArtCache &operator=(const ArtCache &) = delete;
+
+    // False if caching is disabled, or the source file changed since it was
+    // indexed or cannot be read
+    bool open(const ArtSource &source, CachedArt &art);
+
+private:
+    struct Entry
+    {
+        uint64_t size;
+        std::list<std::string>::iterator recency;
+        std::vector<std::string> sources; // by_source keys naming this file
+    };
+
+    // Copies the image to a temporary file in the directory; no lock needed
+    bool extract(const ArtSource &source, std::string &tmp_path, std::string &name, uint64_t &size) const;
+
+    // The rest are called with the mutex held
+    void load();
+    bool open_cached(const std::string &name, CachedArt &art);
+    void touch(const std::string &name);
+    // Drops an entry and the sources naming it; the file is left alone
+    void forget(std::unordered_map<std::string, Entry>::iterator it);
+    void evict();
+
+    std::mutex mutex;
+    std::string directory;
+    uint64_t max_bytes;
+    bool loaded = false;
+    uint64_t total_bytes = 0;
+
+    std::unordered_map<std::string, Entry> files; // Cached file name -> entry
+    std::list<std::string> recency;               // Most recently served first
+    std::unordered_map<std::string, std::string> by_source; // Source key -> file name
+};
+
+#endif // ART_CACHE_H
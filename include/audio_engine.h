@@ -13,6 +13,7 @@
 #include <string>
 #include <condition_variable>
 #include <deque>
+#include <thread>
 
 struct AudioFrame
 {
@@ -39,6 +40,10 @@ public:
     void start();
     void stop();
     bool load_track(const std::string &filepath);
+    // Queue `filepath` for the decoder thread, which opens it and decodes its
+    // first periods so that a later load_track() of the same file only swaps
+    // decoders. A newer request replaces one not yet started.
+    void preload_track(const std::string &filepath);
     void enable_live_coding(bool enable);
 
     CoderMode *get_coder_mode();
@@ -56,8 +61,31 @@ public:
 private:
     Config config;
     ma_device device;
-    ma_decoder decoder;
-    bool decoder_initialized = false;
+
+    // Two decoders: the active slot plays and the other holds the preloaded
+    // track. The audio thread only touches the active slot, under
+    // audio_mutex; the spare is filled under preload_mutex, and load_track()
+    // swaps them holding both.
+    static constexpr size_t PREROLL_PERIODS = 4;
+    struct DecoderSlot
+    {
+        ma_decoder decoder;
+        bool initialized = false;
+        std::string filepath;
+        std::vector<float> preroll; // Decoded start of the track, stereo
+        size_t preroll_frames = 0;
+    };
+    DecoderSlot slots[2];
+    size_t active = 0;
+    size_t preroll_position = 0; // Frames of the active preroll played
+    std::mutex preload_mutex;
+
+    // Preloads run on their own thread (the `decoder` scheduling role)
+    std::thread decoder_thread;
+    std::mutex request_mutex;
+    std::condition_variable request_cv;
+    std::string preload_request; // Guarded by request_mutex
+    bool stopping = false;       // Guarded by request_mutex
 
     std::atomic<bool> is_playing;
     std::atomic<bool> live_coding_enabled;
@@ -74,8 +102,12 @@ private:
 
     std::string current_track;
     std::vector<float> stream_buffer;
+    std::vector<float> fft_scratch; // Mono downmix for calculate_fft (audio thread only)
     FFTData current_fft;
 
+    bool open_slot(DecoderSlot &slot, const std::string &filepath);
+    void close_slot(DecoderSlot &slot);
+    void decoder_loop();
     static void data_callback(ma_device *device, void *output, const void *input, ma_uint32 frame_count);
     void calculate_fft(float *samples, size_t frame_count);
 };
@@ -0,0 +1,100 @@
+// binary_playlist.h - Memory-mapped native playlist format
+#ifndef BINARY_PLAYLIST_H
+#define BINARY_PLAYLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "track_table.h"
+
+// On-disk layout (native endianness, offsets from the start of the file),
+// following the library index:
+//
+//   PlaylistHeader
+//   PlaylistRecord[entry_count]   in playlist order
+//   string table (UTF-8, not NUL-terminated, duplicate values stored once)
+//
+// Every entry keeps its path and tags, so a playlist converts to and from
+// M3U/PLS without loss. Records are fixed-size and read in place: opening a
+// playlist maps it and checks the header, and entries are only decoded when
+// asked for.
+namespace binary_playlist
+{
+    constexpr char MAGIC[4] = {'H', 'P', 'L', 'S'};
+    constexpr uint32_t VERSION = 2;
+
+    struct StringRef
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct PlaylistHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t record_size;
+        uint64_t entry_count;
+        uint64_t strings_offset;
+        uint64_t strings_size;
+    };
+
+    enum : uint32_t
+    {
+        RECORD_METADATA_PENDING = 1 // Only the path is known; tags are read on load
+    };
+
+    struct PlaylistRecord
+    {
+        StringRef path;
+        StringRef title;
+        StringRef artist;
+        StringRef album;
+        StringRef year;
+        StringRef genre;
+        int32_t duration_ms;
+        int32_t bitrate;
+        int32_t bpm;
+        int32_t disc;
+        int32_t track_number;
+        uint32_t flags;
+    };
+}
+
+class BinaryPlaylist
+{
+public:
+    BinaryPlaylist() = default;
+    ~BinaryPlaylist();
+
+    BinaryPlaylist(const BinaryPlaylist &) = delete;
+    BinaryPlaylist &operator=(const BinaryPlaylist &) = delete;
+
+    // Map a playlist. Returns false if it is missing, truncated or from
+    // another format version.
+    bool open(const std::string &path);
+    void close();
+
+    size_t size() const { return entry_count; }
+    std::string_view path(size_t i) const { return string_at(record_at(i)->path); }
+    // The whole entry, as a Track
+    Track get(size_t i) const;
+
+    // Write `order`'s rows atomically to `path`
+    static bool save(const std::string &path, const TrackTable &tracks, const std::vector<TrackId> &order);
+
+private:
+    const binary_playlist::PlaylistRecord *record_at(size_t i) const;
+    std::string_view string_at(binary_playlist::StringRef ref) const;
+
+    void *mapping = nullptr;
+    size_t mapping_size = 0;
+    size_t entry_count = 0;
+    const char *strings = nullptr;
+    uint64_t strings_size = 0;
+};
+
+#endif // BINARY_PLAYLIST_H
@@ -13,6 +13,15 @@ enum class PlaybackMode
     CODER
 };
 
+// Scheduling for one thread role (see realtime.h)
+struct ThreadSchedConfig
+{
+    std::string policy = "other"; // "fifo", "rr" or "other"
+    int priority = 0;             // SCHED_FIFO/RR priority
+    int nice = 0;                 // Used for "other", and as the fallback when RT is denied
+    std::string cpus;             // Affinity, e.g. "2,3" or "0-1"; empty = any
+};
+
 enum class VisualizerTheme
 {
     CYBERPUNK_COFFEE,
@@ -44,6 +53,36 @@ public:
 
     std::string music_directory = "./music";
     std::string playlist_file = "";
+    // Cached scan results, reconciled by file size/mtime; empty disables
+    std::string library_index_file = "harmonic_library.idx";
+    int scan_threads = 0; // Library scan workers; 0 = 2x cores, at most 16
+    bool watch_library = true; // Apply filesystem changes under music_directory live
+    bool lazy_metadata = true; // Publish tracks before their tags are read
+    int watch_debounce_ms = 1000;
+    // Per-file bounds on tag parsing, so malformed files cannot stall a scan
+    int scan_max_tag_mb = 16;
+    int scan_timeout_ms = 2000; // 0 = none
+    // Embedded cover art extracted for the web API; empty disables
+    std::string art_cache_dir = "harmonic_art";
+    int art_cache_max_mb = 256; // Least recently served images are evicted beyond this
+
+    // Real-time scheduling per thread role: rt_<role>_{policy,priority,nice,cpus}
+    // with role one of audio, decoder, encoder, network, scanner
+    bool rt_mlock = false;
+    std::map<std::string, ThreadSchedConfig> thread_sched = {
+        {"audio", {"fifo", 70, -10, ""}},
+        {"decoder", {"other", 0, -5, ""}},
+        {"scanner", {"other", 0, 10, ""}}};
+
+    // Logging: level is debug/info/warn/error; empty log_file means stderr
+    std::string log_level = "info";
+    std::string log_file = "";
+    bool log_syslog = false;
+    int log_rate_limit = 20; // Messages per call site per second (0 = unlimited)
+
+    // Pipeline tracing (Chrome trace JSON via /api/trace or SIGUSR1)
+    bool trace_enabled = false;
+    std::string trace_file = "harmonic_trace.json";
 
     void load_defaults();
     void load_from_file(const std::string &filename);
@@ -53,6 +92,7 @@ public:
 private:
     void parse_line(const std::string &line);
     std::string trim(const std::string &str);
+    static bool parse_bool(const std::string &value);
 };
 
 #endif // CONFIG_H
\ No newline at end of file
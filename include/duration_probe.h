@@ -0,0 +1,38 @@
+// duration_probe.h - Exact track durations from container headers
+#ifndef DURATION_PROBE_H
+#define DURATION_PROBE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class FileReader;
+
+struct AudioProperties
+{
+    int duration_ms = 0;  // 0 if the format or its headers were not understood
+    int bitrate_kbps = 0; // Average over the audio data
+    int sample_rate = 0;
+};
+
+// Reads the few header bytes each format needs, identified by magic rather
+// than extension:
+//   MP3   Xing/Info (frame count, LAME encoder delay and padding) or VBRI
+//         in the first frame; constant bitrate otherwise
+//   FLAC  STREAMINFO total samples
+//   WAV   fmt byte rate and data chunk size
+//   Ogg   last page's granule position (Vorbis, Opus, FLAC, Speex)
+//   MP4   mvhd timescale and duration
+// A leading ID3v2 tag is skipped. Nothing is decoded, and files are read
+// with pread rather than mapped.
+class DurationProbe
+{
+public:
+    static AudioProperties probe(const std::string &filepath);
+    // The same for an open file whose first bytes, `head`, are already read
+    static AudioProperties probe_file(const FileReader &file, std::string_view head);
+    // The same for a file already in memory
+    static AudioProperties probe_bytes(std::string_view file);
+};
+
+#endif // DURATION_PROBE_H
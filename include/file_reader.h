@@ -0,0 +1,36 @@
+// file_reader.h - Positioned reads of a file without mapping it
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One open; every read is a pread of just the bytes asked for. Unlike a
+// mapping, a file truncated while it is read gives short reads instead of
+// SIGBUS, and nothing is pinned by mlockall. Only regular files open.
+class FileReader
+{
+public:
+    explicit FileReader(const std::string &path);
+    ~FileReader();
+
+    FileReader(const FileReader &) = delete;
+    FileReader &operator=(const FileReader &) = delete;
+
+    bool is_open() const { return fd >= 0; }
+    uint64_t size() const { return length; } // As of opening
+
+    // Up to `count` bytes at `offset`; fewer at the end of the file
+    size_t read_some(uint64_t offset, void *out, size_t count) const;
+    bool read(uint64_t offset, void *out, size_t count) const { return read_some(offset, out, count) == count; }
+
+    // Appends up to `count` bytes at `offset` to `buffer`; returns how many
+    size_t append(uint64_t offset, size_t count, std::string &buffer) const;
+
+private:
+    int fd = -1;
+    uint64_t length = 0;
+};
+
+#endif // FILE_READER_H
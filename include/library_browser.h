@@ -0,0 +1,95 @@
+// library_browser.h - Sorted, cursor-paginated views of the track library
+#ifndef LIBRARY_BROWSER_H
+#define LIBRARY_BROWSER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "playlist_manager.h"
+
+enum class BrowseSort
+{
+    ID, // Insertion order; needs no index
+    PATH,
+    TITLE,
+    ARTIST,
+    ALBUM,
+    YEAR,
+    GENRE,
+    DURATION,
+    COUNT
+};
+
+// Field projection bits for BrowseQuery::fields
+namespace browse_field
+{
+    enum : unsigned
+    {
+        ID = 1 << 0,
+        PATH = 1 << 1,
+        TITLE = 1 << 2,
+        ARTIST = 1 << 3,
+        ALBUM = 1 << 4,
+        YEAR = 1 << 5,
+        GENRE = 1 << 6,
+        DURATION = 1 << 7,
+        BITRATE = 1 << 8,
+        PENDING = 1 << 9,
+        ALL = (1 << 10) - 1
+    };
+}
+
+struct BrowseQuery
+{
+    BrowseSort sort = BrowseSort::PATH;
+    size_t limit = 100;
+    unsigned fields = browse_field::ALL;
+
+    // Decoded cursor: the page starts after (after_key, after_id) in sort order
+    bool has_cursor = false;
+    TrackId after_id = 0;
+    std::string after_key;
+};
+
+// Pages through a snapshot's tracks in a chosen order. A cursor holds the
+// sort key and ID of the last track returned, not a position, so pages stay
+// stable while tracks are added or removed between requests. Text columns
+// other than the path sort by Collation key. Sorted ID lists are built once
+// per table modification and shared by all clients.
+class LibraryBrowser
+{
+public:
+    static constexpr size_t MAX_LIMIT = 1000;
+
+    // Receives the response body piece by piece; returning false stops the page
+    using Sink = std::function<bool(std::string_view chunk)>;
+
+    // Parse a URL query string: cursor=, limit=, sort=, fields=
+    static bool parse_query(std::string_view query_string, BrowseQuery &query, std::string &error);
+    // Decode one query string value (%XX escapes, '+' for space)
+    static std::string url_decode(std::string_view value);
+
+    // Stream one page as JSON. Returns false if the sink gave up.
+    bool write_page(const PlaylistSnapshot &snapshot, const BrowseQuery &query, const Sink &sink);
+
+private:
+    struct SortedIndex
+    {
+        // Table contents the index was built for (TrackTable::lineage and
+        // modification_count)
+        uint64_t lineage = 0;
+        uint64_t modifications = 0;
+        std::shared_ptr<const std::vector<TrackId>> ids;
+    };
+
+    std::shared_ptr<const std::vector<TrackId>> sorted_ids(const std::shared_ptr<const TrackTable> &tracks, BrowseSort sort);
+
+    std::mutex cache_mutex;
+    SortedIndex cache[static_cast<size_t>(BrowseSort::COUNT)];
+};
+
+#endif // LIBRARY_BROWSER_H
@@ -0,0 +1,123 @@
+// library_index.h - Persistent, memory-mapped index of the scanned music library
+#ifndef LIBRARY_INDEX_H
+#define LIBRARY_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Track;
+class TrackTable;
+
+// On-disk layout (native endianness, all offsets from the start of the file):
+//
+//   IndexHeader
+//   IndexRecord[entry_count]
+//   string table (UTF-8, not NUL-terminated, duplicate values stored once)
+//
+// The file is written to a temporary name and renamed into place, so a crash
+// never leaves a half-written index. A header with the wrong magic, version or
+// record size is treated as "no index" and the library is rescanned.
+// Versions 3 and 4 lack the cover art fields; their records are read with
+// the shorter stride and upgraded on lookup.
+namespace library_index
+{
+    constexpr char MAGIC[4] = {'H', 'L', 'I', 'X'};
+    constexpr uint32_t VERSION = 5;
+    // Records end before the cover art fields; the art is located again on
+    // lookup and the index is rewritten
+    constexpr uint32_t VERSION_NO_ART = 4;
+    // As VERSION_NO_ART, and durations were estimated from the file size
+    constexpr uint32_t VERSION_ESTIMATED_DURATIONS = 3;
+
+    struct StringRef
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct IndexHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t record_size;
+        uint64_t entry_count;
+        uint64_t strings_offset;
+        uint64_t strings_size;
+    };
+
+    struct IndexRecord
+    {
+        uint64_t file_size;
+        int64_t mtime_ns;
+        StringRef path;
+        StringRef title;
+        StringRef artist;
+        StringRef album;
+        StringRef year;
+        StringRef genre;
+        int32_t duration_ms;
+        int32_t bitrate;
+        int32_t bpm;
+        uint32_t play_count;
+        int32_t disc;
+        int32_t track_number;
+        uint64_t art_offset;
+        uint32_t art_length;
+        uint32_t reserved;
+    };
+
+    // Record size of versions before VERSION
+    constexpr size_t LEGACY_RECORD_SIZE = offsetof(IndexRecord, art_offset);
+}
+
+class LibraryIndex
+{
+public:
+    LibraryIndex() = default;
+    ~LibraryIndex();
+
+    LibraryIndex(const LibraryIndex &) = delete;
+    LibraryIndex &operator=(const LibraryIndex &) = delete;
+
+    // Map an index file. Returns false (and leaves the index empty) if it is
+    // missing, truncated or from another format version.
+    bool open(const std::string &path);
+    void close();
+
+    size_t size() const { return entry_count; }
+    // From an older version that lookup() upgrades; save a fresh index
+    bool is_outdated() const { return mapping && version < library_index::VERSION; }
+
+    // Fill `track` from the index if `filepath` is present and its size and
+    // mtime still match. Returns false if the file must be re-parsed.
+    bool lookup(const std::string &filepath, uint64_t file_size, int64_t mtime_ns, Track &track) const;
+
+    // Write the table's live rows (which must carry file_size/mtime_ns)
+    // atomically to `path`
+    static bool save(const std::string &path, const TrackTable &tracks);
+
+    // Size and modification time (ns since epoch) used to detect changed files
+    static bool stat_file(const std::string &filepath, uint64_t &file_size, int64_t &mtime_ns);
+
+private:
+    const library_index::IndexRecord *record_at(size_t i) const;
+    std::string_view string_at(library_index::StringRef ref) const;
+
+    void *mapping = nullptr;
+    size_t mapping_size = 0;
+    size_t entry_count = 0;
+    uint32_t version = 0;
+    size_t record_size = 0;
+    const char *strings = nullptr;
+    uint64_t strings_size = 0;
+
+    // Path -> record, views point into the mapping
+    std::unordered_map<std::string_view, size_t> by_path;
+};
+
+#endif // LIBRARY_INDEX_H
@@ -0,0 +1,73 @@
+// library_scanner.h - Parallel directory walk and metadata extraction
+#ifndef LIBRARY_SCANNER_H
+#define LIBRARY_SCANNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "playlist_manager.h"
+
+class LibraryIndex;
+
+struct ScanStats
+{
+    size_t files = 0;    // Supported audio files found
+    size_t reused = 0;   // Served from the library index
+    size_t parsed = 0;   // Read with MetadataParser
+    size_t deferred = 0; // Published without metadata (see set_defer_metadata)
+    uint64_t bytes = 0;  // Total size of the files found
+    double seconds = 0.0;
+    bool cancelled = false; // Stopped early; the files found are incomplete
+
+    double files_per_second() const { return seconds > 0 ? files / seconds : 0.0; }
+    double mb_per_second() const { return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+};
+
+// Walks a directory tree on a pool of worker threads. Directories and
+// chunks of files are work items on a shared queue, so both deep trees and
+// huge flat directories spread across the pool. Tag parsing is dominated by
+// small random reads, so by default the pool is oversubscribed relative to
+// the core count to keep several requests in flight per disk.
+class LibraryScanner
+{
+public:
+    // Receives completed tracks in batches; calls are serialized
+    using BatchCallback = std::function<void(std::vector<Track> &batch)>;
+
+    // `index` may be null; when given, unchanged files reuse its metadata
+    LibraryScanner(const Config &cfg, const LibraryIndex *index = nullptr);
+
+    ScanStats scan(const std::string &root, const BatchCallback &on_batch);
+
+    // Publish files missing from the index as path-only placeholders
+    // (metadata_pending set) instead of parsing them during the walk
+    void set_defer_metadata(bool defer) { defer_metadata = defer; }
+
+    // Abandon the walk once `*stop` becomes true: workers finish the file in
+    // hand, no further batches are delivered and scan() returns cancelled
+    void set_stop_flag(const std::atomic<bool> *stop) { stop_flag = stop; }
+
+    // Build a Track from a file's tags (title falls back to the file name)
+    static Track read_track(const std::string &filepath, uint64_t file_size, int64_t mtime_ns);
+
+    // Placeholder with the file name as title until metadata is read
+    static Track placeholder_track(const std::string &filepath, uint64_t file_size, int64_t mtime_ns);
+
+    static bool is_supported_format(const std::string &ext);
+
+    // Worker threads used for scanning and metadata resolution
+    static size_t thread_count(const Config &config);
+
+private:
+    Config config;
+    const LibraryIndex *index;
+    bool defer_metadata;
+    const std::atomic<bool> *stop_flag;
+
+    bool stop_requested() const { return stop_flag && stop_flag->load(std::memory_order_relaxed); }
+};
+
+#endif // LIBRARY_SCANNER_H
@@ -0,0 +1,54 @@
+// library_watcher.h - Filesystem watcher for incremental library updates
+#ifndef LIBRARY_WATCHER_H
+#define LIBRARY_WATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include "config.h"
+
+// Watches music_directory recursively with inotify and reports batches of
+// changed and removed paths once the tree has been quiet for
+// watch_debounce_ms (copying an album produces one batch, not hundreds).
+// Paths in a batch may name directories: a new directory's contents must be
+// scanned, and a removed directory removes every track below it.
+//
+// inotify is used rather than fanotify because it needs no privileges.
+// On other platforms start() logs a warning and does nothing.
+class LibraryWatcher
+{
+public:
+    using ChangeCallback = std::function<void(const std::set<std::string> &changed,
+                                              const std::set<std::string> &removed)>;
+    // Called if the kernel queue overflowed and events were lost
+    using RescanCallback = std::function<void()>;
+
+    LibraryWatcher(const Config &cfg, ChangeCallback on_change, RescanCallback on_rescan);
+    ~LibraryWatcher();
+
+    bool start();
+    void stop();
+
+private:
+    void run();
+    void add_watches(const std::string &directory);
+    void handle_events(const char *buffer, size_t length);
+
+    Config config;
+    ChangeCallback on_change;
+    RescanCallback on_rescan;
+
+    std::atomic<bool> running;
+    std::thread watch_thread;
+    int inotify_fd;
+
+    std::map<int, std::string> watch_paths; // Watch descriptor -> directory
+    std::set<std::string> pending_changed;
+    std::set<std::string> pending_removed;
+    bool rescan_needed;
+};
+
+#endif // LIBRARY_WATCHER_H
@@ -0,0 +1,70 @@
+// logger.h - Non-blocking structured logging for real-time and network threads
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "config.h"
+
+enum class LogLevel
+{
+    DEBUG = 0,
+    INFO = 1,
+    WARN = 2,
+    ERROR = 3
+};
+
+// Per-call-site rate limiter (one static instance per LOG_* statement).
+// Lets `log_rate_limit` messages through per second and counts the rest so
+// the next message that gets through can report how many were suppressed.
+struct LogSite
+{
+    std::atomic<int64_t> window_start_ms{0};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> suppressed{0};
+
+    // Returns false if the message should be dropped; otherwise stores the
+    // number of messages suppressed since the last one that got through.
+    bool admit(uint32_t &suppressed_out);
+};
+
+// Producers format into a fixed-size record in their own single-producer
+// ring; a background thread drains all rings to a file, stderr or syslog.
+// Logging never blocks or allocates on the calling thread after its first
+// message; if a ring is full the message is dropped and counted.
+class Logger
+{
+public:
+    // Opens the configured sink and starts the drain thread
+    static void start(const Config &config);
+    // Drains everything still queued and stops the drain thread
+    static void stop();
+
+    static void set_level(LogLevel level);
+    static bool enabled(LogLevel level);
+    static LogLevel parse_level(const std::string &name);
+
+    static void write(LogLevel level, LogSite &site, const char *subsystem, const char *fmt, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 4, 5)))
+#endif
+        ;
+};
+
+#define HARMONIC_LOG(level, subsystem, ...)                                   \
+    do                                                                        \
+    {                                                                         \
+        if (Logger::enabled(level))                                           \
+        {                                                                     \
+            static LogSite harmonic_log_site;                                 \
+            Logger::write(level, harmonic_log_site, subsystem, __VA_ARGS__);  \
+        }                                                                     \
+    } while (0)
+
+#define LOG_DEBUG(subsystem, ...) HARMONIC_LOG(LogLevel::DEBUG, subsystem, __VA_ARGS__)
+#define LOG_INFO(subsystem, ...) HARMONIC_LOG(LogLevel::INFO, subsystem, __VA_ARGS__)
+#define LOG_WARN(subsystem, ...) HARMONIC_LOG(LogLevel::WARN, subsystem, __VA_ARGS__)
+#define LOG_ERROR(subsystem, ...) HARMONIC_LOG(LogLevel::ERROR, subsystem, __VA_ARGS__)
+
+#endif // LOGGER_H
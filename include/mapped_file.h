@@ -0,0 +1,38 @@
+// mapped_file.h - Read-only memory mapping of a whole file
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// One open, one mmap; the descriptor is closed straight away. Empty files
+// are open with an empty view. The access pattern tunes kernel readahead:
+// SEQUENTIAL for files read front to back, RANDOM for files of which only a
+// few header and trailer pages are touched.
+class MappedFile
+{
+public:
+    enum class Access
+    {
+        SEQUENTIAL,
+        RANDOM
+    };
+
+    explicit MappedFile(const std::string &path, Access access = Access::SEQUENTIAL);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool is_open() const { return ok; }
+    size_t size() const { return length; }
+    std::string_view bytes() const { return data ? std::string_view(static_cast<const char *>(data), length) : std::string_view(); }
+
+private:
+    void *data = nullptr;
+    size_t length = 0;
+    bool ok = false;
+};
+
+#endif // MAPPED_FILE_H
@@ -1,11 +1,12 @@
-// metadata_parser.h - Complete ID3v1/ID3v2 and metadata parsing
+// metadata_parser.h - ID3v1/ID3v2, Vorbis comment and MP4 tag parsing
 #ifndef METADATA_PARSER_H
 #define METADATA_PARSER_H
 
+#include <cstdint>
 #include <string>
-#include <fstream>
-#include <cstring>
-#include <algorithm>
+#include <string_view>
+
+struct AudioProperties;
 
 struct TrackMetadata
 {
@@ -15,25 +16,72 @@ struct TrackMetadata
     std::string year;
     std::string genre;
     int duration_seconds;
+    int duration_ms;  // Exact when the container headers allow it
     int bitrate;
+    int bpm;          // 0 if untagged
+    int disc;         // 0 if untagged
+    int track_number; // 0 if untagged
+    uint64_t art_offset; // Embedded cover image bytes, stored as is in the file
+    uint32_t art_length; // 0 if there is none
+    bool truncated;      // Parsing stopped at a ParseLimits bound; tags may be incomplete
+
+    TrackMetadata() : duration_seconds(0), duration_ms(0), bitrate(0), bpm(0), disc(0), track_number(0), art_offset(0), art_length(0), truncated(false) {}
+};
 
-    TrackMetadata() : duration_seconds(0), bitrate(0) {}
+// What one file may cost to parse, so that a malformed or hostile file
+// cannot exhaust memory or stall a scan. Beyond the limits parsing stops
+// early and keeps what it has read.
+struct ParseLimits
+{
+    size_t max_tag_bytes = 16 * 1024 * 1024; // Largest tag, comment packet or block that is read
+    int timeout_ms = 2000;                   // Per file; 0 = none
 };
 
+// Sniffs the container from the first bytes, then runs only the matching
+// tag parser and the duration probe. A file on disk is read with pread in
+// bounded windows: the head up to the end of the leading tags (ID3v2, FLAC
+// metadata blocks, Ogg header pages), the MP4 udta box wherever moov is,
+// and the ID3v1 trailer; the audio data is never read. Tag fields are
+// located as views into the windows and copied once, into the TrackMetadata,
+// when they are kept. Embedded cover art (ID3v2 APIC, FLAC PICTURE, MP4 covr)
+// is only located, never copied out. A single text value is cut at 64 KB.
 class MetadataParser
 {
 public:
+    // Applies to all later parse() calls on any thread
+    static void set_limits(const ParseLimits &limits);
+
     static TrackMetadata parse(const std::string &filepath);
+    // The same for a file already in memory; `filepath` names the fallback title
+    static TrackMetadata parse(std::string_view file, const std::string &filepath);
 
 private:
-    static bool parse_id3v2(const std::string &filepath, TrackMetadata &meta);
-    static void parse_id3v2_frames(const char *data, size_t size, uint8_t version, TrackMetadata &meta);
-    static std::string extract_text(const char *data, size_t size, uint8_t encoding);
-    static bool parse_id3v1(const std::string &filepath, TrackMetadata &meta);
-    static bool parse_vorbis_comment(const std::string &filepath, TrackMetadata &meta);
-    static void parse_vorbis_block(std::ifstream &file, uint32_t size, TrackMetadata &meta);
-    static void estimate_duration(const std::string &filepath, TrackMetadata &meta);
+    // The parts of a file the tag parsers see; for a file in memory they are
+    // views of the whole file
+    struct Windows
+    {
+        std::string_view head;    // From the start of the file
+        std::string_view tail;    // Ending at the end of the file
+        std::string_view udta;    // Payload of the MP4 moov/udta box, if found
+        uint64_t udta_offset = 0; // Its offset in the file
+    };
+
+    static bool parse_tags(const Windows &file, TrackMetadata &meta);
+    static bool parse_id3v2(std::string_view file, TrackMetadata &meta);
+    static void parse_id3v2_frames(std::string_view file, std::string_view tag, uint8_t version, bool unsynchronised, TrackMetadata &meta);
+    static void parse_id3v2_picture(std::string_view file, std::string_view body, uint8_t version, TrackMetadata &meta);
+    static std::string extract_text(std::string_view data, uint8_t encoding);
+    static std::string resolve_genre(const std::string &text);
+    static bool parse_id3v1(std::string_view file, TrackMetadata &meta);
+    static bool parse_vorbis_comment(std::string_view file, size_t offset, TrackMetadata &meta);
+    static void parse_vorbis_block(std::string_view block, TrackMetadata &meta);
+    static void parse_flac_picture(std::string_view file, std::string_view block, TrackMetadata &meta);
+    static bool parse_ogg_comments(std::string_view file, TrackMetadata &meta);
+    static bool parse_mp4_tags(std::string_view udta, uint64_t udta_offset, TrackMetadata &meta);
+    static void parse_mp4_item(std::string_view type, std::string_view data, TrackMetadata &meta);
+    static void read_duration(const AudioProperties &props, uint64_t file_size, const std::string &filepath, TrackMetadata &meta);
+    static void estimate_duration(uint64_t file_size, const std::string &filepath, TrackMetadata &meta);
     static std::string get_id3v1_genre(uint8_t id);
 };
 
-#endif // METADATA_PARSER_H
\ No newline at end of file
+#endif // METADATA_PARSER_H
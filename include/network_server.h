@@ -17,10 +17,13 @@
 #include <fcntl.h>
 #include <mutex>
 #include <iostream>
+#include <algorithm>
 
 #include "config.h"
 #include "audio_engine.h"
 #include "playlist_manager.h"
+#include "library_browser.h"
+#include "art_cache.h"
 
 // Libshout for streaming (MP3/OGG)
 #include <shout/shout.h>
@@ -34,7 +37,9 @@
 class NetworkServer {
 public:
     NetworkServer(Config& cfg, std::shared_ptr<AudioEngine> audio, std::shared_ptr<PlaylistManager> playlist) 
-        : config(cfg), audio_engine(audio), playlist_mgr(playlist), running(false), server_fd(-1) {}
+        : config(cfg), audio_engine(audio), playlist_mgr(playlist),
+          art_cache(cfg.art_cache_dir, static_cast<uint64_t>(std::max(cfg.art_cache_max_mb, 0)) << 20),
+          running(false), server_fd(-1) {}
     
     ~NetworkServer() {
         stop();
@@ -47,6 +52,8 @@ private:
     Config& config;
     std::shared_ptr<AudioEngine> audio_engine;
     std::shared_ptr<PlaylistManager> playlist_mgr;
+    LibraryBrowser library_browser;
+    ArtCache art_cache;
     std::atomic<bool> running;
     int server_fd;
 
@@ -71,10 +78,15 @@ private:
     void send_html_response(int client_fd);
     void send_fft_response(int client_fd);
     void send_track_response(int client_fd);
+    void send_tracks_page(int client_fd, const std::string& request);
+    void send_search_response(int client_fd, const std::string& request);
+    void send_art_response(int client_fd, const std::string& request);
     void send_theme_response(int client_fd);
     void send_mute_response(int client_fd);
     void send_mode_response(int client_fd);
     void handle_mute_toggle(int client_fd);
+    void send_trace_response(int client_fd);
+    void handle_trace_toggle(int client_fd);
     void send_audio_stream(int client_fd);
     void send_404(int client_fd);
 
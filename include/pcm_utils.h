@@ -0,0 +1,19 @@
+// pcm_utils.h - Sample format conversion shared by the streaming paths
+#ifndef PCM_UTILS_H
+#define PCM_UTILS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Convert interleaved float samples in [-1, 1] to 16-bit PCM, clamping overs
+inline void float_to_int16(const float *in, int16_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        float sample = std::max(-1.0f, std::min(1.0f, in[i]));
+        out[i] = static_cast<int16_t>(sample * 32767.0f);
+    }
+}
+
+#endif // PCM_UTILS_H
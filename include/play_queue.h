@@ -0,0 +1,112 @@
+// play_queue.h - Priority play queue of track IDs
+#ifndef PLAY_QUEUE_H
+#define PLAY_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "track_table.h"
+
+enum class QueuePriority : uint8_t
+{
+    HIGH,   // Cued: plays before anything else queued
+    NORMAL, // Queued by a listener
+    LOW     // Filler, played once nothing else is queued
+};
+
+struct QueueEntry
+{
+    TrackId id;
+    QueuePriority priority;
+};
+
+// Double-ended ring of track IDs. Pushing at either end and popping the
+// front are O(1) and allocate only when the ring is full (capacity doubles),
+// so a steady queue never allocates. Inserting or erasing in the middle
+// shifts the entries after it.
+class TrackRing
+{
+public:
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    TrackId operator[](size_t position) const { return slots[(head + position) & (slots.size() - 1)]; }
+
+    void push_back(TrackId id);
+    void push_front(TrackId id);
+    TrackId pop_front();
+    void insert(size_t position, TrackId id);
+    void erase(size_t position);
+    void clear();
+
+    // Drop the IDs for which `gone(id)` holds, keeping the others in order
+    template <typename Gone>
+    size_t remove_if(Gone gone)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            TrackId id = (*this)[i];
+            if (!gone(id))
+                at(kept++) = id;
+        }
+        size_t removed = count - kept;
+        count = kept;
+        return removed;
+    }
+
+private:
+    TrackId &at(size_t position) { return slots[(head + position) & (slots.size() - 1)]; }
+    void grow();
+
+    std::vector<TrackId> slots; // Size is zero or a power of two
+    size_t head = 0;
+    size_t count = 0;
+};
+
+// Tracks to play before the playlist continues: one ring per priority,
+// played highest priority first and in queued order within one. Positions
+// number the entries in that play order, across the lanes.
+//
+// Not thread-safe: PlaylistManager guards it with the playlist lock.
+class PlayQueue
+{
+public:
+    static constexpr size_t LANES = 3;
+
+    void push(TrackId id, QueuePriority priority = QueuePriority::NORMAL);
+    // Ahead of everything already queued at `priority`
+    void push_front(TrackId id, QueuePriority priority);
+    bool pop(TrackId &id);
+    std::optional<TrackId> front() const;
+
+    QueueEntry at(size_t position) const;
+    // The entry joins the lane of the entry it lands before (or after, at
+    // the end), taking that priority; false if a position is out of range
+    bool move(size_t from, size_t to);
+    // Move an entry to the back of another priority's lane
+    bool set_priority(size_t position, QueuePriority priority);
+    bool erase(size_t position);
+    void clear();
+
+    template <typename Gone>
+    size_t remove_if(Gone gone)
+    {
+        size_t removed = 0;
+        for (TrackRing &lane : lanes)
+            removed += lane.remove_if(gone);
+        return removed;
+    }
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    std::vector<QueueEntry> entries() const;
+
+private:
+    // Lane and offset of `position`; false if it is past the end
+    bool locate(size_t position, size_t &lane, size_t &offset) const;
+
+    TrackRing lanes[LANES];
+};
+
+#endif // PLAY_QUEUE_H
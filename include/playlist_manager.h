@@ -4,9 +4,26 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 #include <mutex>
 #include <map>
+#include <deque>
+#include <set>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 #include "config.h"
+#include "track_table.h"
+#include "search_index.h"
+#include "smart_playlist.h"
+#include "shuffle.h"
+#include "sort_index.h"
+#include "play_queue.h"
+
+class LibraryWatcher;
 
 struct Track {
     std::string filepath;
@@ -17,32 +34,74 @@ struct Track {
     std::string genre;
     int duration_ms;
     int bitrate;
+    int bpm;              // 0 if untagged
+    int disc;             // 0 if untagged
+    int track_number;     // 0 if untagged
+    uint32_t play_count;  // Times played to the end
+    uint64_t file_size;   // Size and mtime when the metadata was read,
+    int64_t mtime_ns;     // used to reconcile against the library index
+    uint64_t art_offset;  // Embedded cover image: byte range in the file,
+    uint32_t art_length;  // 0 if there is none
+    bool metadata_pending; // Tags not read yet; title is the file name
     
     Track(const std::string& path) 
         : filepath(path), title(""), artist("Unknown"), album(""), 
-          year(""), genre(""), duration_ms(0), bitrate(0) {}
+          year(""), genre(""), duration_ms(0), bitrate(0), bpm(0), disc(0), track_number(0), play_count(0),
+          file_size(0), mtime_ns(0), art_offset(0), art_length(0),
+          metadata_pending(false) {}
+};
+
+// One published version of the playlist. Snapshots are immutable: readers
+// keep one as long as they like without locking, and writers publish a new
+// version instead of changing it. Unchanged parts are shared between versions.
+struct PlaylistSnapshot {
+    uint64_t version = 0;
+    std::shared_ptr<const TrackTable> tracks;
+    std::shared_ptr<const std::vector<TrackId>> order;
+    std::shared_ptr<const std::vector<QueueEntry>> queue; // In play order
+    size_t current_index = 0;
+    // Set while a queued track plays; current_index is then the playlist
+    // track that follows the queue
+    std::optional<TrackId> playing_queued;
+    size_t pending_metadata = 0;
+    bool shuffled = false;
+    
+    size_t size() const { return order->size(); }
+    std::optional<Track> track_at(size_t position) const;
+    std::optional<Track> current_track() const;
+    // The head of the queue, else the playlist track after the current one
+    std::optional<Track> next_track() const;
 };
 
 enum class PlaylistFormat {
     M3U,
     M3U8,
-    PLS
-};
-
-enum class SortCriteria {
-    TITLE,
-    ARTIST,
-    ALBUM,
-    DURATION
+    PLS,
+    BINARY  // .hpl, see binary_playlist.h
 };
 
 class PlaylistManager {
 public:
     PlaylistManager(const Config& cfg);
+    ~PlaylistManager();
     
     // Scanning and loading
     void scan_music_directory();
+    // Scan again and reconcile, as the watcher does after losing events;
+    // does nothing while a playlist file has replaced the library
+    void rescan_library();
+    // Incremental update: re-read `changed` paths (files or new directories)
+    // and drop tracks at or below `removed` paths
+    void apply_library_changes(const std::set<std::string>& changed, const std::set<std::string>& removed);
+    // Tracks still waiting for the background metadata resolver
+    size_t get_pending_metadata_count() const;
+    // M3U/PLS files replace the library; a .smart file filters it by rules.
+    // M3U/PLS entries are checked in the background: missing files are
+    // dropped and reported by get_invalid_entries(). A binary (.hpl)
+    // playlist selects rows of the loaded library by path, or is installed
+    // like M3U/PLS when there is no library.
     bool load_playlist_file(const std::string& filepath);
+    std::vector<std::string> get_invalid_entries() const;
     bool save_playlist(const std::string& filepath, PlaylistFormat format = PlaylistFormat::M3U);
     
     // Playback control
@@ -50,44 +109,172 @@ public:
     void enable_cue_system(bool enable);
     bool is_auto_advance_enabled() const { return auto_advance_enabled; }
     
-    Track* get_current_track();
-    Track* get_next_track();
+    // The latest published version; never blocks on playlist writers
+    std::shared_ptr<const PlaylistSnapshot> snapshot() const;
+    
+    // Shorthands reading from snapshot()
+    std::optional<Track> get_current_track();
+    std::optional<Track> get_next_track();
     
+    // The next queued track if any, else the next playlist track
     void next();
     void previous();
     void jump_to(size_t index);
+    // Count a play of the playing track; call when it finished playing
+    void record_play();
+    // Move to the track's position in the playlist; false if it is not in it
+    bool jump_to_track(TrackId id);
     
-    // Queue management
-    void add_to_queue(const std::string& filepath);
-    Track* get_queued_track();
-    bool has_queued();
+    // Play queue: queued tracks play before the playlist continues, by
+    // priority and then in the order queued. Positions are those of
+    // snapshot()->queue. Queuing fails for rows that do not exist.
+    bool enqueue(TrackId id, QueuePriority priority = QueuePriority::NORMAL);
+    bool play_next(TrackId id); // Ahead of everything queued
+    bool add_to_queue(const std::string& filepath, QueuePriority priority = QueuePriority::NORMAL);
+    bool move_queued(size_t from, size_t to);
+    bool set_queued_priority(size_t position, QueuePriority priority);
+    bool remove_queued(size_t position);
+    void clear_queue();
+    bool has_queued() const { return !snapshot()->queue->empty(); }
     
-    // Playlist manipulation
-    void shuffle();
+    // Playlist manipulation. Shuffling plays a permutation of the playlist,
+    // starting with the current track, and keeps the listed order for
+    // unshuffle(); a new permutation is drawn each time play wraps around.
+    // Sorting replaces the listed order and ends the shuffle.
+    void shuffle(ShuffleMode mode = ShuffleMode::SMART);
+    void unshuffle();
     void sort_by(SortCriteria criteria);
     
     // Getters
     size_t get_track_count() const;
     size_t get_current_index() const;
     std::vector<Track> get_all_tracks();
+    // Materialize `count` tracks starting at playlist position `start`
+    std::vector<Track> get_tracks(size_t start, size_t count) const;
+    size_t get_library_memory_bytes() const;
+    
+    // Best matches for `query` in the current snapshot; the index catches up
+    // with library changes on the first search after them
+    std::vector<SearchHit> search(std::string_view query, size_t limit);
     
 private:
     Config config;
-    std::vector<Track> tracks;
-    std::vector<std::string> queue;
+    // Writer state, guarded by playlist_mutex and published as snapshots
+    TrackTable table;            // Every known track, by stable ID
+    std::vector<TrackId> order;  // Playlist order; current_index is a position here
+    PlayQueue queue;
+    std::optional<TrackId> playing_queued; // Popped from the queue, now playing
+    
+    // Active smart playlist: order holds exactly the live rows it matches,
+    // kept up to date as rows are added or change
+    std::optional<SmartPlaylist> smart;
+    std::vector<bool> smart_members; // By TrackId
+    // order is a fixed selection of library rows (binary playlist); new
+    // library rows are not appended to it
+    bool library_subset;
+    
+    // While shuffled, order is the play permutation and unshuffled the listed
+    // order it was drawn from. Rows added or removed since are reconciled by
+    // unshuffle().
+    bool shuffled;
+    ShuffleMode shuffle_mode;
+    std::vector<TrackId> unshuffled;
+    PlayHistory history;
+    std::mt19937_64 shuffle_rng;
+    
+    std::shared_ptr<const PlaylistSnapshot> published; // Accessed with std::atomic_load/store
+    uint64_t version;
+    unsigned unpublished_changes;
+    std::chrono::steady_clock::time_point last_publish;
     
     size_t current_index;
     bool auto_advance_enabled;
     bool cue_system_enabled;
     
-    std::mutex playlist_mutex;
-    std::mutex queue_mutex;
+    mutable std::mutex playlist_mutex;
+    std::mutex index_mutex; // Serializes library index rewrites
+    
+    SearchIndex search_index;
+    SortIndex sort_index; // Guarded by playlist_mutex
+    
+    std::unique_ptr<LibraryWatcher> watcher;
+    
+    // Lazy loading: the library is scanned on library_thread and published as
+    // path-only tracks; resolver threads then read tags, the current and
+    // upcoming tracks first. All guarded by playlist_mutex.
+    std::thread library_thread;
+    std::vector<std::thread> resolver_threads;
+    std::condition_variable library_cv;  // First tracks published / load done
+    std::condition_variable resolver_cv; // Pending work or shutdown
+    // Abandons library scans in progress; set once, on destruction
+    std::atomic<bool> cancel_scans;
+    // Abandons the load on library_thread only: set on destruction or when a
+    // playlist file replaces the library. Never cleared, as there is one load.
+    std::atomic<bool> library_load_cancel;
+    // Held while library_thread or validator_thread is joined or replaced,
+    // so concurrent playlist loads and the destructor join each only once
+    std::mutex thread_owner_mutex;
+    bool library_loaded;
+    bool resolver_running;
+    bool scanning;
+    bool index_dirty;                    // Library changed since the index was written
+    bool library_backed;                 // Table holds the scanned library, not a playlist file
+    size_t pending_metadata;
+    std::deque<TrackId> resolve_queue;   // Rows found pending, in arrival order; stale IDs are skipped
+    std::set<TrackId> resolving;         // Claimed by a resolver thread
+    
+    // Playlist files: a validator thread checks entries exist after loading.
+    // Loading another playlist bumps the generation, which stops it.
+    std::thread validator_thread;
+    uint64_t playlist_generation;
+    std::vector<std::string> invalid_entries;
+    
+    void scan_library(bool rescan, const std::atomic<bool>& stop);
+    void start_watcher();
+    void start_background_load();
+    void start_resolvers();
+    void install_playlist(const std::vector<Track>& tracks);
+    void validate_playlist_loop(uint64_t generation);
+    void resolve_metadata_loop();
+    bool claim_metadata_work(std::vector<std::pair<TrackId, Track>>& work);
+    void wake_resolvers(size_t queued);
+    bool take_index_snapshot(TrackTable& snapshot);
+    void save_library_index(const TrackTable& snapshot);
+    
+    // Helpers below are called with playlist_mutex held
+    enum PublishFlags : unsigned {
+        PUBLISH_POSITION = 0,  // Only current_index or counters changed
+        PUBLISH_TRACKS = 1,    // Rows added, updated or removed
+        PUBLISH_ORDER = 2,     // Playlist order changed
+        PUBLISH_QUEUE = 4      // Play queue changed
+    };
+    void publish(unsigned changes);
+    // For bulk writers (scan, resolver): publish at most every PUBLISH_INTERVAL
+    void publish_batched(unsigned changes);
+    void append_track(const Track& track);
+    // The current playlist track; playing_queued may be playing instead
+    std::optional<TrackId> current_track_id() const;
+    // Step current_index on, drawing a new permutation when a shuffle wraps
+    unsigned advance();
+    void restore_current(std::optional<TrackId> id);
+    // A new row joins the playlist (subject to the smart playlist rules)
+    void admit(TrackId id);
+    // Re-check a changed row against the smart playlist; true if order changed
+    bool refresh_membership(TrackId id);
+    void remove_from_order(TrackId id);
+    // Draw a new permutation of order, the current track (if any) first
+    void reshuffle();
+    // Forget the shuffle; a new order replaces the listed one
+    void end_shuffle();
     
     // Playlist format parsers
     bool load_m3u(const std::string& filepath);
     bool load_pls(const std::string& filepath);
+    bool load_smart(const std::string& filepath);
+    bool load_binary(const std::string& filepath);
     bool save_m3u(const std::string& filepath);
     bool save_pls(const std::string& filepath);
+    std::string display_title(TrackId id) const;
     
     bool is_supported_format(const std::string& ext);
 };
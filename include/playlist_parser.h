@@ -0,0 +1,27 @@
+// playlist_parser.h - Single-pass, memory-mapped M3U and PLS parsing
+#ifndef PLAYLIST_PARSER_H
+#define PLAYLIST_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "playlist_manager.h"
+
+// Turns a playlist file into tracks without touching the files it lists.
+// The playlist is mapped read-only and scanned once; relative paths are
+// resolved against the playlist's directory. Entries with EXTINF (M3U) or
+// Title/Length (PLS) data take their title, artist and duration from it;
+// the rest come back as placeholders with metadata_pending set, titled by
+// file name. Whether the files exist is left to the caller.
+class PlaylistParser
+{
+public:
+    static bool parse_m3u(const std::string &filepath, std::vector<Track> &tracks);
+    static bool parse_pls(const std::string &filepath, std::vector<Track> &tracks);
+
+    // Parsers over text already in memory; base_dir may be empty
+    static void parse_m3u_text(std::string_view text, const std::string &base_dir, std::vector<Track> &tracks);
+    static void parse_pls_text(std::string_view text, const std::string &base_dir, std::vector<Track> &tracks);
+};
+
+#endif // PLAYLIST_PARSER_H
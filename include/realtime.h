@@ -0,0 +1,40 @@
+// realtime.h - Thread scheduling, CPU pinning and memory locking per thread role
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <string>
+#include <cstddef>
+#include "config.h"
+
+enum class ThreadRole
+{
+    AUDIO,   // miniaudio device callback (decode + mix + FFT)
+    DECODER, // Opening and pre-decoding the next track (AudioEngine::decoder_loop)
+    ENCODER, // Per-listener and libshout encode/send loops
+    NETWORK, // HTTP accept loop and request handlers
+    SCANNER  // Library scanning and metadata extraction
+};
+
+// Applies the `rt_<role>_*` settings from Config. Every step degrades
+// gracefully: SCHED_FIFO/RR falls back to a nice level when the process lacks
+// the privilege, and failures are reported rather than fatal. What was
+// actually achieved is logged once per role and available from report().
+class Realtime
+{
+public:
+    // Store settings and lock/prefault memory if rt_mlock is set. Call once at startup.
+    static void configure(const Config &config);
+
+    // Apply the role's scheduling class and CPU affinity to the calling thread
+    static void apply_to_current_thread(ThreadRole role);
+
+    // Touch every page of a buffer so the first real-time access does not fault
+    static void prefault(void *data, size_t bytes);
+
+    // Human-readable summary of what was achieved per role
+    static std::string report();
+
+    static const char *role_name(ThreadRole role);
+};
+
+#endif // REALTIME_H
@@ -0,0 +1,90 @@
+// search_index.h - Incremental full-text, prefix and fuzzy track search
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "track_table.h"
+
+struct SearchHit
+{
+    TrackId id;
+    float score;
+};
+
+// Inverted index over title, artist, album and genre. Every query word must
+// match one of a track's words, either exactly, as a prefix, or (for words of
+// four or more letters) by trigram similarity, which tolerates typos. Words
+// are folded like collation keys, so case and accents do not matter. Title
+// matches outrank artist, album and genre matches.
+//
+// sync() diffs a table against what was indexed and re-indexes only the rows
+// whose strings changed, so keeping up with a growing or changing library is
+// cheap. Queries and syncs may run concurrently from any thread.
+class SearchIndex
+{
+public:
+    void sync(const std::shared_ptr<const TrackTable> &tracks);
+
+    // Best `limit` matches, highest score first
+    std::vector<SearchHit> search(std::string_view query, size_t limit) const;
+
+    size_t term_count() const;
+
+    // Folded words as Collation::words() splits them, for rows and queries alike
+    static void tokenize(std::string_view text, std::vector<std::string> &words);
+
+private:
+    struct Posting
+    {
+        TrackId id;
+        uint8_t fields; // FIELD_* bits the word occurs in
+    };
+
+    struct RowSignature
+    {
+        uint32_t title = 0, artist = 0, album = 0, genre = 0;
+        bool alive = false;
+
+        bool operator==(const RowSignature &o) const
+        {
+            return title == o.title && artist == o.artist && album == o.album && genre == o.genre && alive == o.alive;
+        }
+    };
+
+    struct TermMatch
+    {
+        uint32_t term;
+        float weight;
+    };
+
+    // Term ids of an interned string, keyed by its ID; valid for one sync
+    using FieldTerms = std::unordered_map<uint32_t, std::vector<uint32_t>>;
+
+    void clear();
+    void index_row(const TrackTable &tracks, TrackId id, FieldTerms &field_terms);
+    void unindex_row(TrackId id);
+    uint32_t term_id(const std::string &word);
+    void expand(const std::string &word, std::vector<TermMatch> &matches) const;
+
+    mutable std::shared_mutex mutex;
+    std::weak_ptr<const TrackTable> indexed; // Table version last synced
+    uint64_t lineage = 0;
+
+    std::map<std::string, uint32_t> dictionary; // Sorted for prefix ranges
+    std::unordered_map<std::string_view, uint32_t> lookup; // Same terms, for exact matches
+    std::vector<const std::string *> term_text; // Term id -> dictionary key
+    std::vector<std::vector<Posting>> postings; // Term id -> tracks, by ID
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams; // Trigram -> term ids
+
+    std::vector<RowSignature> rows;            // What each row was indexed with
+    std::vector<std::vector<uint32_t>> row_terms; // Row -> term ids, for removal
+};
+
+#endif // SEARCH_INDEX_H
@@ -0,0 +1,29 @@
+// sha256.h - Incremental SHA-256 (FIPS 180-4) for content addressing
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Feed the bytes in any number of update() calls, then read hex_digest()
+// once. Not for secrets: there is no attempt at constant time.
+class Sha256
+{
+public:
+    Sha256();
+
+    void update(const void *data, size_t length);
+    // 64 lowercase hex digits; ends the computation
+    std::string hex_digest();
+
+private:
+    void compress(const uint8_t *chunk);
+
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered = 0;
+    uint64_t total_bytes = 0;
+};
+
+#endif // SHA256_H
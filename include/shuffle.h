@@ -0,0 +1,50 @@
+// shuffle.h - Artist-spreading shuffle and recent-play history
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "track_table.h"
+
+enum class ShuffleMode
+{
+    RANDOM, // Uniform permutation
+    SMART   // Same-artist tracks spread apart, and albums within an artist
+};
+
+// The last `capacity` distinct tracks played. Membership is one bit per
+// TrackId; a ring of IDs decides which bit to clear when a play falls out.
+class PlayHistory
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 512;
+
+    explicit PlayHistory(size_t capacity = DEFAULT_CAPACITY) : capacity(capacity) {}
+
+    void record(TrackId id);
+    bool contains(TrackId id) const { return id < recent.size() && recent[id]; }
+    size_t size() const { return ring.size(); }
+    void clear();
+
+private:
+    size_t capacity;
+    std::vector<TrackId> ring; // Oldest at `oldest` once full
+    size_t oldest = 0;
+    std::vector<bool> recent; // By TrackId
+};
+
+// Builds play orders over track IDs in O(n). Smart mode gives each artist's
+// tracks evenly spaced slots across the whole order, starting at a random
+// phase, then fills an artist's slots album by album in the same way, so
+// neither an artist nor an album comes up twice in a row unless it makes up
+// most of the playlist. Tracks in the history go to the end in either mode.
+class Shuffler
+{
+public:
+    static void shuffle(std::vector<TrackId> &ids, const TrackTable &tracks, ShuffleMode mode,
+                        const PlayHistory &history, std::mt19937_64 &rng);
+};
+
+#endif // SHUFFLE_H
@@ -0,0 +1,76 @@
+// smart_playlist.h - Rule-based playlists evaluated against the track table
+#ifndef SMART_PLAYLIST_H
+#define SMART_PLAYLIST_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "track_table.h"
+
+// A smart playlist (.smart file) selects tracks from the scanned library by
+// rules, one per line. A track belongs to the playlist if it matches every
+// rule, or any rule after a "match any" line:
+//
+//   # Nineties rock under six minutes, played at least once
+//   genre in Rock, Alternative, Grunge
+//   year 1990..1999
+//   duration ..360
+//   play_count >= 1
+//
+// Text fields (title, artist, album, genre, path) take "in a, b, c" or
+// "is a" (whole value, case-insensitive) or "~ part" (contains). Numeric
+// fields (year, duration in seconds, bitrate in kbps, bpm, play_count) take
+// a range "lo..hi" with either end optional, or "=", "<", "<=", ">", ">=".
+// Untagged years and BPMs match no numeric rule.
+//
+// Each rule reads one column of the table, numeric rules first, so matching
+// a track allocates nothing and usually stops at the first cheap rule.
+class SmartPlaylist
+{
+public:
+    bool load(const std::string &path, std::string &error);
+    bool parse(std::string_view text, std::string &error);
+
+    bool matches(const TrackTable &tracks, TrackId id) const;
+
+    size_t rule_count() const { return rules.size(); }
+    // Playing a track can change its membership
+    bool uses_play_count() const;
+
+    static bool is_smart_playlist(const std::string &path);
+
+private:
+    enum class Field
+    {
+        TITLE,
+        ARTIST,
+        ALBUM,
+        GENRE,
+        PATH,
+        YEAR,
+        DURATION,
+        BITRATE,
+        BPM,
+        PLAY_COUNT
+    };
+
+    struct Rule
+    {
+        Field field;
+        bool contains = false;           // Text: substring rather than whole value
+        std::vector<std::string> values; // Text: lowercased alternatives
+        int64_t min = std::numeric_limits<int64_t>::min(); // Numeric, inclusive
+        int64_t max = std::numeric_limits<int64_t>::max();
+    };
+
+    static bool is_numeric(Field field) { return field >= Field::YEAR; }
+    static bool parse_rule(std::string_view line, Rule &rule, std::string &error);
+    bool matches_rule(const TrackTable &tracks, TrackId id, const Rule &rule) const;
+
+    std::vector<Rule> rules;
+    bool match_any = false;
+};
+
+#endif // SMART_PLAYLIST_H
@@ -0,0 +1,84 @@
+// sort_index.h - Collation keys and cached multi-key sort orders
+#ifndef SORT_INDEX_H
+#define SORT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "track_table.h"
+
+enum class SortCriteria
+{
+    TITLE,    // Title, artist, album
+    ARTIST,   // Artist, album, disc, track number, title
+    ALBUM,    // Album, artist, disc, track number, title
+    DURATION  // Duration, title
+};
+
+// Sort keys for display strings. A key compares bytewise in the order a
+// listener expects: case-folded (ASCII, Latin-1, Latin Extended-A, Greek,
+// Cyrillic), accents and combining marks removed, punctuation ignored,
+// whitespace collapsed, and a leading "The", "A" or "An" dropped.
+class Collation
+{
+public:
+    static std::string key(std::string_view text);
+    // The same folding split into words at whitespace and punctuation,
+    // articles kept, for search terms: "Björk" and "BJORK" both give "bjork"
+    static void words(std::string_view text, std::vector<std::string> &words);
+};
+
+// Collation keys for every row of a table, and one sorted permutation of
+// the live rows per criterion. sync() recomputes keys only for rows whose
+// strings changed, normalizing each distinct artist or album once. Sorted
+// permutations are built on first use and kept: a few changed rows are
+// merged in, so sorting the library again is O(n) with few or no string
+// comparisons. Equal keys are ordered by TrackId, so every sort is
+// deterministic.
+//
+// Not thread-safe: use it from the thread that owns the table.
+class SortIndex
+{
+public:
+    void sync(const TrackTable &tracks);
+
+    // Every live row, sorted; valid until the next sync()
+    const std::vector<TrackId> &sorted(const TrackTable &tracks, SortCriteria criteria);
+    // Sort `ids` (live rows, repeats allowed) as sorted() orders them
+    void sort(const TrackTable &tracks, std::vector<TrackId> &ids, SortCriteria criteria);
+
+    size_t memory_bytes() const;
+
+private:
+    static constexpr size_t CRITERIA = 4;
+    // Up to 1/PATCH_MAX_FRACTION of the rows changed: merge instead of rebuild
+    static constexpr size_t PATCH_MAX_FRACTION = 8;
+
+    struct RowKeys
+    {
+        uint32_t title_source = 0, artist_source = 0, album_source = 0; // Table string IDs
+        uint32_t title = 0, artist = 0, album = 0;                      // Indexes into `keys`
+        int32_t duration = 0;
+        uint32_t position = 0; // Disc and track number
+        bool alive = false;
+    };
+
+    void clear();
+    template <typename Key>
+    bool row_less(SortCriteria criteria, TrackId a, TrackId b, Key key) const;
+    void patch(SortCriteria criteria, const std::vector<TrackId> &changed);
+    void build_ranks();
+    void build_sorted(SortCriteria criteria);
+
+    uint64_t lineage = 0;
+    uint64_t synced_modifications = 0;
+    std::vector<RowKeys> rows;
+    StringPool keys;                // Appended per distinct source string
+    std::vector<uint32_t> key_rank; // By key index; equal keys share a rank
+    std::vector<TrackId> permutations[CRITERIA];
+    bool permutation_valid[CRITERIA] = {};
+};
+
+#endif // SORT_INDEX_H
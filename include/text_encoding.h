@@ -0,0 +1,20 @@
+// text_encoding.h - Latin-1 and UTF-16 to UTF-8 transcoding for tag text
+#ifndef TEXT_ENCODING_H
+#define TEXT_ENCODING_H
+
+#include <string>
+#include <string_view>
+
+// Appends the UTF-8 form of `in` to `out`. ASCII runs, by far the common
+// case in tags, are checked and copied eight bytes (or four UTF-16 units)
+// at a time. Unpaired surrogates and a trailing odd byte become U+FFFD.
+class TextEncoding
+{
+public:
+    static void latin1_to_utf8(std::string_view in, std::string &out);
+    static void utf16_to_utf8(std::string_view in, bool big_endian, std::string &out);
+    // UTF-16 with an optional byte order mark; little-endian without one
+    static void utf16_bom_to_utf8(std::string_view in, std::string &out);
+};
+
+#endif // TEXT_ENCODING_H
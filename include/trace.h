@@ -0,0 +1,60 @@
+// trace.h - Scoped pipeline trace points with Chrome trace / Perfetto export
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <cstdint>
+
+// Each thread records into its own fixed-size ring, so recording never takes a
+// lock or allocates once the ring exists. When tracing is disabled a trace
+// point costs a single relaxed atomic load.
+//
+// Names and categories must be string literals (only the pointer is stored).
+class Tracer
+{
+public:
+    static void set_enabled(bool enable);
+    static bool is_enabled();
+
+    // Label the calling thread in the exported timeline
+    static void set_thread_name(const char *name);
+
+    static uint64_t now_ns();
+    static void record(const char *category, const char *name, uint64_t start_ns, uint64_t end_ns);
+
+    // Chrome trace event JSON ("Complete" events), loadable in chrome://tracing or ui.perfetto.dev
+    static std::string dump_chrome_json();
+    static bool dump_to_file(const std::string &path);
+
+    // Dump to `path` whenever `signum` is received (handled off the signal context)
+    static void install_dump_signal(int signum, const std::string &path);
+};
+
+class TraceScope
+{
+public:
+    TraceScope(const char *category, const char *name)
+        : category(category), name(name), start_ns(Tracer::is_enabled() ? Tracer::now_ns() : 0) {}
+
+    ~TraceScope()
+    {
+        if (start_ns != 0)
+        {
+            Tracer::record(category, name, start_ns, Tracer::now_ns());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *category;
+    const char *name;
+    uint64_t start_ns;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(category, name)
+
+#endif // TRACE_H
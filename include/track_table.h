@@ -0,0 +1,205 @@
+// track_table.h - Columnar track storage with interned strings and stable IDs
+#ifndef TRACK_TABLE_H
+#define TRACK_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Track;
+
+using TrackId = uint32_t;
+
+// Append-only string storage. Strings are identified by a 32-bit ID; ID 0 is
+// the empty string. intern() returns the existing ID for a repeated value
+// (artists, albums, genres, years); append() skips the lookup for values that
+// are nearly always unique (paths, titles). Bytes live in fixed-size blocks
+// that are never moved or rewritten, so snapshots share them with the pool
+// that is still being appended to.
+class StringPool
+{
+public:
+    static constexpr uint32_t EMPTY = 0;
+
+    StringPool();
+
+    uint32_t intern(std::string_view value);
+    uint32_t append(std::string_view value);
+
+    std::string_view get(uint32_t id) const
+    {
+        if (id == EMPTY)
+            return std::string_view();
+        const Span &span = spans[id / SPAN_CHUNK]->items[id % SPAN_CHUNK];
+        return std::string_view(blocks[span.position / BLOCK_SIZE]->bytes + span.position % BLOCK_SIZE, span.length);
+    }
+
+    size_t size() const { return count; }
+    size_t data_bytes() const { return bytes_used; }
+    size_t memory_bytes() const;
+
+    // Read-only copy sharing every stored string, without the intern lookup
+    StringPool snapshot() const;
+
+private:
+    static constexpr size_t BLOCK_SIZE = 256 * 1024; // Longer strings are truncated
+    static constexpr size_t SPAN_CHUNK = 4096;
+
+    struct Span
+    {
+        uint32_t position; // Block index * BLOCK_SIZE + offset
+        uint32_t length;
+    };
+    struct Block
+    {
+        char bytes[BLOCK_SIZE];
+    };
+    struct SpanChunk
+    {
+        Span items[SPAN_CHUNK];
+    };
+
+    std::vector<std::shared_ptr<Block>> blocks;
+    std::vector<std::shared_ptr<SpanChunk>> spans;
+    size_t count = 0;
+    size_t block_used = BLOCK_SIZE; // Bytes used in blocks.back()
+    size_t bytes_used = 0;
+    std::unordered_multimap<size_t, uint32_t> interned; // Hash -> id
+};
+
+// Tracks stored column by column. A TrackId is a row number that stays valid
+// for the lifetime of the table: removed rows are tombstoned rather than
+// reused, so IDs held by playlists, queues and API cursors never silently
+// point at a different file. Sorting and filtering touch only the columns
+// they need; Track objects are materialized on demand for callers that want one.
+//
+// Rows are grouped in fixed-size segments. snapshot() returns a read-only
+// table sharing every segment; the first later write to a segment copies it,
+// so publishing a snapshot costs O(segments) rather than O(rows).
+class TrackTable
+{
+public:
+    TrackTable() = default;
+    TrackTable(TrackTable &&) = default;
+    TrackTable &operator=(TrackTable &&) = default;
+    TrackTable(const TrackTable &) = delete;
+    TrackTable &operator=(const TrackTable &) = delete;
+
+    TrackId add(const Track &track);
+    // Replace a row's metadata; the path is unchanged
+    void update(TrackId id, const Track &track);
+    void remove(TrackId id);
+    void clear();
+    // Play counts belong to the row, not its metadata: update() keeps them
+    void add_play(TrackId id);
+
+    // Rewrite the string pool without dead strings; TrackIds are unchanged
+    void compact();
+    bool needs_compaction() const;
+
+    // Read-only copy for readers on other threads, which stays valid while
+    // this table keeps changing. Snapshots have no path lookup: find() on
+    // one always fails.
+    TrackTable snapshot();
+
+    std::optional<TrackId> find(std::string_view path) const;
+
+    size_t row_count() const { return rows; }
+    size_t size() const { return live_rows; }
+    bool alive(TrackId id) const { return id < rows && (row(id).flags[slot(id)] & ALIVE); }
+
+    Track get(TrackId id) const;
+
+    std::string_view path(TrackId id) const { return strings.get(row(id).path[slot(id)]); }
+    std::string_view title(TrackId id) const;
+    std::string_view artist(TrackId id) const { return strings.get(row(id).artist[slot(id)]); }
+    std::string_view album(TrackId id) const { return strings.get(row(id).album[slot(id)]); }
+    std::string_view year(TrackId id) const { return strings.get(row(id).year[slot(id)]); }
+    std::string_view genre(TrackId id) const { return strings.get(row(id).genre[slot(id)]); }
+
+    // Interned IDs: equal values have equal IDs, useful for grouping
+    uint32_t artist_id(TrackId id) const { return row(id).artist[slot(id)]; }
+    uint32_t album_id(TrackId id) const { return row(id).album[slot(id)]; }
+    uint32_t genre_id(TrackId id) const { return row(id).genre[slot(id)]; }
+    // Changes whenever the title does (EMPTY while it derives from the path)
+    uint32_t title_id(TrackId id) const { return row(id).title[slot(id)]; }
+
+    // Identifies this table and its snapshots. String IDs and rows are only
+    // comparable between tables of the same lineage; clear() and compact()
+    // (which renumbers strings) start a new one.
+    uint64_t lineage() const { return lineage_id; }
+    // Bumped by every add, update, removal and compaction (not by plays), so
+    // derived data such as sort orders can tell whether it is still current
+    uint64_t modification_count() const { return modifications; }
+
+    int32_t duration_ms(TrackId id) const { return row(id).duration[slot(id)]; }
+    int32_t bitrate(TrackId id) const { return row(id).bitrate[slot(id)]; }
+    int32_t bpm(TrackId id) const { return row(id).bpm[slot(id)]; }
+    int32_t disc(TrackId id) const { return row(id).disc[slot(id)]; }
+    int32_t track_number(TrackId id) const { return row(id).track_number[slot(id)]; }
+    uint32_t play_count(TrackId id) const { return row(id).plays[slot(id)]; }
+    uint64_t file_size(TrackId id) const { return row(id).size[slot(id)]; }
+    int64_t mtime_ns(TrackId id) const { return row(id).mtime[slot(id)]; }
+    uint64_t art_offset(TrackId id) const { return row(id).art_offset[slot(id)]; }
+    uint32_t art_length(TrackId id) const { return row(id).art_length[slot(id)]; }
+    bool metadata_pending(TrackId id) const { return (row(id).flags[slot(id)] & METADATA_PENDING) != 0; }
+    size_t count_metadata_pending() const;
+
+    const StringPool &string_pool() const { return strings; }
+    size_t memory_bytes() const;
+
+private:
+    static constexpr size_t SEGMENT_ROWS = 4096;
+
+    enum : uint8_t
+    {
+        ALIVE = 1,
+        METADATA_PENDING = 2
+    };
+
+    struct Segment
+    {
+        uint64_t generation; // Writable only while equal to the table's
+        uint32_t path[SEGMENT_ROWS];
+        uint32_t title[SEGMENT_ROWS]; // EMPTY for placeholders: title derives from the path
+        uint32_t artist[SEGMENT_ROWS];
+        uint32_t album[SEGMENT_ROWS];
+        uint32_t year[SEGMENT_ROWS];
+        uint32_t genre[SEGMENT_ROWS];
+        int32_t duration[SEGMENT_ROWS];
+        int32_t bitrate[SEGMENT_ROWS];
+        uint16_t bpm[SEGMENT_ROWS];
+        uint16_t disc[SEGMENT_ROWS];
+        uint16_t track_number[SEGMENT_ROWS];
+        uint32_t plays[SEGMENT_ROWS];
+        uint64_t size[SEGMENT_ROWS];
+        int64_t mtime[SEGMENT_ROWS];
+        uint64_t art_offset[SEGMENT_ROWS];
+        uint32_t art_length[SEGMENT_ROWS];
+        uint8_t flags[SEGMENT_ROWS];
+    };
+
+    const Segment &row(TrackId id) const { return *segments[id / SEGMENT_ROWS]; }
+    static size_t slot(TrackId id) { return id % SEGMENT_ROWS; }
+    Segment &writable(TrackId id);
+    void set_metadata(TrackId id, const Track &track);
+    static uint64_t next_lineage();
+
+    StringPool strings;
+    std::vector<std::shared_ptr<Segment>> segments;
+    size_t rows = 0;
+    uint64_t generation = 0; // Bumped by snapshot(); older segments are shared
+    uint64_t lineage_id = next_lineage();
+    uint64_t modifications = 0;
+
+    std::unordered_multimap<size_t, TrackId> by_path; // Path hash -> live row
+    size_t live_rows = 0;
+    size_t dead_string_bytes = 0; // Pool bytes no live row refers to
+};
+
+#endif // TRACK_TABLE_H
@@ -43,7 +43,10 @@ private:
     void print_controls();
     void handle_input();
     void load_current_track();
+    void preload_next_track();
     void show_track_list();
+    void show_queue();
+    void search_prompt();
     void cycle_theme();
 };
 
@@ -0,0 +1,282 @@
+#include "art_cache.h"
+#include "library_index.h"
+#include "logger.h"
+#include "sha256.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iterator>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct ImageType
+    {
+        std::string_view magic;
+        size_t magic_offset;
+        const char *extension;
+        const char *mime_type;
+    };
+
+    // Identified by content; the MIME type a tag claims is often wrong.
+    // The last entry matches anything.
+    const ImageType IMAGE_TYPES[] = {
+        {std::string_view("\xFF\xD8\xFF", 3), 0, "jpg", "image/jpeg"},
+        {std::string_view("\x89PNG\r\n\x1A\n", 8), 0, "png", "image/png"},
+        {"GIF8", 0, "gif", "image/gif"},
+        {"WEBP", 8, "webp", "image/webp"},
+        {"BM", 0, "bmp", "image/bmp"},
+        {"", 0, "bin", "application/octet-stream"},
+    };
+
+    const ImageType &sniff(std::string_view image)
+    {
+        for (const ImageType &type : IMAGE_TYPES)
+        {
+            if (image.size() >= type.magic_offset + type.magic.size() &&
+                image.compare(type.magic_offset, type.magic.size(), type.magic) == 0)
+                return type;
+        }
+        return IMAGE_TYPES[std::size(IMAGE_TYPES) - 1];
+    }
+
+    constexpr size_t HASH_DIGITS = 64;                     // SHA-256 in hex
+    constexpr uint64_t MAX_IMAGE_BYTES = 16 * 1024 * 1024; // Larger "art" is a bad tag, not a cover
+    constexpr size_t COPY_CHUNK = 64 * 1024;               // Copied and hashed at a time
+
+    // "<hash>.<extension>" as written by extract(); nullptr for anything else
+    const ImageType *type_of_name(const std::string &name)
+    {
+        if (name.size() <= HASH_DIGITS + 1 || name[HASH_DIGITS] != '.' ||
+            name.find_first_not_of("0123456789abcdef") != HASH_DIGITS)
+            return nullptr;
+        for (const ImageType &type : IMAGE_TYPES)
+        {
+            if (name.compare(HASH_DIGITS + 1, std::string::npos, type.extension) == 0)
+                return &type;
+        }
+        return nullptr;
+    }
+
+    bool write_all(int fd, const char *data, size_t length)
+    {
+        while (length > 0)
+        {
+            ssize_t n = ::write(fd, data, length);
+            if (n <= 0)
+                return false;
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+}
+
+ArtCache::ArtCache(const std::string &directory, uint64_t max_bytes)
+    : directory(directory), max_bytes(max_bytes)
+{
+}
+
+bool ArtCache::open(const ArtSource &source, CachedArt &art)
+{
+    if (directory.empty() || source.length == 0 || source.length > MAX_IMAGE_BYTES)
+        return false;
+
+    std::string key = source.path + '\n' + std::to_string(source.file_size) + '\n' + std::to_string(source.mtime_ns) +
+                      '\n' + std::to_string(source.offset) + '\n' + std::to_string(source.length);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!loaded)
+            load();
+        auto known = by_source.find(key);
+        if (known != by_source.end())
+            return open_cached(known->second, art);
+    }
+
+    // Copied without the lock, so a large image on a slow disk does not hold
+    // up requests for images already cached
+    std::string tmp_path, name;
+    uint64_t size = 0;
+    if (!extract(source, tmp_path, name, size))
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files.find(name);
+    if (it != files.end())
+    {
+        unlink(tmp_path.c_str()); // Another track's copy of the same image
+    }
+    else if (rename(tmp_path.c_str(), (directory + "/" + name).c_str()) != 0)
+    {
+        LOG_WARN("art", "Failed to write art cache file: %s/%s", directory.c_str(), name.c_str());
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    else
+    {
+        recency.push_front(name);
+        it = files.emplace(name, Entry{size, recency.begin(), {}}).first;
+        total_bytes += size;
+    }
+    if (by_source.emplace(key, name).second)
+        it->second.sources.push_back(key);
+    return open_cached(name, art);
+}
+
+bool ArtCache::open_cached(const std::string &name, CachedArt &art)
+{
+    auto it = files.find(name);
+
+    // Opened before evicting, so the file outlives its directory entry
+    // for as long as the caller needs it
+    int fd = ::open((directory + "/" + name).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        forget(it);
+        return false;
+    }
+
+    touch(name);
+    art.fd = fd;
+    art.size = it->second.size;
+    art.hash = name.substr(0, HASH_DIGITS);
+    art.mime_type = type_of_name(name)->mime_type;
+    evict();
+    return true;
+}
+
+void ArtCache::load()
+{
+    loaded = true;
+
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec)
+    {
+        LOG_WARN("art", "Cannot create art cache directory %s: %s", directory.c_str(), ec.message().c_str());
+        return;
+    }
+
+    // Adopt what earlier runs extracted, most recently written first
+    std::vector<std::pair<fs::file_time_type, std::string>> found;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::string name = it->path().filename().string();
+        if (!it->is_regular_file(ec))
+            continue;
+        if (!type_of_name(name))
+        {
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0)
+                fs::remove(it->path(), ec); // Interrupted extraction
+            continue;
+        }
+        found.emplace_back(it->last_write_time(ec), name);
+    }
+    std::sort(found.begin(), found.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    for (const auto &[time, name] : found)
+    {
+        uint64_t size = fs::file_size(directory + "/" + name, ec);
+        if (ec)
+            continue;
+        recency.push_back(name);
+        files.emplace(name, Entry{size, std::prev(recency.end()), {}});
+        total_bytes += size;
+    }
+    evict();
+
+    LOG_INFO("art", "Art cache %s: %zu images, %llu KB", directory.c_str(), files.size(),
+             static_cast<unsigned long long>(total_bytes / 1024));
+}
+
+bool ArtCache::extract(const ArtSource &source, std::string &tmp_path, std::string &name, uint64_t &size) const
+{
+    // The offset is only meaningful for the file as it was indexed
+    uint64_t file_size = 0;
+    int64_t mtime_ns = 0;
+    if (!LibraryIndex::stat_file(source.path, file_size, mtime_ns) || file_size != source.file_size ||
+        mtime_ns != source.mtime_ns || source.offset > file_size || source.length > file_size - source.offset)
+        return false;
+
+    int in = ::open(source.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return false;
+
+    // Written to a temporary name and renamed once the hash is known, so a
+    // crash never leaves a truncated image under a valid name
+    tmp_path = directory + "/extract-XXXXXX.tmp";
+    int out = mkstemps(&tmp_path[0], 4);
+    if (out < 0)
+    {
+        LOG_WARN("art", "Cannot write to art cache: %s", directory.c_str());
+        ::close(in);
+        return false;
+    }
+
+    // Streamed through one buffer that also feeds the hash, so the image is
+    // never held in memory whole
+    Sha256 hash;
+    std::vector<char> buffer(COPY_CHUNK);
+    char magic[16] = {};
+    uint64_t done = 0;
+    bool read_ok = true, write_ok = true;
+    while (done < source.length && read_ok && write_ok)
+    {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(buffer.size(), source.length - done));
+        ssize_t n = pread(in, buffer.data(), want, static_cast<off_t>(source.offset + done));
+        read_ok = n > 0;
+        if (!read_ok)
+            break;
+        if (done < sizeof(magic))
+            memcpy(magic + done, buffer.data(), std::min<size_t>(static_cast<size_t>(n), sizeof(magic) - done));
+        hash.update(buffer.data(), static_cast<size_t>(n));
+        write_ok = write_all(out, buffer.data(), static_cast<size_t>(n));
+        done += static_cast<uint64_t>(n);
+    }
+    ::close(in);
+    write_ok = ::close(out) == 0 && write_ok;
+    if (!read_ok || !write_ok)
+    {
+        if (!write_ok)
+            LOG_WARN("art", "Failed to write art cache file: %s", tmp_path.c_str());
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    name = hash.hex_digest() + "." + sniff(std::string_view(magic, std::min<uint64_t>(done, sizeof(magic)))).extension;
+    size = done;
+    return true;
+}
+
+void ArtCache::touch(const std::string &name)
+{
+    auto it = files.find(name);
+    recency.splice(recency.begin(), recency, it->second.recency);
+}
+
+void ArtCache::forget(std::unordered_map<std::string, Entry>::iterator it)
+{
+    for (const std::string &key : it->second.sources)
+        by_source.erase(key);
+    total_bytes -= it->second.size;
+    recency.erase(it->second.recency);
+    files.erase(it);
+}
+
+void ArtCache::evict()
+{
+    // The most recent image stays even if it alone exceeds the limit
+    while (total_bytes > max_bytes && recency.size() > 1)
+    {
+        std::string name = recency.back();
+        unlink((directory + "/" + name).c_str());
+        forget(files.find(name));
+    }
+}
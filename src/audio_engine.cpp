@@ -1,18 +1,16 @@
 #include "audio_engine.h"
 #include "config.h"
+#include "trace.h"
+#include "logger.h"
+#include "realtime.h"
 #include <iostream>
+#include <algorithm>
 
 AudioEngine::AudioEngine(const Config &cfg)
     : config(cfg), is_playing(false), live_coding_enabled(false), muted(false), track_ended(false)
 {
     coder = std::make_unique<CoderMode>(config.sample_rate);
 
-    // Decoder config reserved for future advanced decoding support
-    (void)ma_decoder_config_init(
-        ma_format_f32,
-        2, // stereo
-        config.sample_rate);
-
     ma_device_config device_config = ma_device_config_init(ma_device_type_playback);
     device_config.playback.format = ma_format_f32;
     device_config.playback.channels = 2;
@@ -24,16 +22,30 @@ AudioEngine::AudioEngine(const Config &cfg)
     {
         throw std::runtime_error("Failed to initialize audio device");
     }
+
+    // Size and prefault the buffers the callback touches so it never page-faults
+    // or grows them on the audio thread
+    fft_scratch.resize(config.buffer_size * 4);
+    Realtime::prefault(fft_scratch.data(), fft_scratch.size() * sizeof(float));
+    stream_buffer.reserve(config.buffer_size * 2 * 16);
+    Realtime::prefault(stream_buffer.data(), stream_buffer.capacity() * sizeof(float));
+
+    decoder_thread = std::thread(&AudioEngine::decoder_loop, this);
 }
 
 AudioEngine::~AudioEngine()
 {
-    stop();
-    ma_device_uninit(&device);
-    if (decoder_initialized)
     {
-        ma_decoder_uninit(&decoder);
+        std::lock_guard<std::mutex> lock(request_mutex);
+        stopping = true;
     }
+    request_cv.notify_one();
+    decoder_thread.join();
+
+    stop();
+    ma_device_uninit(&device);
+    close_slot(slots[0]);
+    close_slot(slots[1]);
 }
 
 void AudioEngine::start()
@@ -51,24 +63,103 @@ void AudioEngine::stop()
     ma_device_stop(&device);
 }
 
-bool AudioEngine::load_track(const std::string &filepath)
+bool AudioEngine::open_slot(DecoderSlot &slot, const std::string &filepath)
 {
-    std::lock_guard<std::mutex> lock(audio_mutex);
+    TRACE_SCOPE("audio", "open_track");
+    close_slot(slot);
 
-    if (decoder_initialized)
+    // Decode to the device's format so the callback can copy frames as-is
+    ma_decoder_config decoder_config = ma_decoder_config_init(ma_format_f32, 2, config.sample_rate);
+    if (ma_decoder_init_file(filepath.c_str(), &decoder_config, &slot.decoder) != MA_SUCCESS)
     {
-        ma_decoder_uninit(&decoder);
-        decoder_initialized = false;
+        return false;
     }
+    slot.initialized = true;
+    slot.filepath = filepath;
+
+    // The first periods are decoded here rather than on the audio thread;
+    // the buffer is kept for the slot's next track
+    slot.preroll.resize(config.buffer_size * PREROLL_PERIODS * 2);
+    ma_uint64 frames = 0;
+    ma_decoder_read_pcm_frames(&slot.decoder, slot.preroll.data(), config.buffer_size * PREROLL_PERIODS, &frames);
+    slot.preroll_frames = static_cast<size_t>(frames);
+    return true;
+}
 
-    if (ma_decoder_init_file(filepath.c_str(), NULL, &decoder) != MA_SUCCESS)
+void AudioEngine::close_slot(DecoderSlot &slot)
+{
+    if (slot.initialized)
     {
-        return false;
+        ma_decoder_uninit(&slot.decoder);
+        slot.initialized = false;
     }
+    slot.filepath.clear();
+    slot.preroll_frames = 0;
+}
 
-    decoder_initialized = true;
-    current_track = filepath;
-    track_ended = false;  // Reset track ended flag when loading new track
+void AudioEngine::preload_track(const std::string &filepath)
+{
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        preload_request = filepath;
+    }
+    request_cv.notify_one();
+}
+
+void AudioEngine::decoder_loop()
+{
+    Tracer::set_thread_name("decoder");
+    Realtime::apply_to_current_thread(ThreadRole::DECODER);
+
+    std::unique_lock<std::mutex> lock(request_mutex);
+    while (true)
+    {
+        request_cv.wait(lock, [this]() { return stopping || !preload_request.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+        std::string filepath = std::move(preload_request);
+        preload_request.clear();
+        lock.unlock();
+
+        {
+            // A load_track() racing this waits here and then finds the slot filled
+            std::lock_guard<std::mutex> preload_lock(preload_mutex);
+            DecoderSlot &spare = slots[1 - active];
+            if (!(spare.initialized && spare.filepath == filepath) && !open_slot(spare, filepath))
+            {
+                LOG_WARN("audio", "Failed to preload %s", filepath.c_str());
+            }
+        }
+        lock.lock();
+    }
+}
+
+bool AudioEngine::load_track(const std::string &filepath)
+{
+    std::lock_guard<std::mutex> preload_lock(preload_mutex);
+
+    // Opening a file that was not preloaded still happens off the audio lock
+    DecoderSlot &spare = slots[1 - active];
+    bool opened = (spare.initialized && spare.filepath == filepath) || open_slot(spare, filepath);
+
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        if (!opened)
+        {
+            // A failed load leaves silence rather than the previous track
+            close_slot(slots[active]);
+            return false;
+        }
+        active = 1 - active;
+        preroll_position = 0;
+        current_track = filepath;
+        track_ended = false; // Reset track ended flag when loading new track
+    }
+
+    // The previous track's decoder is out of the callback's reach now
+    close_slot(slots[1 - active]);
     return true;
 }
 
@@ -84,6 +175,7 @@ CoderMode *AudioEngine::get_coder_mode()
 
 std::vector<float> AudioEngine::get_stream_buffer(size_t frames)
 {
+    TRACE_SCOPE("audio", "stream_dequeue");
     std::unique_lock<std::mutex> lock(stream_mutex);
 
     size_t required_samples = frames * 2; // samples = frames * channels (2 for stereo)
@@ -133,6 +225,7 @@ std::vector<float> AudioEngine::get_stream_buffer(size_t frames)
 
 void AudioEngine::add_to_stream_queue(const std::vector<float> &buffer)
 {
+    TRACE_SCOPE("audio", "stream_enqueue");
     std::lock_guard<std::mutex> lock(stream_mutex);
     stream_queue.push_back(buffer);
     if (stream_queue.size() > 10)
@@ -163,6 +256,15 @@ void AudioEngine::data_callback(ma_device *device, void *output, const void *inp
     AudioEngine *engine = static_cast<AudioEngine *>(device->pUserData);
     float *out = static_cast<float *>(output);
 
+    static thread_local bool thread_configured = false;
+    if (!thread_configured)
+    {
+        Tracer::set_thread_name("audio-callback");
+        Realtime::apply_to_current_thread(ThreadRole::AUDIO);
+        thread_configured = true;
+    }
+    TRACE_SCOPE("audio", "callback");
+
     std::lock_guard<std::mutex> lock(engine->audio_mutex);
 
     // Coder mode - generate audio procedurally (EXCLUSIVE MODE - do not play decoder)
@@ -173,20 +275,37 @@ void AudioEngine::data_callback(ma_device *device, void *output, const void *inp
         static bool logged = false;
         if (!logged)
         {
-            std::cout << "[AUDIO] Coder mode ACTIVE - generating procedural audio" << std::endl;
+            LOG_INFO("audio", "Coder mode ACTIVE - generating procedural audio");
             logged = true;
         }
     }
     // Normal playback mode (ONLY if not in coder mode)
-    else if (engine->decoder_initialized && engine->is_playing)
+    else if (engine->slots[engine->active].initialized && engine->is_playing)
     {
-        ma_uint64 frames_read;
-        ma_decoder_read_pcm_frames(&engine->decoder, out, frame_count, &frames_read);
+        DecoderSlot &slot = engine->slots[engine->active];
+        ma_uint64 frames_read = 0;
+        {
+            TRACE_SCOPE("audio", "decode");
+            // The preloaded start of the track first, then the decoder
+            if (engine->preroll_position < slot.preroll_frames)
+            {
+                size_t frames = std::min<size_t>(frame_count, slot.preroll_frames - engine->preroll_position);
+                std::copy_n(slot.preroll.data() + engine->preroll_position * 2, frames * 2, out);
+                engine->preroll_position += frames;
+                frames_read = frames;
+            }
+            if (frames_read < frame_count)
+            {
+                ma_uint64 decoded = 0;
+                ma_decoder_read_pcm_frames(&slot.decoder, out + frames_read * 2, frame_count - frames_read, &decoded);
+                frames_read += decoded;
+            }
+        }
 
         static bool logged_decoder = false;
         if (!logged_decoder)
         {
-            std::cout << "[AUDIO] Decoder mode ACTIVE - playing MP3 files" << std::endl;
+            LOG_INFO("audio", "Decoder mode ACTIVE - playing MP3 files");
             logged_decoder = true;
         }
 
@@ -241,17 +360,22 @@ void AudioEngine::data_callback(ma_device *device, void *output, const void *inp
 
 void AudioEngine::calculate_fft(float *samples, size_t frame_count)
 {
+    TRACE_SCOPE("audio", "fft_update");
     std::lock_guard<std::mutex> lock(fft_mutex);
 
-    // Convert stereo to mono
-    std::vector<float> mono(frame_count);
+    // Convert stereo to mono (scratch is preallocated; only grows if the device
+    // delivers a larger period than configured)
+    if (fft_scratch.size() < frame_count)
+    {
+        fft_scratch.resize(frame_count);
+    }
     for (size_t i = 0; i < frame_count; ++i)
     {
-        mono[i] = (samples[i * 2] + samples[i * 2 + 1]) * 0.5f;
+        fft_scratch[i] = (samples[i * 2] + samples[i * 2 + 1]) * 0.5f;
     }
 
     // Perform real FFT analysis
-    current_fft.magnitudes = SimpleFFT::analyze(mono.data(), frame_count, 64);
+    current_fft.magnitudes = SimpleFFT::analyze(fft_scratch.data(), frame_count, 64);
 
     // Calculate frequency bands
     SimpleFFT::calculate_bands(current_fft.magnitudes,
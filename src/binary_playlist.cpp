@@ -0,0 +1,200 @@
+#include "binary_playlist.h"
+#include "playlist_manager.h"
+#include "logger.h"
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace binary_playlist;
+
+namespace
+{
+    // Stores each distinct string once; artists, albums and genres repeat
+    class StringTableBuilder
+    {
+    public:
+        StringRef add(std::string_view value)
+        {
+            auto it = offsets.find(value);
+            if (it != offsets.end())
+            {
+                return {it->second, static_cast<uint32_t>(value.size())};
+            }
+            uint32_t offset = static_cast<uint32_t>(data.size());
+            data.append(value.data(), value.size());
+            offsets.emplace(value, offset);
+            return {offset, static_cast<uint32_t>(value.size())};
+        }
+
+        const std::string &bytes() const { return data; }
+
+    private:
+        std::string data;
+        // Views into the track table being saved, which outlives the builder
+        std::unordered_map<std::string_view, uint32_t> offsets;
+    };
+}
+
+BinaryPlaylist::~BinaryPlaylist()
+{
+    close();
+}
+
+bool BinaryPlaylist::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(PlaylistHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mapping_size = static_cast<size_t>(st.st_size);
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        mapping_size = 0;
+        return false;
+    }
+
+    const auto *header = static_cast<const PlaylistHeader *>(mapping);
+    bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header->version == VERSION &&
+                 header->header_size == sizeof(PlaylistHeader) &&
+                 header->record_size == sizeof(PlaylistRecord) &&
+                 header->entry_count <= (mapping_size - sizeof(PlaylistHeader)) / sizeof(PlaylistRecord) &&
+                 header->strings_offset >= sizeof(PlaylistHeader) + header->entry_count * sizeof(PlaylistRecord) &&
+                 header->strings_offset <= mapping_size &&
+                 header->strings_size <= mapping_size - header->strings_offset;
+    if (!valid)
+    {
+        LOG_WARN("playlist", "Not a playlist in a supported binary format: %s", path.c_str());
+        close();
+        return false;
+    }
+
+    entry_count = static_cast<size_t>(header->entry_count);
+    strings = static_cast<const char *>(mapping) + header->strings_offset;
+    strings_size = header->strings_size;
+    return true;
+}
+
+void BinaryPlaylist::close()
+{
+    if (mapping)
+    {
+        munmap(mapping, mapping_size);
+    }
+    mapping = nullptr;
+    mapping_size = 0;
+    entry_count = 0;
+    strings = nullptr;
+    strings_size = 0;
+}
+
+const PlaylistRecord *BinaryPlaylist::record_at(size_t i) const
+{
+    return reinterpret_cast<const PlaylistRecord *>(static_cast<const char *>(mapping) + sizeof(PlaylistHeader)) + i;
+}
+
+std::string_view BinaryPlaylist::string_at(StringRef ref) const
+{
+    // Out-of-range references (a damaged file) read as empty
+    if (static_cast<uint64_t>(ref.offset) + ref.length > strings_size)
+    {
+        return std::string_view();
+    }
+    return std::string_view(strings + ref.offset, ref.length);
+}
+
+Track BinaryPlaylist::get(size_t i) const
+{
+    const PlaylistRecord *record = record_at(i);
+    Track track{std::string(string_at(record->path))};
+    track.title = std::string(string_at(record->title));
+    track.artist = std::string(string_at(record->artist));
+    track.album = std::string(string_at(record->album));
+    track.year = std::string(string_at(record->year));
+    track.genre = std::string(string_at(record->genre));
+    track.duration_ms = record->duration_ms;
+    track.bitrate = record->bitrate;
+    track.bpm = record->bpm;
+    track.disc = record->disc;
+    track.track_number = record->track_number;
+    track.metadata_pending = (record->flags & RECORD_METADATA_PENDING) != 0;
+    return track;
+}
+
+bool BinaryPlaylist::save(const std::string &path, const TrackTable &tracks, const std::vector<TrackId> &order)
+{
+    StringTableBuilder table;
+    std::vector<PlaylistRecord> records;
+    records.reserve(order.size());
+
+    for (TrackId id : order)
+    {
+        if (!tracks.alive(id))
+            continue;
+
+        PlaylistRecord record;
+        memset(&record, 0, sizeof(record));
+        record.path = table.add(tracks.path(id));
+        record.title = table.add(tracks.string_pool().get(tracks.title_id(id))); // Stored, not the file-name fallback
+        record.artist = table.add(tracks.artist(id));
+        record.album = table.add(tracks.album(id));
+        record.year = table.add(tracks.year(id));
+        record.genre = table.add(tracks.genre(id));
+        record.duration_ms = tracks.duration_ms(id);
+        record.bitrate = tracks.bitrate(id);
+        record.bpm = tracks.bpm(id);
+        record.disc = tracks.disc(id);
+        record.track_number = tracks.track_number(id);
+        record.flags = tracks.metadata_pending(id) ? uint32_t(RECORD_METADATA_PENDING) : 0u;
+        records.push_back(record);
+    }
+
+    PlaylistHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.header_size = sizeof(PlaylistHeader);
+    header.record_size = sizeof(PlaylistRecord);
+    header.entry_count = records.size();
+    header.strings_offset = sizeof(PlaylistHeader) + records.size() * sizeof(PlaylistRecord);
+    header.strings_size = table.bytes().size();
+
+    std::string tmp_path = path + ".tmp";
+    FILE *out = fopen(tmp_path.c_str(), "wb");
+    if (!out)
+    {
+        LOG_WARN("playlist", "Cannot write playlist: %s", tmp_path.c_str());
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              (records.empty() || fwrite(records.data(), sizeof(PlaylistRecord), records.size(), out) == records.size()) &&
+              (table.bytes().empty() || fwrite(table.bytes().data(), 1, table.bytes().size(), out) == table.bytes().size());
+    ok = fclose(out) == 0 && ok;
+
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        LOG_WARN("playlist", "Failed to write playlist: %s", path.c_str());
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
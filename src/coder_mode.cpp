@@ -1,4 +1,5 @@
 #include "coder_mode.h"
+#include "trace.h"
 
 CoderMode::CoderMode(int sr)
     : sample_rate(sr), recording(false), record_start_frame(0), playback_frame(0)
@@ -99,6 +100,7 @@ void CoderMode::stop_sequence(int sequence_id)
 
 void CoderMode::process(float *output, size_t frame_count)
 {
+    TRACE_SCOPE("coder", "mix");
     std::lock_guard<std::mutex> lock(mutex);
 
     // Clear output
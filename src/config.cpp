@@ -92,6 +92,46 @@ void Config::parse_line(const std::string &line)
     {
         music_directory = value;
     }
+    else if (key == "playlist_file")
+    {
+        playlist_file = value;
+    }
+    else if (key == "library_index_file")
+    {
+        library_index_file = value;
+    }
+    else if (key == "scan_threads")
+    {
+        scan_threads = std::stoi(value);
+    }
+    else if (key == "lazy_metadata")
+    {
+        lazy_metadata = parse_bool(value);
+    }
+    else if (key == "watch_library")
+    {
+        watch_library = parse_bool(value);
+    }
+    else if (key == "watch_debounce_ms")
+    {
+        watch_debounce_ms = std::stoi(value);
+    }
+    else if (key == "scan_max_tag_mb")
+    {
+        scan_max_tag_mb = std::stoi(value);
+    }
+    else if (key == "scan_timeout_ms")
+    {
+        scan_timeout_ms = std::stoi(value);
+    }
+    else if (key == "art_cache_dir")
+    {
+        art_cache_dir = value;
+    }
+    else if (key == "art_cache_max_mb")
+    {
+        art_cache_max_mb = std::stoi(value);
+    }
     else if (key == "stream_host")
     {
         stream_host = value;
@@ -132,6 +172,54 @@ void Config::parse_line(const std::string &line)
     {
         buffer_size = std::stoi(value);
     }
+    else if (key == "rt_mlock")
+    {
+        rt_mlock = parse_bool(value);
+    }
+    else if (key.rfind("rt_", 0) == 0 && key.find('_', 3) != std::string::npos)
+    {
+        // rt_<role>_<field>
+        size_t sep = key.find('_', 3);
+        ThreadSchedConfig &sched = thread_sched[key.substr(3, sep - 3)];
+        std::string field = key.substr(sep + 1);
+        if (field == "policy")
+            sched.policy = value;
+        else if (field == "priority")
+            sched.priority = std::stoi(value);
+        else if (field == "nice")
+            sched.nice = std::stoi(value);
+        else if (field == "cpus")
+            sched.cpus = value;
+    }
+    else if (key == "log_level")
+    {
+        log_level = value;
+    }
+    else if (key == "log_file")
+    {
+        log_file = value;
+    }
+    else if (key == "log_syslog")
+    {
+        log_syslog = parse_bool(value);
+    }
+    else if (key == "log_rate_limit")
+    {
+        log_rate_limit = std::stoi(value);
+    }
+    else if (key == "trace_enabled")
+    {
+        trace_enabled = parse_bool(value);
+    }
+    else if (key == "trace_file")
+    {
+        trace_file = value;
+    }
+}
+
+bool Config::parse_bool(const std::string &value)
+{
+    return value == "true" || value == "1" || value == "yes" || value == "on";
 }
 
 std::string Config::trim(const std::string &str)
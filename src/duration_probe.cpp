@@ -0,0 +1,472 @@
+#include "duration_probe.h"
+#include "file_reader.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Bounds-checked access to the file's bytes. `head` holds the file's
+    // first bytes (all of them when there is no reader); anything past it is
+    // read from `file`. Headers are copied into small zero-filled buffers;
+    // longer scans read the head in place or into a scratch buffer.
+    class ByteView
+    {
+    public:
+        ByteView(std::string_view head, const FileReader *file)
+            : data(reinterpret_cast<const uint8_t *>(head.data())), cached(head.size()),
+              length(file ? file->size() : head.size()), reader(file) {}
+
+        uint64_t size() const { return length; }
+
+        // Up to `count` bytes at `offset`; fewer at the end of the file
+        size_t read_some(uint64_t offset, void *out, size_t count) const
+        {
+            if (offset >= length)
+                return 0;
+            size_t n = static_cast<size_t>(std::min<uint64_t>(count, length - offset));
+            if (offset + n <= cached)
+            {
+                memcpy(out, data + offset, n);
+                return n;
+            }
+            return reader ? reader->read_some(offset, out, n) : 0;
+        }
+        bool read(uint64_t offset, void *out, size_t count) const { return read_some(offset, out, count) == count; }
+
+        // The bytes from `offset`, at most `count` of them. Valid until the
+        // next call.
+        const uint8_t *at(uint64_t offset, size_t count, size_t &available) const
+        {
+            available = offset < length ? static_cast<size_t>(std::min<uint64_t>(count, length - offset)) : 0;
+            if (offset + available <= cached)
+                return data + offset;
+            scratch.resize(available);
+            available = read_some(offset, scratch.data(), available);
+            return scratch.data();
+        }
+
+    private:
+        const uint8_t *data;
+        uint64_t cached;
+        uint64_t length;
+        const FileReader *reader;
+        mutable std::vector<uint8_t> scratch;
+    };
+
+    uint32_t be32(const uint8_t *p) { return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 | p[3]; }
+    uint64_t be64(const uint8_t *p) { return static_cast<uint64_t>(be32(p)) << 32 | be32(p + 4); }
+    uint32_t le16(const uint8_t *p) { return p[0] | static_cast<uint32_t>(p[1]) << 8; }
+    uint32_t le32(const uint8_t *p) { return p[0] | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24; }
+    uint64_t le64(const uint8_t *p) { return le32(p) | static_cast<uint64_t>(le32(p + 4)) << 32; }
+
+    AudioProperties finish(uint64_t samples, uint32_t sample_rate, uint64_t audio_bytes)
+    {
+        AudioProperties props;
+        if (sample_rate == 0 || samples == 0)
+            return props;
+        uint64_t ms = samples * 1000 / sample_rate;
+        if (ms == 0 || ms > INT32_MAX)
+            return props;
+        props.duration_ms = static_cast<int>(ms);
+        props.bitrate_kbps = static_cast<int>(audio_bytes * 8 / ms);
+        props.sample_rate = static_cast<int>(sample_rate);
+        return props;
+    }
+
+    // Total size of the ID3v2 tag starting with `header` (footer included), or 0
+    uint64_t id3v2_size(const uint8_t *header)
+    {
+        if (memcmp(header, "ID3", 3) != 0 || (header[6] | header[7] | header[8] | header[9]) & 0x80)
+            return 0;
+        uint64_t size = static_cast<uint64_t>(header[6]) << 21 | header[7] << 14 | header[8] << 7 | header[9];
+        return 10 + size + ((header[5] & 0x10) ? 10 : 0);
+    }
+
+    // ---------------------------------------------------------------- MP3
+
+    struct MpegFrame
+    {
+        bool mpeg1 = false;
+        int layer = 0;
+        uint32_t bitrate_kbps = 0;
+        uint32_t sample_rate = 0;
+        uint32_t samples = 0; // Per frame
+        uint32_t length = 0;  // Bytes, header included
+        bool mono = false;
+    };
+
+    bool decode_frame_header(const uint8_t *h, MpegFrame &frame)
+    {
+        static const uint16_t BITRATES[2][3][15] = {
+            // MPEG-2 and 2.5: layers I, II, III
+            {{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+             {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+             {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}},
+            // MPEG-1
+            {{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+             {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+             {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320}}};
+        static const uint32_t SAMPLE_RATES[4][3] = {
+            {11025, 12000, 8000}, // MPEG-2.5
+            {0, 0, 0},            // Reserved
+            {22050, 24000, 16000}, // MPEG-2
+            {44100, 48000, 32000}}; // MPEG-1
+
+        if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0)
+            return false;
+        uint32_t version = (h[1] >> 3) & 3;
+        uint32_t layer_bits = (h[1] >> 1) & 3;
+        uint32_t bitrate_index = h[2] >> 4;
+        uint32_t rate_index = (h[2] >> 2) & 3;
+        if (version == 1 || layer_bits == 0 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3)
+            return false;
+
+        frame.mpeg1 = version == 3;
+        frame.layer = 4 - static_cast<int>(layer_bits);
+        frame.bitrate_kbps = BITRATES[frame.mpeg1][frame.layer - 1][bitrate_index];
+        frame.sample_rate = SAMPLE_RATES[version][rate_index];
+        frame.mono = (h[3] >> 6) == 3;
+        uint32_t padding = (h[2] >> 1) & 1;
+        if (frame.layer == 1)
+        {
+            frame.samples = 384;
+            frame.length = (12 * frame.bitrate_kbps * 1000 / frame.sample_rate + padding) * 4;
+        }
+        else
+        {
+            frame.samples = (frame.layer == 3 && !frame.mpeg1) ? 576 : 1152;
+            frame.length = frame.samples / 8 * frame.bitrate_kbps * 1000 / frame.sample_rate + padding;
+        }
+        return frame.length >= 4;
+    }
+
+    // First frame whose successor is where its length says, within
+    // MAX_SYNC_SEARCH bytes of `start` (junk and padding are skipped). The
+    // first frame nearly always follows the tag, so a few KB are read first.
+    bool find_first_frame(const ByteView &file, uint64_t start, uint64_t &offset, MpegFrame &frame)
+    {
+        const size_t MAX_SYNC_SEARCH = 64 * 1024;
+        for (size_t search : {size_t(4096), MAX_SYNC_SEARCH})
+        {
+            size_t got = 0;
+            const uint8_t *window = file.at(start, search + 4, got);
+            for (size_t i = 0; i + 4 <= got; ++i)
+            {
+                if (window[i] != 0xFF || !decode_frame_header(&window[i], frame))
+                    continue;
+                uint64_t next = start + i + frame.length;
+                uint8_t h[4];
+                MpegFrame following;
+                if (next + 4 > file.size() ||
+                    (file.read(next, h, 4) && decode_frame_header(h, following) &&
+                     following.sample_rate == frame.sample_rate && following.layer == frame.layer))
+                {
+                    offset = start + i;
+                    return true;
+                }
+            }
+            if (got < search + 4)
+                break;
+        }
+        return false;
+    }
+
+    AudioProperties probe_mpeg(const ByteView &file, uint64_t start)
+    {
+        uint64_t first = 0;
+        MpegFrame frame;
+        if (!find_first_frame(file, start, first, frame))
+            return {};
+
+        // Trailing ID3v1 tag is not audio
+        uint64_t end = file.size();
+        uint8_t tag[3];
+        if (end >= 128 && file.read(end - 128, tag, 3) && memcmp(tag, "TAG", 3) == 0)
+            end -= 128;
+        uint64_t audio_bytes = end > first ? end - first : 0;
+
+        uint8_t info[192] = {};
+        file.read_some(first, info, sizeof(info));
+
+        if (frame.layer == 3)
+        {
+            // Xing/Info follows the side information; LAME's extension of it
+            // records the encoder delay and padding for gapless playback
+            size_t xing = 4 + (frame.mpeg1 ? (frame.mono ? 17 : 32) : (frame.mono ? 9 : 17));
+            if (memcmp(info + xing, "Xing", 4) == 0 || memcmp(info + xing, "Info", 4) == 0)
+            {
+                uint32_t flags = be32(info + xing + 4);
+                size_t pos = xing + 8;
+                uint64_t frames = 0;
+                if (flags & 1)
+                {
+                    frames = be32(info + pos);
+                    pos += 4;
+                }
+                if (flags & 2)
+                {
+                    audio_bytes = be32(info + pos) ? be32(info + pos) : audio_bytes;
+                    pos += 4;
+                }
+                pos += (flags & 4) ? 100 : 0; // Seek table
+                pos += (flags & 8) ? 4 : 0;   // Quality
+                if (frames > 0)
+                {
+                    uint64_t samples = frames * frame.samples;
+                    if (pos + 24 <= sizeof(info) &&
+                        (memcmp(info + pos, "LAME", 4) == 0 || memcmp(info + pos, "Lavc", 4) == 0 ||
+                         memcmp(info + pos, "Lavf", 4) == 0))
+                    {
+                        const uint8_t *gapless = info + pos + 21;
+                        uint64_t trimmed = (gapless[0] << 4 | gapless[1] >> 4) + ((gapless[1] & 0x0F) << 8 | gapless[2]);
+                        if (trimmed < samples)
+                            samples -= trimmed;
+                    }
+                    return finish(samples, frame.sample_rate, audio_bytes);
+                }
+            }
+
+            // Fraunhofer's VBRI sits at a fixed offset
+            if (memcmp(info + 36, "VBRI", 4) == 0)
+            {
+                uint64_t frames = be32(info + 36 + 14);
+                return finish(frames * frame.samples, frame.sample_rate, be32(info + 36 + 10));
+            }
+        }
+
+        // No VBR header: constant bitrate, so the byte count gives the length
+        uint64_t samples = audio_bytes * 8 * frame.sample_rate / (static_cast<uint64_t>(frame.bitrate_kbps) * 1000);
+        return finish(samples, frame.sample_rate, audio_bytes);
+    }
+
+    // --------------------------------------------------------------- FLAC
+
+    AudioProperties flac_streaminfo(const uint8_t *info, uint64_t audio_bytes)
+    {
+        uint32_t rate = static_cast<uint32_t>(info[10]) << 12 | info[11] << 4 | info[12] >> 4;
+        uint64_t samples = static_cast<uint64_t>(info[13] & 0x0F) << 32 | be32(info + 14);
+        return finish(samples, rate, audio_bytes);
+    }
+
+    AudioProperties probe_flac(const ByteView &file, uint64_t start)
+    {
+        // "fLaC", then STREAMINFO is always the first metadata block
+        uint8_t head[8 + 34];
+        if (!file.read(start, head, sizeof(head)) || (head[4] & 0x7F) != 0)
+            return {};
+        return flac_streaminfo(head + 8, file.size() - start);
+    }
+
+    // ---------------------------------------------------------------- WAV
+
+    AudioProperties probe_wav(const ByteView &file)
+    {
+        uint32_t byte_rate = 0, sample_rate = 0;
+        uint64_t data_bytes = 0;
+        bool have_data = false;
+        uint64_t pos = 12;
+        for (int chunks = 0; chunks < 64 && pos + 8 <= file.size() && !(byte_rate && have_data); ++chunks)
+        {
+            uint8_t chunk[8 + 16];
+            size_t got = file.read_some(pos, chunk, sizeof(chunk));
+            if (got < 8)
+                break;
+            uint64_t size = le32(chunk + 4);
+            if (memcmp(chunk, "fmt ", 4) == 0 && got >= 8 + 12)
+            {
+                sample_rate = le32(chunk + 8 + 4);
+                byte_rate = le32(chunk + 8 + 8);
+            }
+            else if (memcmp(chunk, "data", 4) == 0)
+            {
+                // Streamed files leave the size unset; the file's end bounds it
+                data_bytes = std::min<uint64_t>(size, file.size() - pos - 8);
+                have_data = true;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        if (byte_rate == 0 || !have_data)
+            return {};
+        AudioProperties props;
+        uint64_t ms = data_bytes * 1000 / byte_rate;
+        if (ms == 0 || ms > INT32_MAX)
+            return props;
+        props.duration_ms = static_cast<int>(ms);
+        props.bitrate_kbps = static_cast<int>(static_cast<uint64_t>(byte_rate) * 8 / 1000);
+        props.sample_rate = static_cast<int>(sample_rate);
+        return props;
+    }
+
+    // ---------------------------------------------------------------- Ogg
+
+    AudioProperties probe_ogg(const ByteView &file)
+    {
+        // The first page holds exactly the codec's identification packet
+        uint8_t page[27 + 255 + 64] = {};
+        size_t got = file.read_some(0, page, sizeof(page));
+        if (got < 27)
+            return {};
+        uint32_t serial = le32(page + 14);
+        size_t packet = 27 + page[26];
+        if (packet + 40 > got)
+            return {};
+        const uint8_t *id = page + packet;
+
+        uint32_t rate = 0;
+        uint64_t pre_skip = 0;
+        if (memcmp(id, "\x01vorbis", 7) == 0)
+        {
+            rate = le32(id + 12);
+        }
+        else if (memcmp(id, "OpusHead", 8) == 0)
+        {
+            rate = 48000; // Opus granules always count 48 kHz samples
+            pre_skip = le16(id + 10);
+        }
+        else if (memcmp(id, "\x7F" "FLAC", 5) == 0 && memcmp(id + 9, "fLaC", 4) == 0 && packet + 17 + 34 <= got)
+        {
+            const uint8_t *info = id + 17;
+            rate = static_cast<uint32_t>(info[10]) << 12 | info[11] << 4 | info[12] >> 4;
+        }
+        else if (memcmp(id, "Speex   ", 8) == 0)
+        {
+            rate = le32(id + 36);
+        }
+        if (rate == 0)
+            return {};
+
+        // Scan back from the end for the stream's last page with a granule.
+        // It is nearly always in the last few KB, so that is read first.
+        for (uint64_t window : {uint64_t(64 * 1024), uint64_t(1024 * 1024)})
+        {
+            uint64_t from = file.size() > window ? file.size() - window : 0;
+            size_t length = 0;
+            const uint8_t *tail = file.at(from, window, length);
+            for (size_t i = length >= 27 ? length - 27 + 1 : 0; i-- > 0;)
+            {
+                if (tail[i] != 'O' || memcmp(tail + i, "OggS", 4) != 0 || le32(tail + i + 14) != serial)
+                    continue;
+                uint64_t granule = le64(tail + i + 6);
+                if (granule == UINT64_MAX)
+                    continue;
+                return finish(granule > pre_skip ? granule - pre_skip : 0, rate, file.size());
+            }
+            if (from == 0)
+                break;
+        }
+        return {};
+    }
+
+    // ---------------------------------------------------------------- MP4
+
+    // Finds a box of `type` among the boxes in [begin, end); sets its
+    // payload range. Only the 8- or 16-byte box headers are read.
+    bool find_box(const ByteView &file, uint64_t begin, uint64_t end, const char *type, uint64_t &payload, uint64_t &payload_end)
+    {
+        uint64_t pos = begin;
+        for (int boxes = 0; boxes < 1024 && pos + 8 <= end; ++boxes)
+        {
+            uint8_t header[16];
+            if (!file.read(pos, header, 8))
+                return false;
+            uint64_t size = be32(header);
+            uint64_t header_size = 8;
+            if (size == 1)
+            {
+                if (!file.read(pos + 8, header + 8, 8))
+                    return false;
+                size = be64(header + 8);
+                header_size = 16;
+            }
+            else if (size == 0)
+            {
+                size = end - pos;
+            }
+            if (size < header_size || pos + size > end)
+                return false;
+            if (memcmp(header + 4, type, 4) == 0)
+            {
+                payload = pos + header_size;
+                payload_end = pos + size;
+                return true;
+            }
+            pos += size;
+        }
+        return false;
+    }
+
+    AudioProperties probe_mp4(const ByteView &file)
+    {
+        uint64_t moov = 0, moov_end = 0, mvhd = 0, mvhd_end = 0;
+        if (!find_box(file, 0, file.size(), "moov", moov, moov_end) ||
+            !find_box(file, moov, moov_end, "mvhd", mvhd, mvhd_end))
+            return {};
+
+        uint8_t body[32];
+        if (!file.read(mvhd, body, sizeof(body)))
+            return {};
+        uint64_t timescale, duration;
+        if (body[0] == 1)
+        {
+            timescale = be32(body + 20);
+            duration = be64(body + 24);
+        }
+        else
+        {
+            timescale = be32(body + 12);
+            duration = be32(body + 16);
+        }
+        if (timescale == 0 || duration == 0 || duration == UINT32_MAX || duration == UINT64_MAX)
+            return {};
+        AudioProperties props;
+        uint64_t ms = duration * 1000 / timescale;
+        if (ms == 0 || ms > INT32_MAX)
+            return props;
+        props.duration_ms = static_cast<int>(ms);
+        props.bitrate_kbps = static_cast<int>(file.size() * 8 / ms);
+        return props;
+    }
+
+    AudioProperties probe_view(const ByteView &file)
+    {
+        uint8_t magic[12] = {};
+        size_t got = file.read_some(0, magic, sizeof(magic));
+        if (got < 4)
+            return {};
+        if (memcmp(magic, "RIFF", 4) == 0 && got >= 12 && memcmp(magic + 8, "WAVE", 4) == 0)
+            return probe_wav(file);
+        if (memcmp(magic, "OggS", 4) == 0)
+            return probe_ogg(file);
+        if (got >= 8 && memcmp(magic + 4, "ftyp", 4) == 0)
+            return probe_mp4(file);
+
+        // FLAC and MP3 may both start with an ID3v2 tag
+        uint64_t start = got >= 10 ? id3v2_size(magic) : 0;
+        uint8_t after[4] = {};
+        if (start > 0 && !file.read(start, after, 4))
+            return {};
+        const uint8_t *head = start > 0 ? after : magic;
+        if (memcmp(head, "fLaC", 4) == 0)
+            return probe_flac(file, start);
+        return probe_mpeg(file, start);
+    }
+}
+
+AudioProperties DurationProbe::probe(const std::string &filepath)
+{
+    FileReader file(filepath);
+    return probe_file(file, {});
+}
+
+AudioProperties DurationProbe::probe_file(const FileReader &file, std::string_view head)
+{
+    if (!file.is_open())
+        return {};
+    return probe_view(ByteView(head.substr(0, std::min<uint64_t>(head.size(), file.size())), &file));
+}
+
+AudioProperties DurationProbe::probe_bytes(std::string_view file)
+{
+    return probe_view(ByteView(file, nullptr));
+}
@@ -1,4 +1,5 @@
 #include "fft.h"
+#include "trace.h"
 #include <algorithm>
 
 void SimpleFFT::fft(std::vector<std::complex<double>> &x)
@@ -32,6 +33,8 @@ void SimpleFFT::fft(std::vector<std::complex<double>> &x)
 
 std::vector<float> SimpleFFT::analyze(const float *samples, size_t count, int num_bands)
 {
+    TRACE_SCOPE("fft", "analyze");
+
     // Ensure power of 2
     size_t fft_size = 1;
     while (fft_size < count)
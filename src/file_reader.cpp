@@ -0,0 +1,47 @@
+#include "file_reader.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FileReader::FileReader(const std::string &path)
+{
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    length = static_cast<uint64_t>(st.st_size);
+}
+
+FileReader::~FileReader()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+size_t FileReader::read_some(uint64_t offset, void *out, size_t count) const
+{
+    size_t done = 0;
+    while (fd >= 0 && done < count)
+    {
+        ssize_t n = pread(fd, static_cast<char *>(out) + done, count - done, static_cast<off_t>(offset + done));
+        if (n <= 0)
+            break;
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+size_t FileReader::append(uint64_t offset, size_t count, std::string &buffer) const
+{
+    size_t old_size = buffer.size();
+    buffer.resize(old_size + count);
+    size_t got = read_some(offset, &buffer[old_size], count);
+    buffer.resize(old_size + got);
+    return got;
+}
@@ -0,0 +1,449 @@
+#include "library_browser.h"
+#include "sort_index.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    constexpr size_t FLUSH_BYTES = 16 * 1024; // Body bytes buffered per sink call
+
+    const char *const SORT_NAMES[] = {"id", "path", "title", "artist", "album", "year", "genre", "duration"};
+
+    struct FieldName
+    {
+        const char *name;
+        unsigned bit;
+    };
+
+    const FieldName FIELD_NAMES[] = {
+        {"id", browse_field::ID},
+        {"path", browse_field::PATH},
+        {"title", browse_field::TITLE},
+        {"artist", browse_field::ARTIST},
+        {"album", browse_field::ALBUM},
+        {"year", browse_field::YEAR},
+        {"genre", browse_field::GENRE},
+        {"duration", browse_field::DURATION},
+        {"bitrate", browse_field::BITRATE},
+        {"pending", browse_field::PENDING}};
+
+    std::string_view text_key(const TrackTable &tracks, TrackId id, BrowseSort sort)
+    {
+        switch (sort)
+        {
+        case BrowseSort::PATH:
+            return tracks.path(id);
+        case BrowseSort::TITLE:
+            return tracks.title(id);
+        case BrowseSort::ARTIST:
+            return tracks.artist(id);
+        case BrowseSort::ALBUM:
+            return tracks.album(id);
+        case BrowseSort::YEAR:
+            return tracks.year(id);
+        case BrowseSort::GENRE:
+            return tracks.genre(id);
+        default:
+            return std::string_view();
+        }
+    }
+
+    // Display strings sort by Collation key, as the playlist does; paths
+    // sort bytewise, which keeps a directory's files together
+    std::string sort_key(const TrackTable &tracks, TrackId id, BrowseSort sort)
+    {
+        std::string_view text = text_key(tracks, id, sort);
+        return sort == BrowseSort::PATH ? std::string(text) : Collation::key(text);
+    }
+
+    // Cursor key as stored: the sort key, or the duration in decimal
+    std::string cursor_key(const TrackTable &tracks, TrackId id, BrowseSort sort)
+    {
+        if (sort == BrowseSort::DURATION)
+            return std::to_string(tracks.duration_ms(id));
+        return sort_key(tracks, id, sort);
+    }
+
+    // Order by the sort column, then by ID so every position is unique
+    int compare_key(const TrackTable &tracks, TrackId id, BrowseSort sort, std::string_view key, int64_t number)
+    {
+        if (sort == BrowseSort::DURATION)
+        {
+            int64_t value = tracks.duration_ms(id);
+            return value < number ? -1 : value > number ? 1 : 0;
+        }
+        return sort_key(tracks, id, sort).compare(key);
+    }
+
+    int hex_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // Cursor format: <sort>.<id hex>.<key hex>; opaque to clients
+    std::string encode_cursor(BrowseSort sort, TrackId id, std::string_view key)
+    {
+        static const char digits[] = "0123456789abcdef";
+        char head[32];
+        snprintf(head, sizeof(head), "%d.%x.", static_cast<int>(sort), id);
+        std::string cursor = head;
+        for (unsigned char c : key)
+        {
+            cursor += digits[c >> 4];
+            cursor += digits[c & 15];
+        }
+        return cursor;
+    }
+
+    bool decode_cursor(const std::string &cursor, BrowseQuery &query)
+    {
+        int sort = 0;
+        unsigned id = 0;
+        int consumed = 0;
+        if (sscanf(cursor.c_str(), "%d.%x.%n", &sort, &id, &consumed) != 2 || consumed == 0 ||
+            sort != static_cast<int>(query.sort))
+        {
+            return false;
+        }
+
+        std::string_view hex = std::string_view(cursor).substr(consumed);
+        if (hex.size() % 2 != 0)
+            return false;
+        std::string key;
+        for (size_t i = 0; i < hex.size(); i += 2)
+        {
+            int hi = hex_value(hex[i]), lo = hex_value(hex[i + 1]);
+            if (hi < 0 || lo < 0)
+                return false;
+            key += static_cast<char>(hi * 16 + lo);
+        }
+
+        query.has_cursor = true;
+        query.after_id = id;
+        query.after_key = std::move(key);
+        return true;
+    }
+
+    void append_json_string(std::string &out, std::string_view value)
+    {
+        out += '"';
+        for (char c : value)
+        {
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                {
+                    out += c;
+                }
+                break;
+            }
+        }
+        out += '"';
+    }
+}
+
+std::string LibraryBrowser::url_decode(std::string_view value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        if (value[i] == '+')
+        {
+            result += ' ';
+        }
+        else if (value[i] == '%' && i + 2 < value.size() && hex_value(value[i + 1]) >= 0 && hex_value(value[i + 2]) >= 0)
+        {
+            result += static_cast<char>(hex_value(value[i + 1]) * 16 + hex_value(value[i + 2]));
+            i += 2;
+        }
+        else
+        {
+            result += value[i];
+        }
+    }
+    return result;
+}
+
+bool LibraryBrowser::parse_query(std::string_view query_string, BrowseQuery &query, std::string &error)
+{
+    std::string cursor;
+    while (!query_string.empty())
+    {
+        size_t amp = query_string.find('&');
+        std::string_view param = query_string.substr(0, amp);
+        query_string = amp == std::string_view::npos ? std::string_view() : query_string.substr(amp + 1);
+
+        size_t eq = param.find('=');
+        std::string_view name = param.substr(0, eq);
+        std::string value = eq == std::string_view::npos ? std::string() : url_decode(param.substr(eq + 1));
+
+        if (name == "cursor")
+        {
+            cursor = value;
+        }
+        else if (name == "limit")
+        {
+            if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos ||
+                std::stoul(value) == 0)
+            {
+                error = "limit must be a positive integer";
+                return false;
+            }
+            query.limit = std::min<size_t>(std::stoul(value), MAX_LIMIT);
+        }
+        else if (name == "sort")
+        {
+            auto it = std::find(std::begin(SORT_NAMES), std::end(SORT_NAMES), value);
+            if (it == std::end(SORT_NAMES))
+            {
+                error = "unknown sort: " + value;
+                return false;
+            }
+            query.sort = static_cast<BrowseSort>(it - std::begin(SORT_NAMES));
+        }
+        else if (name == "fields")
+        {
+            query.fields = 0;
+            std::string_view list = value;
+            while (!list.empty())
+            {
+                size_t comma = list.find(',');
+                std::string_view field = list.substr(0, comma);
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+                auto it = std::find_if(std::begin(FIELD_NAMES), std::end(FIELD_NAMES),
+                                       [field](const FieldName &f)
+                                       { return field == f.name; });
+                if (it == std::end(FIELD_NAMES))
+                {
+                    error = "unknown field: " + std::string(field);
+                    return false;
+                }
+                query.fields |= it->bit;
+            }
+            if (query.fields == 0)
+            {
+                error = "fields must not be empty";
+                return false;
+            }
+        }
+    }
+
+    // Decoded last: the cursor must belong to the requested sort
+    if (!cursor.empty() && !decode_cursor(cursor, query))
+    {
+        error = "invalid cursor";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const std::vector<TrackId>> LibraryBrowser::sorted_ids(const std::shared_ptr<const TrackTable> &tracks, BrowseSort sort)
+{
+    // One build per table modification: play counts and other new snapshots
+    // of unchanged rows reuse it. Concurrent requests wait for a build rather
+    // than sorting the same library twice.
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    SortedIndex &entry = cache[static_cast<size_t>(sort)];
+    if (entry.ids && entry.lineage == tracks->lineage() && entry.modifications == tracks->modification_count())
+        return entry.ids;
+
+    TRACE_SCOPE("browse", "build_sorted_index");
+    const TrackTable &table = *tracks;
+    auto ids = std::make_shared<std::vector<TrackId>>();
+    ids->reserve(table.size());
+    if (sort == BrowseSort::DURATION)
+    {
+        for (TrackId id = 0; id < table.row_count(); ++id)
+        {
+            if (table.alive(id))
+                ids->push_back(id);
+        }
+        std::sort(ids->begin(), ids->end(), [&table](TrackId a, TrackId b)
+                  { int32_t da = table.duration_ms(a), db = table.duration_ms(b);
+                    return da < db || (da == db && a < b); });
+    }
+    else
+    {
+        // Keys are computed once per row, not per comparison
+        std::vector<std::pair<std::string, TrackId>> keyed;
+        keyed.reserve(table.size());
+        for (TrackId id = 0; id < table.row_count(); ++id)
+        {
+            if (table.alive(id))
+                keyed.emplace_back(sort_key(table, id, sort), id);
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (const auto &item : keyed)
+            ids->push_back(item.second);
+    }
+
+    entry.lineage = table.lineage();
+    entry.modifications = table.modification_count();
+    entry.ids = ids;
+    return ids;
+}
+
+bool LibraryBrowser::write_page(const PlaylistSnapshot &snapshot, const BrowseQuery &query, const Sink &sink)
+{
+    TRACE_SCOPE("browse", "write_page");
+    const TrackTable &tracks = *snapshot.tracks;
+
+    // Collect one more than the limit to learn whether another page follows
+    std::vector<TrackId> page;
+    page.reserve(query.limit + 1);
+    if (query.sort == BrowseSort::ID)
+    {
+        for (TrackId id = query.has_cursor ? query.after_id + 1 : 0;
+             id < tracks.row_count() && page.size() <= query.limit; ++id)
+        {
+            if (tracks.alive(id))
+                page.push_back(id);
+        }
+    }
+    else
+    {
+        std::shared_ptr<const std::vector<TrackId>> ids = sorted_ids(snapshot.tracks, query.sort);
+        auto start = ids->begin();
+        if (query.has_cursor)
+        {
+            int64_t number = query.sort == BrowseSort::DURATION ? std::atoll(query.after_key.c_str()) : 0;
+            start = std::upper_bound(ids->begin(), ids->end(), query.after_id,
+                                     [&](TrackId after, TrackId id)
+                                     { int c = compare_key(tracks, id, query.sort, query.after_key, number);
+                                       return c > 0 || (c == 0 && id > after); });
+        }
+        for (auto it = start; it != ids->end() && page.size() <= query.limit; ++it)
+        {
+            page.push_back(*it);
+        }
+    }
+
+    bool more = page.size() > query.limit;
+    if (more)
+        page.pop_back();
+
+    std::string out;
+    out.reserve(FLUSH_BYTES + 1024);
+    out += "{\"version\":" + std::to_string(snapshot.version);
+    out += ",\"total\":" + std::to_string(tracks.size());
+    out += ",\"sort\":\"";
+    out += SORT_NAMES[static_cast<size_t>(query.sort)];
+    out += "\",\"tracks\":[";
+
+    for (size_t i = 0; i < page.size(); ++i)
+    {
+        TrackId id = page[i];
+        out += i == 0 ? "{" : ",{";
+        bool first = true;
+        auto key = [&](const char *name)
+        {
+            out += first ? "\"" : ",\"";
+            out += name;
+            out += "\":";
+            first = false;
+        };
+
+        if (query.fields & browse_field::ID)
+        {
+            key("id");
+            out += std::to_string(id);
+        }
+        if (query.fields & browse_field::PATH)
+        {
+            key("path");
+            append_json_string(out, tracks.path(id));
+        }
+        if (query.fields & browse_field::TITLE)
+        {
+            key("title");
+            append_json_string(out, tracks.title(id));
+        }
+        if (query.fields & browse_field::ARTIST)
+        {
+            key("artist");
+            append_json_string(out, tracks.artist(id));
+        }
+        if (query.fields & browse_field::ALBUM)
+        {
+            key("album");
+            append_json_string(out, tracks.album(id));
+        }
+        if (query.fields & browse_field::YEAR)
+        {
+            key("year");
+            append_json_string(out, tracks.year(id));
+        }
+        if (query.fields & browse_field::GENRE)
+        {
+            key("genre");
+            append_json_string(out, tracks.genre(id));
+        }
+        if (query.fields & browse_field::DURATION)
+        {
+            key("duration");
+            out += std::to_string(tracks.duration_ms(id));
+        }
+        if (query.fields & browse_field::BITRATE)
+        {
+            key("bitrate");
+            out += std::to_string(tracks.bitrate(id));
+        }
+        if (query.fields & browse_field::PENDING)
+        {
+            key("pending");
+            out += tracks.metadata_pending(id) ? "true" : "false";
+        }
+        out += '}';
+
+        if (out.size() >= FLUSH_BYTES)
+        {
+            if (!sink(out))
+                return false;
+            out.clear();
+        }
+    }
+
+    out += "],\"next_cursor\":";
+    if (more)
+    {
+        TrackId last = page.back();
+        append_json_string(out, encode_cursor(query.sort, last, cursor_key(tracks, last, query.sort)));
+    }
+    else
+    {
+        out += "null";
+    }
+    out += '}';
+    return sink(out);
+}
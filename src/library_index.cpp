@@ -0,0 +1,264 @@
+#include "library_index.h"
+#include "playlist_manager.h"
+#include "track_table.h"
+#include "metadata_parser.h"
+#include "logger.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace library_index;
+
+namespace
+{
+    // Builds the string table, storing each distinct value once (artist,
+    // album, genre and year repeat heavily across a library)
+    class StringTableBuilder
+    {
+    public:
+        StringRef add(std::string_view value)
+        {
+            auto it = offsets.find(std::string(value));
+            if (it != offsets.end())
+            {
+                return {it->second, static_cast<uint32_t>(value.size())};
+            }
+            uint32_t offset = static_cast<uint32_t>(data.size());
+            data.append(value.data(), value.size());
+            offsets.emplace(std::string(value), offset);
+            return {offset, static_cast<uint32_t>(value.size())};
+        }
+
+        const std::string &bytes() const { return data; }
+
+    private:
+        std::string data;
+        std::unordered_map<std::string, uint32_t> offsets;
+    };
+}
+
+LibraryIndex::~LibraryIndex()
+{
+    close();
+}
+
+bool LibraryIndex::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(IndexHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mapping_size = static_cast<size_t>(st.st_size);
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        mapping_size = 0;
+        return false;
+    }
+
+    const auto *header = static_cast<const IndexHeader *>(mapping);
+    size_t expected_record_size = header->version == VERSION ? sizeof(IndexRecord) : LEGACY_RECORD_SIZE;
+    bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header->version >= VERSION_ESTIMATED_DURATIONS && header->version <= VERSION &&
+                 header->header_size == sizeof(IndexHeader) &&
+                 header->record_size == expected_record_size &&
+                 header->entry_count <= (mapping_size - sizeof(IndexHeader)) / expected_record_size &&
+                 header->strings_offset >= sizeof(IndexHeader) + header->entry_count * expected_record_size &&
+                 header->strings_offset <= mapping_size &&
+                 header->strings_size <= mapping_size - header->strings_offset;
+    if (!valid)
+    {
+        LOG_WARN("index", "Ignoring incompatible or corrupt library index: %s", path.c_str());
+        close();
+        return false;
+    }
+
+    entry_count = static_cast<size_t>(header->entry_count);
+    version = header->version;
+    record_size = expected_record_size;
+    strings = static_cast<const char *>(mapping) + header->strings_offset;
+    strings_size = header->strings_size;
+
+    by_path.reserve(entry_count);
+    for (size_t i = 0; i < entry_count; ++i)
+    {
+        by_path.emplace(string_at(record_at(i)->path), i);
+    }
+    return true;
+}
+
+void LibraryIndex::close()
+{
+    by_path.clear();
+    if (mapping)
+    {
+        munmap(mapping, mapping_size);
+    }
+    mapping = nullptr;
+    mapping_size = 0;
+    entry_count = 0;
+    version = 0;
+    record_size = 0;
+    strings = nullptr;
+    strings_size = 0;
+}
+
+const IndexRecord *LibraryIndex::record_at(size_t i) const
+{
+    // Records of older versions are shorter; only their common prefix is read
+    return reinterpret_cast<const IndexRecord *>(static_cast<const char *>(mapping) + sizeof(IndexHeader) + i * record_size);
+}
+
+std::string_view LibraryIndex::string_at(StringRef ref) const
+{
+    // Out-of-range references (a damaged file) read as empty
+    if (static_cast<uint64_t>(ref.offset) + ref.length > strings_size)
+    {
+        return std::string_view();
+    }
+    return std::string_view(strings + ref.offset, ref.length);
+}
+
+bool LibraryIndex::lookup(const std::string &filepath, uint64_t file_size, int64_t mtime_ns, Track &track) const
+{
+    auto it = by_path.find(filepath);
+    if (it == by_path.end())
+    {
+        return false;
+    }
+
+    const IndexRecord *record = record_at(it->second);
+    if (record->file_size != file_size || record->mtime_ns != mtime_ns)
+    {
+        return false;
+    }
+
+    track.title = std::string(string_at(record->title));
+    track.artist = std::string(string_at(record->artist));
+    track.album = std::string(string_at(record->album));
+    track.year = std::string(string_at(record->year));
+    track.genre = std::string(string_at(record->genre));
+    track.duration_ms = record->duration_ms;
+    track.bitrate = record->bitrate;
+    if (version == VERSION)
+    {
+        track.art_offset = record->art_offset;
+        track.art_length = record->art_length;
+    }
+    else
+    {
+        // Keep the tags and play count; only the art (and for version 3 the
+        // duration) needs the file
+        TrackMetadata meta = MetadataParser::parse(filepath);
+        track.art_offset = meta.art_offset;
+        track.art_length = meta.art_length;
+        if (version == VERSION_ESTIMATED_DURATIONS && meta.duration_ms > 0)
+        {
+            track.duration_ms = meta.duration_ms;
+            track.bitrate = meta.bitrate;
+        }
+    }
+    track.bpm = record->bpm;
+    track.disc = record->disc;
+    track.track_number = record->track_number;
+    track.play_count = record->play_count;
+    track.file_size = file_size;
+    track.mtime_ns = mtime_ns;
+    return true;
+}
+
+bool LibraryIndex::stat_file(const std::string &filepath, uint64_t &file_size, int64_t &mtime_ns)
+{
+    struct stat st;
+    if (stat(filepath.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    file_size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+    mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool LibraryIndex::save(const std::string &path, const TrackTable &tracks)
+{
+    StringTableBuilder table;
+    std::vector<IndexRecord> records;
+    records.reserve(tracks.size());
+
+    for (TrackId id = 0; id < tracks.row_count(); ++id)
+    {
+        if (!tracks.alive(id))
+            continue;
+
+        IndexRecord record;
+        memset(&record, 0, sizeof(record));
+        record.file_size = tracks.file_size(id);
+        record.mtime_ns = tracks.mtime_ns(id);
+        record.path = table.add(tracks.path(id));
+        record.title = table.add(tracks.title(id));
+        record.artist = table.add(tracks.artist(id));
+        record.album = table.add(tracks.album(id));
+        record.year = table.add(tracks.year(id));
+        record.genre = table.add(tracks.genre(id));
+        record.duration_ms = tracks.duration_ms(id);
+        record.bitrate = tracks.bitrate(id);
+        record.bpm = tracks.bpm(id);
+        record.play_count = tracks.play_count(id);
+        record.disc = tracks.disc(id);
+        record.track_number = tracks.track_number(id);
+        record.art_offset = tracks.art_offset(id);
+        record.art_length = tracks.art_length(id);
+        records.push_back(record);
+    }
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.header_size = sizeof(IndexHeader);
+    header.record_size = sizeof(IndexRecord);
+    header.entry_count = records.size();
+    header.strings_offset = sizeof(IndexHeader) + records.size() * sizeof(IndexRecord);
+    header.strings_size = table.bytes().size();
+
+    std::string tmp_path = path + ".tmp";
+    FILE *out = fopen(tmp_path.c_str(), "wb");
+    if (!out)
+    {
+        LOG_WARN("index", "Cannot write library index: %s", tmp_path.c_str());
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              (records.empty() || fwrite(records.data(), sizeof(IndexRecord), records.size(), out) == records.size()) &&
+              (table.bytes().empty() || fwrite(table.bytes().data(), 1, table.bytes().size(), out) == table.bytes().size());
+    ok = fclose(out) == 0 && ok;
+
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        LOG_WARN("index", "Failed to write library index: %s", path.c_str());
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,262 @@
+#include "library_scanner.h"
+#include "library_index.h"
+#include "metadata_parser.h"
+#include "realtime.h"
+#include "trace.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr size_t FILES_PER_ITEM = 64; // Files handed to one worker at a time
+    constexpr size_t BATCH_SIZE = 256;    // Tracks per published batch
+
+    struct WorkItem
+    {
+        fs::path directory;          // List this directory, or
+        std::vector<fs::path> files; // process these files
+    };
+
+    // Shared queue; `pending` counts items queued or in progress so workers
+    // know the walk is complete when it reaches zero
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<WorkItem> items;
+        size_t pending = 0;
+
+        void push(WorkItem item)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                items.push_back(std::move(item));
+                pending++;
+            }
+            cv.notify_one();
+        }
+
+        bool pop(WorkItem &item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]()
+                    { return !items.empty() || pending == 0; });
+            if (items.empty())
+                return false;
+            item = std::move(items.front());
+            items.pop_front();
+            return true;
+        }
+
+        void done()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0)
+                cv.notify_all();
+        }
+    };
+}
+
+LibraryScanner::LibraryScanner(const Config &cfg, const LibraryIndex *idx)
+    : config(cfg), index(idx), defer_metadata(false), stop_flag(nullptr)
+{
+}
+
+size_t LibraryScanner::thread_count(const Config &config)
+{
+    if (config.scan_threads > 0)
+        return static_cast<size_t>(config.scan_threads);
+
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    return std::min<size_t>(cores * 2, 16);
+}
+
+bool LibraryScanner::is_supported_format(const std::string &ext)
+{
+    std::string lower_ext = ext;
+    std::transform(lower_ext.begin(), lower_ext.end(), lower_ext.begin(), ::tolower);
+
+    return lower_ext == ".mp3" || lower_ext == ".wav" || lower_ext == ".ogg" ||
+           lower_ext == ".flac" || lower_ext == ".m4a" || lower_ext == ".aac";
+}
+
+Track LibraryScanner::read_track(const std::string &filepath, uint64_t file_size, int64_t mtime_ns)
+{
+    Track track(filepath);
+    TrackMetadata meta = MetadataParser::parse(filepath);
+    if (meta.truncated)
+        LOG_WARN("scan", "Tags of %s exceed the parse limits; read in part", filepath.c_str());
+    track.title = meta.title.empty() ? fs::path(filepath).filename().string() : meta.title;
+    track.artist = meta.artist.empty() ? "Unknown" : meta.artist;
+    track.album = meta.album;
+    track.year = meta.year;
+    track.genre = meta.genre;
+    track.duration_ms = meta.duration_ms;
+    track.bitrate = meta.bitrate;
+    track.bpm = meta.bpm;
+    track.disc = meta.disc;
+    track.track_number = meta.track_number;
+    track.art_offset = meta.art_offset;
+    track.art_length = meta.art_length;
+    track.file_size = file_size;
+    track.mtime_ns = mtime_ns;
+    return track;
+}
+
+Track LibraryScanner::placeholder_track(const std::string &filepath, uint64_t file_size, int64_t mtime_ns)
+{
+    Track track(filepath);
+    track.title = fs::path(filepath).filename().string();
+    track.file_size = file_size;
+    track.mtime_ns = mtime_ns;
+    track.metadata_pending = true;
+    return track;
+}
+
+ScanStats LibraryScanner::scan(const std::string &root, const BatchCallback &on_batch)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    ScanStats totals;
+    std::mutex publish_mutex; // Serializes on_batch and guards totals
+
+    WorkQueue queue;
+    queue.push({fs::absolute(root).lexically_normal(), {}});
+
+    auto worker = [&]()
+    {
+        Tracer::set_thread_name("library-scanner");
+        Realtime::apply_to_current_thread(ThreadRole::SCANNER);
+
+        ScanStats local;
+        std::vector<Track> batch;
+        batch.reserve(BATCH_SIZE);
+
+        auto publish = [&]()
+        {
+            std::lock_guard<std::mutex> lock(publish_mutex);
+            if (!batch.empty() && !stop_requested())
+                on_batch(batch);
+            batch.clear();
+            totals.files += local.files;
+            totals.reused += local.reused;
+            totals.parsed += local.parsed;
+            totals.deferred += local.deferred;
+            totals.bytes += local.bytes;
+            local = ScanStats();
+        };
+
+        WorkItem item;
+        while (queue.pop(item))
+        {
+            if (stop_requested())
+            {
+                // Drain without expanding, so every worker sees the walk end
+                queue.done();
+                continue;
+            }
+            if (!item.directory.empty())
+            {
+                TRACE_SCOPE("scan", "list_directory");
+                std::error_code ec;
+                std::vector<fs::path> files;
+                for (fs::directory_iterator it(item.directory, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    const fs::directory_entry &entry = *it;
+                    std::error_code type_ec;
+                    // Like recursive_directory_iterator, do not descend into directory symlinks
+                    if (entry.is_directory(type_ec) && !entry.is_symlink(type_ec))
+                    {
+                        queue.push({entry.path(), {}});
+                    }
+                    else if (entry.is_regular_file(type_ec) && is_supported_format(entry.path().extension().string()))
+                    {
+                        files.push_back(entry.path());
+                        if (files.size() == FILES_PER_ITEM)
+                        {
+                            queue.push({fs::path(), std::move(files)});
+                            files.clear();
+                        }
+                    }
+                }
+                if (ec)
+                {
+                    LOG_WARN("scan", "Cannot read directory %s: %s", item.directory.c_str(), ec.message().c_str());
+                }
+                if (!files.empty())
+                {
+                    queue.push({fs::path(), std::move(files)});
+                }
+            }
+            else
+            {
+                TRACE_SCOPE("scan", "read_metadata");
+                for (const auto &path : item.files)
+                {
+                    if (stop_requested())
+                        break;
+                    std::string filepath = path.string();
+                    uint64_t file_size = 0;
+                    int64_t mtime_ns = 0;
+                    LibraryIndex::stat_file(filepath, file_size, mtime_ns);
+
+                    Track track(filepath);
+                    if (index && index->lookup(filepath, file_size, mtime_ns, track))
+                    {
+                        local.reused++;
+                    }
+                    else if (defer_metadata)
+                    {
+                        track = placeholder_track(filepath, file_size, mtime_ns);
+                        local.deferred++;
+                    }
+                    else
+                    {
+                        track = read_track(filepath, file_size, mtime_ns);
+                        local.parsed++;
+                    }
+                    local.files++;
+                    local.bytes += file_size;
+                    batch.push_back(std::move(track));
+
+                    if (batch.size() >= BATCH_SIZE)
+                        publish();
+                }
+            }
+            queue.done();
+        }
+        publish();
+    };
+
+    size_t threads = thread_count(config);
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    for (auto &t : pool)
+    {
+        t.join();
+    }
+
+    totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stop_requested())
+    {
+        totals.cancelled = true;
+        LOG_INFO("scan", "Scan cancelled after %zu files", totals.files);
+        return totals;
+    }
+    LOG_INFO("scan", "Scanned %zu files (%zu from index, %zu parsed, %zu deferred) on %zu threads in %.2f s: %.0f files/s, %.1f MB/s",
+             totals.files, totals.reused, totals.parsed, totals.deferred, threads, totals.seconds,
+             totals.files_per_second(), totals.mb_per_second());
+    return totals;
+}
@@ -0,0 +1,261 @@
+#include "library_watcher.h"
+#include "library_scanner.h"
+#include "realtime.h"
+#include "trace.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // Same normalization as LibraryScanner so event paths match track paths
+    std::string normalized_root(const std::string &directory)
+    {
+        std::string root = fs::absolute(directory).lexically_normal().string();
+        if (root.size() > 1 && root.back() == '/')
+            root.pop_back();
+        return root;
+    }
+
+    bool is_under(const std::string &path, const std::string &directory)
+    {
+        return path.size() > directory.size() && path.compare(0, directory.size(), directory) == 0 &&
+               path[directory.size()] == '/';
+    }
+}
+
+LibraryWatcher::LibraryWatcher(const Config &cfg, ChangeCallback change_cb, RescanCallback rescan_cb)
+    : config(cfg), on_change(std::move(change_cb)), on_rescan(std::move(rescan_cb)),
+      running(false), inotify_fd(-1), rescan_needed(false)
+{
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    stop();
+}
+
+bool LibraryWatcher::start()
+{
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+    {
+        LOG_WARN("watch", "inotify unavailable (%s); library changes need a restart", strerror(errno));
+        return false;
+    }
+
+    add_watches(normalized_root(config.music_directory));
+    LOG_INFO("watch", "Watching %zu directories under %s", watch_paths.size(), config.music_directory.c_str());
+
+    running = true;
+    watch_thread = std::thread(&LibraryWatcher::run, this);
+    return true;
+#else
+    LOG_WARN("watch", "Library watching is only supported on Linux");
+    return false;
+#endif
+}
+
+void LibraryWatcher::stop()
+{
+    running = false;
+    if (watch_thread.joinable())
+    {
+        watch_thread.join();
+    }
+    if (inotify_fd >= 0)
+    {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    watch_paths.clear();
+}
+
+void LibraryWatcher::add_watches(const std::string &directory)
+{
+#ifdef __linux__
+    const uint32_t mask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE |
+                          IN_DELETE_SELF | IN_ONLYDIR;
+
+    std::error_code ec;
+    std::vector<std::string> stack = {directory};
+    while (!stack.empty())
+    {
+        std::string dir = std::move(stack.back());
+        stack.pop_back();
+
+        int wd = inotify_add_watch(inotify_fd, dir.c_str(), mask);
+        if (wd < 0)
+        {
+            if (errno == ENOSPC)
+            {
+                LOG_WARN("watch", "Watch limit reached at %s; raise fs.inotify.max_user_watches", dir.c_str());
+                return;
+            }
+            continue;
+        }
+        watch_paths[wd] = dir;
+
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code type_ec;
+            if (it->is_directory(type_ec) && !it->is_symlink(type_ec))
+            {
+                stack.push_back(it->path().string());
+            }
+        }
+    }
+#else
+    (void)directory;
+#endif
+}
+
+void LibraryWatcher::handle_events(const char *buffer, size_t length)
+{
+#ifdef __linux__
+    for (size_t offset = 0; offset < length;)
+    {
+        const auto *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+        offset += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW)
+        {
+            rescan_needed = true;
+            continue;
+        }
+        if (event->mask & IN_IGNORED)
+        {
+            watch_paths.erase(event->wd);
+            continue;
+        }
+
+        auto it = watch_paths.find(event->wd);
+        if (it == watch_paths.end() || event->len == 0)
+            continue;
+
+        std::string path = it->second + "/" + event->name;
+        bool is_dir = (event->mask & IN_ISDIR) != 0;
+
+        if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+        {
+            if (is_dir)
+            {
+                // A directory moved elsewhere keeps its watches; drop them
+                for (auto w = watch_paths.begin(); w != watch_paths.end();)
+                {
+                    if (w->second == path || is_under(w->second, path))
+                    {
+                        inotify_rm_watch(inotify_fd, w->first);
+                        w = watch_paths.erase(w);
+                    }
+                    else
+                    {
+                        ++w;
+                    }
+                }
+            }
+            else if (!LibraryScanner::is_supported_format(fs::path(path).extension().string()))
+            {
+                continue;
+            }
+            pending_changed.erase(path);
+            pending_removed.insert(path);
+        }
+        else if (is_dir && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+        {
+            add_watches(path);
+            pending_removed.erase(path);
+            pending_changed.insert(path);
+        }
+        else if (!is_dir && (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)))
+        {
+            // IN_CREATE alone is ignored for files: the data is not written yet
+            if (!LibraryScanner::is_supported_format(fs::path(path).extension().string()))
+                continue;
+            pending_removed.erase(path);
+            pending_changed.insert(path);
+        }
+    }
+#else
+    (void)buffer;
+    (void)length;
+#endif
+}
+
+void LibraryWatcher::run()
+{
+#ifdef __linux__
+    Tracer::set_thread_name("library-watcher");
+    Realtime::apply_to_current_thread(ThreadRole::SCANNER);
+
+    using Clock = std::chrono::steady_clock;
+    const auto debounce = std::chrono::milliseconds(std::max(0, config.watch_debounce_ms));
+    // Flush even while events keep arriving, so a long copy shows up progressively
+    const auto max_delay = debounce * 10;
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    Clock::time_point first_event;
+    Clock::time_point last_event;
+    bool have_pending = false;
+
+    while (running)
+    {
+        struct pollfd pfd = {inotify_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, 200);
+
+        if (ready > 0 && (pfd.revents & POLLIN))
+        {
+            ssize_t length;
+            while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+            {
+                handle_events(buffer, static_cast<size_t>(length));
+            }
+            last_event = Clock::now();
+            if (!have_pending)
+            {
+                first_event = last_event;
+                have_pending = true;
+            }
+        }
+
+        if (!have_pending)
+            continue;
+
+        Clock::time_point now = Clock::now();
+        if (now - last_event < debounce && now - first_event < max_delay)
+            continue;
+
+        have_pending = false;
+        if (rescan_needed)
+        {
+            LOG_WARN("watch", "inotify queue overflowed; rescanning library");
+            rescan_needed = false;
+            pending_changed.clear();
+            pending_removed.clear();
+            add_watches(normalized_root(config.music_directory));
+            on_rescan();
+        }
+        else if (!pending_changed.empty() || !pending_removed.empty())
+        {
+            TRACE_SCOPE("watch", "apply_changes");
+            std::set<std::string> changed;
+            std::set<std::string> removed;
+            changed.swap(pending_changed);
+            removed.swap(pending_removed);
+            on_change(changed, removed);
+        }
+    }
+#endif
+}
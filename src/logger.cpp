@@ -0,0 +1,337 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <syslog.h>
+
+namespace
+{
+    constexpr size_t LOG_RING_CAPACITY = 256; // Records per thread
+    constexpr size_t LOG_MESSAGE_SIZE = 240;
+
+    struct LogRecord
+    {
+        int64_t timestamp_us; // Wall clock
+        LogLevel level;
+        uint32_t suppressed;
+        const char *subsystem; // String literal from the call site
+        char message[LOG_MESSAGE_SIZE];
+    };
+
+    // Single-producer (owning thread) / single-consumer (drain thread) ring
+    struct LogRing
+    {
+        std::unique_ptr<LogRecord[]> records{new LogRecord[LOG_RING_CAPACITY]};
+        std::atomic<uint64_t> head{0}; // Written by producer
+        std::atomic<uint64_t> tail{0}; // Written by consumer
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> in_use{true};
+        uint32_t tid = 0;
+    };
+
+    std::atomic<int> g_level(static_cast<int>(LogLevel::INFO));
+    std::atomic<uint32_t> g_rate_limit(20); // Messages per call site per second
+
+    std::mutex g_registry_mutex;
+    std::vector<std::unique_ptr<LogRing>> g_registry;
+
+    std::mutex g_sink_mutex; // Guards sink state against start/stop only
+    FILE *g_sink = nullptr;
+    bool g_use_syslog = false;
+
+    std::thread g_drain_thread;
+    std::atomic<bool> g_drain_running(false);
+
+    struct RingSlot
+    {
+        LogRing *ring = nullptr;
+        ~RingSlot()
+        {
+            if (ring)
+            {
+                ring->in_use.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    thread_local RingSlot t_ring;
+
+    LogRing *acquire_ring()
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+
+        // Reuse the ring of an exited thread once it has been fully drained
+        for (auto &candidate : g_registry)
+        {
+            if (!candidate->in_use.load(std::memory_order_acquire) &&
+                candidate->tail.load(std::memory_order_acquire) == candidate->head.load(std::memory_order_acquire))
+            {
+                candidate->in_use.store(true, std::memory_order_release);
+                return candidate.get();
+            }
+        }
+
+        g_registry.push_back(std::make_unique<LogRing>());
+        g_registry.back()->tid = static_cast<uint32_t>(g_registry.size());
+        return g_registry.back().get();
+    }
+
+    int64_t now_us()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    const char *level_name(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::DEBUG:
+            return "DEBUG";
+        case LogLevel::INFO:
+            return "INFO";
+        case LogLevel::WARN:
+            return "WARN";
+        case LogLevel::ERROR:
+            return "ERROR";
+        }
+        return "INFO";
+    }
+
+    int syslog_priority(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::DEBUG:
+            return LOG_DEBUG;
+        case LogLevel::INFO:
+            return LOG_INFO;
+        case LogLevel::WARN:
+            return LOG_WARNING;
+        case LogLevel::ERROR:
+            return LOG_ERR;
+        }
+        return LOG_INFO;
+    }
+
+    struct PendingRecord
+    {
+        LogRecord record;
+        uint32_t tid;
+    };
+
+    void emit(const PendingRecord &pending)
+    {
+        const LogRecord &r = pending.record;
+        char suffix[64] = "";
+        if (r.suppressed > 0)
+        {
+            snprintf(suffix, sizeof(suffix), " (%u similar suppressed)", r.suppressed);
+        }
+
+        if (g_use_syslog)
+        {
+            syslog(syslog_priority(r.level), "[%s] %s%s", r.subsystem, r.message, suffix);
+            return;
+        }
+
+        time_t seconds = static_cast<time_t>(r.timestamp_us / 1000000);
+        struct tm tm_buf;
+        localtime_r(&seconds, &tm_buf);
+        char time_str[32];
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_buf);
+
+        FILE *out = g_sink ? g_sink : stderr;
+        fprintf(out, "%s.%03d %-5s [%s] (t%u) %s%s\n", time_str, static_cast<int>((r.timestamp_us / 1000) % 1000),
+                level_name(r.level), r.subsystem, pending.tid, r.message, suffix);
+    }
+
+    // Moves everything currently queued in all rings to the sink, in timestamp order
+    void drain_once(std::vector<PendingRecord> &batch)
+    {
+        batch.clear();
+        uint64_t dropped = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(g_registry_mutex);
+            for (auto &ring : g_registry)
+            {
+                uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                uint64_t head = ring->head.load(std::memory_order_acquire);
+                for (uint64_t i = tail; i < head; ++i)
+                {
+                    batch.push_back({ring->records[i % LOG_RING_CAPACITY], ring->tid});
+                }
+                ring->tail.store(head, std::memory_order_release);
+                dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+            }
+        }
+
+        std::stable_sort(batch.begin(), batch.end(), [](const PendingRecord &a, const PendingRecord &b)
+                         { return a.record.timestamp_us < b.record.timestamp_us; });
+
+        std::lock_guard<std::mutex> lock(g_sink_mutex);
+        for (const auto &pending : batch)
+        {
+            emit(pending);
+        }
+        if (dropped > 0)
+        {
+            PendingRecord note{};
+            note.record.timestamp_us = now_us();
+            note.record.level = LogLevel::WARN;
+            note.record.subsystem = "log";
+            snprintf(note.record.message, LOG_MESSAGE_SIZE, "%llu messages dropped (log ring full)",
+                     static_cast<unsigned long long>(dropped));
+            emit(note);
+        }
+        if (!batch.empty() || dropped > 0)
+        {
+            fflush(g_sink ? g_sink : stderr);
+        }
+    }
+}
+
+bool LogSite::admit(uint32_t &suppressed_out)
+{
+    uint32_t limit = g_rate_limit.load(std::memory_order_relaxed);
+    if (limit == 0)
+    {
+        suppressed_out = 0;
+        return true;
+    }
+
+    int64_t now_ms = now_us() / 1000;
+    int64_t start = window_start_ms.load(std::memory_order_relaxed);
+    if (now_ms - start >= 1000 && window_start_ms.compare_exchange_strong(start, now_ms))
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    if (count.fetch_add(1, std::memory_order_relaxed) >= limit)
+    {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    suppressed_out = suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+void Logger::start(const Config &config)
+{
+    set_level(parse_level(config.log_level));
+    g_rate_limit.store(static_cast<uint32_t>(std::max(0, config.log_rate_limit)));
+
+    {
+        std::lock_guard<std::mutex> lock(g_sink_mutex);
+        g_use_syslog = config.log_syslog;
+        if (g_use_syslog)
+        {
+            openlog("harmonic", LOG_PID, LOG_USER);
+        }
+        else if (!config.log_file.empty())
+        {
+            g_sink = fopen(config.log_file.c_str(), "a");
+            if (!g_sink)
+            {
+                fprintf(stderr, "Warning: cannot open log file %s, logging to stderr\n", config.log_file.c_str());
+            }
+        }
+    }
+
+    if (g_drain_running.exchange(true))
+        return;
+
+    g_drain_thread = std::thread([]()
+                                 {
+        std::vector<PendingRecord> batch;
+        batch.reserve(LOG_RING_CAPACITY);
+        while (g_drain_running.load()) {
+            drain_once(batch);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        drain_once(batch); });
+}
+
+void Logger::stop()
+{
+    if (g_drain_running.exchange(false) && g_drain_thread.joinable())
+    {
+        g_drain_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(g_sink_mutex);
+    if (g_sink)
+    {
+        fclose(g_sink);
+        g_sink = nullptr;
+    }
+    if (g_use_syslog)
+    {
+        closelog();
+        g_use_syslog = false;
+    }
+}
+
+void Logger::set_level(LogLevel level)
+{
+    g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+bool Logger::enabled(LogLevel level)
+{
+    return static_cast<int>(level) >= g_level.load(std::memory_order_relaxed);
+}
+
+LogLevel Logger::parse_level(const std::string &name)
+{
+    if (name == "debug")
+        return LogLevel::DEBUG;
+    if (name == "warn" || name == "warning")
+        return LogLevel::WARN;
+    if (name == "error")
+        return LogLevel::ERROR;
+    return LogLevel::INFO;
+}
+
+void Logger::write(LogLevel level, LogSite &site, const char *subsystem, const char *fmt, ...)
+{
+    uint32_t suppressed = 0;
+    if (!site.admit(suppressed))
+        return;
+
+    if (!t_ring.ring)
+    {
+        t_ring.ring = acquire_ring();
+    }
+    LogRing *ring = t_ring.ring;
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_CAPACITY)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord &record = ring->records[head % LOG_RING_CAPACITY];
+    record.timestamp_us = now_us();
+    record.level = level;
+    record.suppressed = suppressed;
+    record.subsystem = subsystem;
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(record.message, LOG_MESSAGE_SIZE, fmt, args);
+    va_end(args);
+
+    ring->head.store(head + 1, std::memory_order_release);
+}
@@ -5,12 +5,17 @@
 #include <atomic>
 #include <signal.h>
 #include <fstream>
+#include <algorithm>
 
 #include "audio_engine.h"
 #include "playlist_manager.h"
 #include "network_server.h"
 #include "tui_interface.h"
 #include "config.h"
+#include "trace.h"
+#include "logger.h"
+#include "realtime.h"
+#include "metadata_parser.h"
 
 std::atomic<bool> g_running(true);
 
@@ -24,6 +29,8 @@ int main(int argc, char **argv)
     // Setup signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    // sendfile() has no MSG_NOSIGNAL; a client hanging up must not kill us
+    signal(SIGPIPE, SIG_IGN);
 
     // Load configuration
     Config config;
@@ -46,6 +53,24 @@ int main(int argc, char **argv)
         }
     }
 
+    // Diagnostics go through the async logger so they never block on the terminal the TUI owns
+    Logger::start(config);
+
+    // Scheduling classes, CPU pinning and mlockall; each role reports what it
+    // achieved the first time one of its threads starts
+    Realtime::configure(config);
+
+    // Bound what a single malformed file may cost the library scan
+    ParseLimits limits;
+    limits.max_tag_bytes = static_cast<size_t>(std::max(config.scan_max_tag_mb, 1)) << 20;
+    limits.timeout_ms = config.scan_timeout_ms;
+    MetadataParser::set_limits(limits);
+
+    // Tracing can also be toggled at runtime via POST /api/trace
+    Tracer::set_enabled(config.trace_enabled);
+    Tracer::set_thread_name("main");
+    Tracer::install_dump_signal(SIGUSR1, config.trace_file);
+
     std::cout << "🎵 Music Streaming Platform Starting...\n";
     std::cout << "Mode: " << config.get_mode_string() << "\n";
     std::cout << "Web UI: http://localhost:" << config.web_port << "\n\n";
@@ -80,21 +105,21 @@ int main(int argc, char **argv)
         }
 
         // Automatically play the first sample in the music directory
-        Track *first_track = playlist_mgr->get_current_track();
+        std::optional<Track> first_track = playlist_mgr->get_current_track();
         if (first_track && !first_track->filepath.empty())
         {
             if (audio_engine->load_track(first_track->filepath))
             {
-                std::cout << "Now playing: " << first_track->title << " by " << first_track->artist << std::endl;
+                LOG_INFO("main", "Now playing: %s by %s", first_track->title.c_str(), first_track->artist.c_str());
             }
             else
             {
-                std::cerr << "Failed to load track: " << first_track->filepath << std::endl;
+                LOG_ERROR("main", "Failed to load track: %s", first_track->filepath.c_str());
             }
         }
         else
         {
-            std::cerr << "No tracks found in music directory." << std::endl;
+            LOG_WARN("main", "No tracks found in music directory.");
         }
 
         // Start audio engine
@@ -106,13 +131,15 @@ int main(int argc, char **argv)
             try {
                 network_srv->start();
             } catch (const std::exception& e) {
-                std::cerr << "Network server failed to start: " << e.what() << std::endl;
-                std::cerr << "Continuing without web interface. TUI mode active." << std::endl;
+                LOG_ERROR("main", "Network server failed to start: %s", e.what());
+                LOG_WARN("main", "Continuing without web interface. TUI mode active.");
             } });
 
         // Run TUI on main thread
         tui->run();
 
+        LOG_INFO("realtime", "Scheduling summary: %s", Realtime::report().c_str());
+
         // Cleanup
         g_running = false;
         network_srv->stop();
@@ -125,10 +152,13 @@ int main(int argc, char **argv)
     }
     catch (const std::exception &e)
     {
+        LOG_ERROR("main", "Fatal error: %s", e.what());
+        Logger::stop();
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return 1;
     }
 
+    Logger::stop();
     std::cout << "\n👋 Goodbye!\n";
     return 0;
 }
\ No newline at end of file
@@ -1,325 +1,1124 @@
 #include "metadata_parser.h"
+#include "duration_probe.h"
+#include "file_reader.h"
+#include "text_encoding.h"
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <cstring>
-#include <vector>
 
-TrackMetadata MetadataParser::parse(const std::string &filepath)
+namespace
 {
-    TrackMetadata meta;
+    constexpr size_t MAX_TEXT_BYTES = 64 * 1024; // One tag value
+
+    std::atomic<size_t> max_tag_bytes{ParseLimits().max_tag_bytes};
+    std::atomic<int> timeout_ms{ParseLimits().timeout_ms};
+
+    // The limits for the parse() running on this thread
+    struct Budget
+    {
+        size_t max_tag_bytes = 0;
+        bool timed = false;
+        bool expired = false;
+        unsigned steps = 0;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    thread_local Budget budget;
+
+    // Counts one unit of work (a frame, block, comment, page or item) and
+    // reports whether the file has used up its time. The clock is only
+    // read every 64 steps; honest files rarely take that many.
+    bool exhausted(TrackMetadata &meta)
+    {
+        if (budget.expired)
+            return true;
+        if (!budget.timed || ++budget.steps % 64 != 0 || std::chrono::steady_clock::now() < budget.deadline)
+            return false;
+        budget.expired = true;
+        meta.truncated = true;
+        return true;
+    }
 
-    // Try ID3v2 first (at beginning of file)
-    if (parse_id3v2(filepath, meta))
+    // Cuts an oversized tag view to the size limit
+    std::string_view within_budget(std::string_view tag, TrackMetadata &meta)
     {
-        estimate_duration(filepath, meta);
-        return meta;
+        if (tag.size() <= budget.max_tag_bytes)
+            return tag;
+        meta.truncated = true;
+        return tag.substr(0, budget.max_tag_bytes);
     }
 
-    // Try ID3v1 (at end of file)
-    if (parse_id3v1(filepath, meta))
+    // A UTF-8 value cut to MAX_TEXT_BYTES on a character boundary
+    std::string clamp_text(std::string_view value, TrackMetadata &meta)
     {
-        estimate_duration(filepath, meta);
-        return meta;
+        if (value.size() <= MAX_TEXT_BYTES)
+            return std::string(value);
+        meta.truncated = true;
+        size_t length = MAX_TEXT_BYTES;
+        while (length > 0 && (static_cast<uint8_t>(value[length]) & 0xC0) == 0x80)
+            --length;
+        return std::string(value.substr(0, length));
     }
 
-    // Try FLAC/Vorbis comments
-    if (parse_vorbis_comment(filepath, meta))
+    enum class Container
     {
-        estimate_duration(filepath, meta);
-        return meta;
+        MPEG, // Also anything not recognised
+        FLAC,
+        OGG,
+        MP4,
+        WAV
+    };
+
+    uint32_t synchsafe(const uint8_t *p)
+    {
+        return (p[0] & 0x7F) << 21 | (p[1] & 0x7F) << 14 | (p[2] & 0x7F) << 7 | (p[3] & 0x7F);
     }
 
-    // Fallback to filename
-    size_t last_slash = filepath.find_last_of("/\\");
-    size_t last_dot = filepath.find_last_of('.');
+    uint32_t be32(const uint8_t *p)
+    {
+        return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 | p[3];
+    }
 
-    if (last_slash != std::string::npos && last_dot != std::string::npos)
+    uint32_t le32(const uint8_t *p)
     {
-        meta.title = filepath.substr(last_slash + 1, last_dot - last_slash - 1);
+        return p[0] | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
     }
-    else
+
+    const uint8_t *bytes_of(std::string_view view)
+    {
+        return reinterpret_cast<const uint8_t *>(view.data());
+    }
+
+    // Undoes ID3v2 unsynchronisation (FF 00 -> FF); the input is returned
+    // as is when there is nothing to undo
+    std::string_view resync(std::string_view in, std::string &buffer)
+    {
+        if (in.find(std::string_view("\xFF\x00", 2)) == std::string_view::npos)
+            return in;
+        buffer.clear();
+        buffer.reserve(in.size());
+        for (size_t i = 0; i < in.size(); ++i)
+        {
+            buffer += in[i];
+            if (static_cast<uint8_t>(in[i]) == 0xFF && i + 1 < in.size() && in[i + 1] == 0)
+                ++i;
+        }
+        return buffer;
+    }
+
+    // Whether `pos` is the end of the frames: the end of the tag, padding,
+    // or a plausible frame ID
+    bool frame_follows(std::string_view tag, size_t pos, size_t id_length)
+    {
+        if (pos == tag.size() || (pos < tag.size() && tag[pos] == 0))
+            return true;
+        if (pos > tag.size() || tag.size() - pos < id_length)
+            return false;
+        for (size_t i = 0; i < id_length; ++i)
+        {
+            char c = tag[pos + i];
+            if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+                return false;
+        }
+        return true;
+    }
+
+    // Size of a leading ID3v2 tag including its header, 0 if there is none
+    size_t id3v2_length(std::string_view file)
+    {
+        if (file.size() < 10 || file.compare(0, 3, "ID3") != 0)
+            return 0;
+        const uint8_t *h = bytes_of(file);
+        size_t length = 10 + synchsafe(h + 6) + ((h[5] & 0x10) ? 10 : 0); // Footer
+        return std::min(length, file.size());
+    }
+
+    Container sniff(std::string_view file, size_t audio_start)
+    {
+        if (file.size() >= 12 && file.compare(0, 4, "RIFF") == 0 && file.compare(8, 4, "WAVE") == 0)
+            return Container::WAV;
+        if (file.size() >= 4 && file.compare(0, 4, "OggS") == 0)
+            return Container::OGG;
+        if (file.size() >= 8 && file.compare(4, 4, "ftyp") == 0)
+            return Container::MP4;
+        if (file.size() >= audio_start + 4 && file.compare(audio_start, 4, "fLaC") == 0)
+            return Container::FLAC;
+        return Container::MPEG;
+    }
+
+    // Reads the MP4 box header at `pos` (32- or 64-bit size, or 0 for "to the
+    // end") and returns where the next box starts, 0 if the header is bad
+    size_t next_box(std::string_view file, size_t pos, size_t end, std::string_view &type, size_t &payload)
+    {
+        if (end - pos < 8)
+            return 0;
+        const uint8_t *h = bytes_of(file) + pos;
+        uint64_t size = be32(h);
+        size_t header_size = 8;
+        if (size == 1)
+        {
+            if (end - pos < 16)
+                return 0;
+            size = static_cast<uint64_t>(be32(h + 8)) << 32 | be32(h + 12);
+            header_size = 16;
+        }
+        else if (size == 0)
+        {
+            size = end - pos;
+        }
+        if (size < header_size || size > end - pos)
+            return 0;
+        type = file.substr(pos + 4, 4);
+        payload = pos + header_size;
+        return pos + static_cast<size_t>(size);
+    }
+
+    // Narrows [begin, end) to the payload of the first child box of `type`.
+    // Sibling boxes, including mdat, are stepped over by their size.
+    bool find_box(std::string_view file, size_t &begin, size_t &end, std::string_view type)
+    {
+        size_t pos = begin;
+        for (int boxes = 0; boxes < 1024 && pos < end; ++boxes)
+        {
+            std::string_view box_type;
+            size_t payload = 0;
+            size_t next = next_box(file, pos, end, box_type, payload);
+            if (next == 0)
+                return false;
+            if (box_type == type)
+            {
+                begin = payload;
+                end = next;
+                return true;
+            }
+            pos = next;
+        }
+        return false;
+    }
+
+    bool key_equals(std::string_view key, const char *upper)
+    {
+        size_t length = strlen(upper);
+        if (key.size() != length)
+            return false;
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (toupper(static_cast<unsigned char>(key[i])) != upper[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Leading digits, as atoi: "3/12" is 3
+    int parse_int(std::string_view text)
+    {
+        size_t i = 0;
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i])))
+            ++i;
+        int value = 0;
+        for (; i < text.size() && isdigit(static_cast<unsigned char>(text[i])) && value < 100000000; ++i)
+            value = value * 10 + (text[i] - '0');
+        return value;
+    }
+
+    std::string_view trim(std::string_view text)
+    {
+        size_t end = text.find_last_not_of(std::string_view("\0 \t\r\n", 5));
+        return end == std::string_view::npos ? std::string_view() : text.substr(0, end + 1);
+    }
+
+    // Notes where an embedded picture's bytes are, so that they can be served
+    // straight from the file later. Pictures that are not stored as is (e.g.
+    // inside an unsynchronised ID3 frame) are skipped. A front cover replaces
+    // any other picture seen before it.
+    void record_art(std::string_view file, std::string_view image, bool front_cover, TrackMetadata &meta)
+    {
+        uintptr_t begin = reinterpret_cast<uintptr_t>(file.data());
+        uintptr_t at = reinterpret_cast<uintptr_t>(image.data());
+        if (image.empty() || image.size() > UINT32_MAX || image.size() > file.size() || at < begin ||
+            at - begin > file.size() - image.size())
+            return;
+        if (meta.art_length > 0 && !front_cover)
+            return;
+        meta.art_offset = at - begin;
+        meta.art_length = static_cast<uint32_t>(image.size());
+    }
+
+    // Starts the limits for the parse() running on this thread
+    void start_budget()
+    {
+        budget = Budget();
+        budget.max_tag_bytes = max_tag_bytes.load(std::memory_order_relaxed);
+        int timeout = timeout_ms.load(std::memory_order_relaxed);
+        if (timeout > 0)
+        {
+            budget.timed = true;
+            budget.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        }
+    }
+
+    void title_from_path(const std::string &filepath, TrackMetadata &meta)
+    {
+        size_t last_slash = filepath.find_last_of("/\\");
+        size_t last_dot = filepath.find_last_of('.');
+
+        if (last_slash != std::string::npos && last_dot != std::string::npos)
+        {
+            meta.title = filepath.substr(last_slash + 1, last_dot - last_slash - 1);
+        }
+        else
+        {
+            meta.title = filepath;
+        }
+
+        meta.artist = "Unknown Artist";
+        meta.album = "Unknown Album";
+    }
+
+    constexpr size_t HEAD_BYTES = 16 * 1024; // Read first; holds most tags without art
+    constexpr size_t SYNC_BYTES = 4096;      // After an MP3's tag, for the first frame
+
+    // The file's bytes at `pos`, from the head when it holds them
+    bool read_at(const FileReader &file, std::string_view head, uint64_t pos, void *out, size_t count)
+    {
+        if (pos + count <= head.size())
+        {
+            memcpy(out, head.data() + pos, count);
+            return true;
+        }
+        return file.read(pos, out, count);
+    }
+
+    // Payload of the first box of `type` among the boxes in [begin, end),
+    // found by reading box headers only; narrows the range to it
+    bool seek_box(const FileReader &file, std::string_view head, uint64_t &begin, uint64_t &end, const char *type)
+    {
+        uint64_t pos = begin;
+        for (int boxes = 0; boxes < 1024 && end - pos >= 8; ++boxes)
+        {
+            uint8_t h[16];
+            if (!read_at(file, head, pos, h, 8))
+                return false;
+            uint64_t size = be32(h);
+            uint64_t header_size = 8;
+            if (size == 1)
+            {
+                if (end - pos < 16 || !read_at(file, head, pos + 8, h + 8, 8))
+                    return false;
+                size = static_cast<uint64_t>(be32(h + 8)) << 32 | be32(h + 12);
+                header_size = 16;
+            }
+            else if (size == 0)
+            {
+                size = end - pos;
+            }
+            if (size < header_size || size > end - pos)
+                return false;
+            if (memcmp(h + 4, type, 4) == 0)
+            {
+                begin = pos + header_size;
+                end = pos + size;
+                return true;
+            }
+            pos += size;
+        }
+        return false;
+    }
+
+    // Reads the parts of a file on disk that the tag parsers look at: the
+    // head up to the end of the leading tags, the ID3v1 trailer of an MP3
+    // (into `tail` unless the head reaches the end) and the payload of an
+    // MP4 moov/udta box (into `udta` unless it is within the head). The
+    // head grows by at most an ID3v2 tag and the container's own header
+    // metadata, each up to the tag size limit.
+    void read_windows(const FileReader &file, std::string &head, std::string &tail, std::string &udta,
+                      std::string_view &udta_window, uint64_t &udta_offset, TrackMetadata &meta)
     {
-        meta.title = filepath;
+        uint64_t size = file.size();
+        uint64_t limit = std::min<uint64_t>(size, 2 * static_cast<uint64_t>(budget.max_tag_bytes) + HEAD_BYTES);
+        // Grows the head to `end` bytes; false if it cannot
+        auto extend = [&](uint64_t end)
+        {
+            uint64_t until = std::min(end, limit);
+            if (until < end && end <= size)
+                meta.truncated = true;
+            if (until > head.size())
+                file.append(head.size(), static_cast<size_t>(until - head.size()), head);
+            return head.size() >= end;
+        };
+
+        extend(HEAD_BYTES);
+        uint64_t audio_start = 0;
+        if (head.size() >= 10 && head.compare(0, 3, "ID3") == 0)
+        {
+            const uint8_t *h = bytes_of(head);
+            audio_start = 10 + synchsafe(h + 6) + ((h[5] & 0x10) ? 10 : 0);
+            extend(audio_start + 4);
+        }
+
+        switch (sniff(head, std::min<uint64_t>(audio_start, head.size())))
+        {
+        case Container::MPEG:
+            // The first frames are for the duration probe
+            extend(audio_start + SYNC_BYTES + 4);
+            if (head.size() < size)
+            {
+                size_t length = static_cast<size_t>(std::min<uint64_t>(size, 128));
+                file.append(size - length, length, tail);
+            }
+            break;
+        case Container::FLAC:
+            // The metadata blocks after "fLaC"
+            for (uint64_t pos = audio_start + 4, blocks = 0; blocks < 1024 && extend(pos + 4); ++blocks)
+            {
+                const uint8_t *h = bytes_of(head) + pos;
+                bool last = (h[0] & 0x80) != 0;
+                pos += 4 + (be32(h) & 0xFFFFFF);
+                if (!extend(pos) || last)
+                    break;
+            }
+            break;
+        case Container::OGG:
+            // The pages before the first that ends an audio packet
+            for (uint64_t pos = 0, pages = 0; pages < 256 && extend(pos + 27); ++pages)
+            {
+                const uint8_t *page = bytes_of(head) + pos;
+                uint64_t granule = static_cast<uint64_t>(le32(page + 10)) << 32 | le32(page + 6);
+                if (head.compare(pos, 4, "OggS") != 0 || (pos > 0 && granule != 0 && granule != UINT64_MAX))
+                    break;
+                size_t segments = page[26];
+                if (!extend(pos + 27 + segments))
+                    break;
+                uint64_t next = pos + 27 + segments;
+                for (size_t i = 0; i < segments; ++i)
+                    next += static_cast<uint8_t>(head[pos + 27 + i]);
+                if (!extend(next))
+                    break;
+                pos = next;
+            }
+            break;
+        case Container::MP4:
+        {
+            // Only udta is read, wherever moov is; the sample tables beside
+            // it and the media data are skipped
+            uint64_t begin = 0, end = size;
+            if (!seek_box(file, head, begin, end, "moov") || !seek_box(file, head, begin, end, "udta"))
+                break;
+            uint64_t length = end - begin;
+            if (length > budget.max_tag_bytes)
+            {
+                meta.truncated = true;
+                length = budget.max_tag_bytes;
+            }
+            if (begin + length <= head.size())
+                udta_window = std::string_view(head).substr(begin, length);
+            else
+            {
+                file.append(begin, static_cast<size_t>(length), udta);
+                udta_window = udta;
+            }
+            udta_offset = begin;
+            break;
+        }
+        case Container::WAV:
+            break;
+        }
     }
+}
+
+TrackMetadata MetadataParser::parse(const std::string &filepath)
+{
+    TrackMetadata meta;
+    start_budget();
 
-    meta.artist = "Unknown Artist";
-    meta.album = "Unknown Album";
+    FileReader file(filepath);
+    std::string head, tail, udta;
+    Windows windows;
+    if (file.is_open())
+        read_windows(file, head, tail, udta, windows.udta, windows.udta_offset, meta);
+    windows.head = head;
+    windows.tail = head.size() >= file.size() ? windows.head : tail;
 
-    estimate_duration(filepath, meta);
+    if (!parse_tags(windows, meta))
+        title_from_path(filepath, meta);
+    read_duration(file.is_open() ? DurationProbe::probe_file(file, head) : AudioProperties(), file.size(), filepath, meta);
     return meta;
 }
 
-bool MetadataParser::parse_id3v2(const std::string &filepath, TrackMetadata &meta)
+void MetadataParser::set_limits(const ParseLimits &limits)
 {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file.is_open())
-        return false;
+    max_tag_bytes.store(limits.max_tag_bytes, std::memory_order_relaxed);
+    timeout_ms.store(limits.timeout_ms, std::memory_order_relaxed);
+}
 
-    // Read ID3v2 header
-    char header[10];
-    file.read(header, 10);
+TrackMetadata MetadataParser::parse(std::string_view file, const std::string &filepath)
+{
+    TrackMetadata meta;
+    start_budget();
 
-    if (file.gcount() != 10 || strncmp(header, "ID3", 3) != 0)
+    Windows windows;
+    windows.head = file;
+    windows.tail = file;
+    size_t begin = 0;
+    size_t end = file.size();
+    if (sniff(file, 0) == Container::MP4 && find_box(file, begin, end, "moov") && find_box(file, begin, end, "udta"))
     {
-        return false;
+        windows.udta = file.substr(begin, end - begin);
+        windows.udta_offset = begin;
+    }
+
+    if (!parse_tags(windows, meta))
+        title_from_path(filepath, meta);
+    read_duration(DurationProbe::probe_bytes(file), file.size(), filepath, meta);
+    return meta;
+}
+
+bool MetadataParser::parse_tags(const Windows &file, TrackMetadata &meta)
+{
+    size_t audio_start = id3v2_length(file.head);
+    switch (sniff(file.head, audio_start))
+    {
+    case Container::FLAC:
+        // Prefer the ID3v2 tag some encoders put in front
+        return parse_id3v2(file.head, meta) || parse_vorbis_comment(file.head, audio_start, meta);
+    case Container::MPEG:
+        return parse_id3v2(file.head, meta) || parse_id3v1(file.tail, meta);
+    case Container::WAV:
+        return parse_id3v2(file.head, meta);
+    case Container::OGG:
+        return parse_ogg_comments(file.head, meta);
+    case Container::MP4:
+        return parse_mp4_tags(file.udta, file.udta_offset, meta);
     }
+    return false;
+}
+
+bool MetadataParser::parse_id3v2(std::string_view file, TrackMetadata &meta)
+{
+    if (id3v2_length(file) < 10)
+        return false;
 
-    // Parse version
+    const uint8_t *header = bytes_of(file);
     uint8_t version = header[3];
-    // (revision and flags reserved for future use)
+    uint8_t flags = header[5];
+    // (revision reserved for future use)
+    if (version < 2 || version > 4)
+        return false;
+    if (version == 2 && (flags & 0x40))
+        return false; // v2.2 compression was never defined
 
-    // Parse size (synchsafe integer)
-    uint32_t size = 0;
-    size |= (header[6] & 0x7F) << 21;
-    size |= (header[7] & 0x7F) << 14;
-    size |= (header[8] & 0x7F) << 7;
-    size |= (header[9] & 0x7F);
+    std::string_view tag = within_budget(file.substr(10, synchsafe(header + 6)), meta);
 
-    // Read tag data
-    std::vector<char> tag_data(size);
-    file.read(tag_data.data(), size);
+    // Before v2.4 unsynchronisation covers the whole tag, extended header
+    // included; v2.4 applies it frame by frame
+    bool unsynchronised = (flags & 0x80) != 0;
+    std::string resynced;
+    if (unsynchronised && version < 4)
+        tag = resync(tag, resynced);
 
-    // Parse frames based on version
-    if (version == 3 || version == 4)
+    if (version >= 3 && (flags & 0x40))
     {
-        parse_id3v2_frames(tag_data.data(), size, version, meta);
+        // Extended header: v2.3 gives its size excluding the size field,
+        // v2.4 as a synchsafe integer including it
+        if (tag.size() < 4)
+            return false;
+        size_t extended = version == 4 ? synchsafe(bytes_of(tag)) : static_cast<size_t>(be32(bytes_of(tag))) + 4;
+        if (extended > tag.size())
+            return false;
+        tag.remove_prefix(extended);
     }
 
+    parse_id3v2_frames(file, tag, version, unsynchronised && version == 4, meta);
     return !meta.title.empty() || !meta.artist.empty();
 }
 
-void MetadataParser::parse_id3v2_frames(const char *data, size_t size, uint8_t version, TrackMetadata &meta)
+void MetadataParser::parse_id3v2_frames(std::string_view file, std::string_view tag, uint8_t version, bool unsynchronised, TrackMetadata &meta)
 {
+    const uint8_t *data = bytes_of(tag);
+    const size_t header_size = version == 2 ? 6 : 10;
+    std::string resynced;
     size_t pos = 0;
 
-    while (pos + 10 < size)
+    while (tag.size() - pos >= header_size && !exhausted(meta))
     {
-        // Frame header (10 bytes for v2.3/v2.4)
-        char frame_id[5] = {0};
-        memcpy(frame_id, data + pos, 4);
-
-        if (frame_id[0] == 0)
+        // Frame header: v2.2 has a 3-character ID and 3-byte size, no flags
+        const uint8_t *header = data + pos;
+        if (header[0] == 0)
             break; // Padding
 
-        uint32_t frame_size = 0;
-        if (version == 4)
+        std::string_view frame_id = tag.substr(pos, version == 2 ? 3 : 4);
+        size_t frame_size;
+        uint8_t format_flags = 0;
+        if (version == 2)
         {
-            // Synchsafe integer
-            frame_size |= (data[pos + 4] & 0x7F) << 21;
-            frame_size |= (data[pos + 5] & 0x7F) << 14;
-            frame_size |= (data[pos + 6] & 0x7F) << 7;
-            frame_size |= (data[pos + 7] & 0x7F);
+            frame_size = static_cast<size_t>(header[3]) << 16 | header[4] << 8 | header[5];
+        }
+        else if (version == 3)
+        {
+            frame_size = be32(header + 4);
+            format_flags = header[9];
         }
         else
         {
-            // Regular integer
-            frame_size |= (uint8_t)data[pos + 4] << 24;
-            frame_size |= (uint8_t)data[pos + 5] << 16;
-            frame_size |= (uint8_t)data[pos + 6] << 8;
-            frame_size |= (uint8_t)data[pos + 7];
+            // Synchsafe, but some writers (notably iTunes) store a plain
+            // integer; take whichever lands on the next frame
+            frame_size = synchsafe(header + 4);
+            size_t plain = be32(header + 4);
+            if (plain != frame_size && !frame_follows(tag, pos + 10 + frame_size, 4) &&
+                frame_follows(tag, pos + 10 + plain, 4))
+                frame_size = plain;
+            format_flags = header[9];
         }
 
-        pos += 10; // Skip frame header
+        pos += header_size; // Skip frame header
 
-        if (pos + frame_size > size)
+        if (frame_size > tag.size() - pos)
             break;
+        std::string_view body = tag.substr(pos, frame_size);
+        pos += frame_size;
 
-        // Extract text (skip encoding byte)
-        std::string text;
-        if (frame_size > 1)
+        // Text frames and pictures only
+        bool picture = frame_id == "APIC" || frame_id == "PIC";
+        if (!picture && (frame_id[0] != 'T' || frame_id == "TXX" || frame_id == "TXXX"))
+            continue;
+
+        size_t skip = 0;
+        if (version == 3)
         {
-            uint8_t encoding = data[pos];
-            text = extract_text(data + pos + 1, frame_size - 1, encoding);
-        }
-
-        // Map frame ID to metadata field
-        if (strcmp(frame_id, "TIT2") == 0)
-            meta.title = text;
-        else if (strcmp(frame_id, "TPE1") == 0)
-            meta.artist = text;
-        else if (strcmp(frame_id, "TALB") == 0)
-            meta.album = text;
-        else if (strcmp(frame_id, "TYER") == 0 || strcmp(frame_id, "TDRC") == 0)
-            meta.year = text;
-        else if (strcmp(frame_id, "TCON") == 0)
-            meta.genre = text;
+            if (format_flags & 0xC0)
+                continue; // Compressed or encrypted
+            if (format_flags & 0x20)
+                skip += 1; // Grouping identity
+        }
+        else if (version == 4)
+        {
+            if (format_flags & 0x0C)
+                continue; // Compressed or encrypted
+            if (format_flags & 0x40)
+                skip += 1; // Grouping identity
+            if (format_flags & 0x01)
+                skip += 4; // Data length indicator
+        }
+        if (skip > body.size())
+            continue;
+        body.remove_prefix(skip);
+        if (version == 4 && (unsynchronised || (format_flags & 0x02)))
+            body = resync(body, resynced);
+        if (body.size() < 2)
+            continue;
 
-        pos += frame_size;
+        if (picture)
+        {
+            parse_id3v2_picture(file, body, version, meta);
+            continue;
+        }
+
+        // Map frame ID to metadata field; the text follows the encoding byte
+        std::string *field = nullptr;
+        int *number = nullptr;
+        if (frame_id == "TIT2" || frame_id == "TT2")
+            field = &meta.title;
+        else if (frame_id == "TPE1" || frame_id == "TP1")
+            field = &meta.artist;
+        else if (frame_id == "TALB" || frame_id == "TAL")
+            field = &meta.album;
+        else if (frame_id == "TYER" || frame_id == "TDRC" || frame_id == "TYE")
+            field = &meta.year;
+        else if (frame_id == "TCON" || frame_id == "TCO")
+            field = &meta.genre;
+        else if (frame_id == "TBPM" || frame_id == "TBP")
+            number = &meta.bpm;
+        else if (frame_id == "TRCK" || frame_id == "TRK") // "3" or "3/12"
+            number = &meta.track_number;
+        else if (frame_id == "TPOS" || frame_id == "TPA")
+            number = &meta.disc;
+        else
+            continue;
+
+        // An even cut, so that UTF-16 text stays aligned
+        std::string_view raw = body.substr(1);
+        if (raw.size() > MAX_TEXT_BYTES)
+        {
+            raw = raw.substr(0, MAX_TEXT_BYTES);
+            meta.truncated = true;
+        }
+        std::string text = extract_text(raw, static_cast<uint8_t>(body[0]));
+        if (field == &meta.genre)
+            meta.genre = resolve_genre(text);
+        else if (field)
+            *field = std::move(text);
+        else
+            *number = parse_int(text);
     }
 }
 
-std::string MetadataParser::extract_text(const char *data, size_t size, uint8_t encoding)
+void MetadataParser::parse_id3v2_picture(std::string_view file, std::string_view body, uint8_t version, TrackMetadata &meta)
 {
-    std::string result;
+    // Text encoding, MIME type (a 3-character format in v2.2), picture
+    // type, description, then the image
+    uint8_t encoding = static_cast<uint8_t>(body[0]);
+    size_t pos = 1;
+    if (version == 2)
+    {
+        pos += 3;
+    }
+    else
+    {
+        pos = body.find('\0', pos);
+        if (pos == std::string_view::npos)
+            return;
+        ++pos;
+    }
+    if (pos >= body.size())
+        return;
+    bool front_cover = body[pos++] == 3;
 
-    if (encoding == 0 || encoding == 3)
+    // The description ends in a terminator of the text encoding's width
+    if (encoding == 1 || encoding == 2)
     {
-        // ISO-8859-1 or UTF-8
-        result = std::string(data, size);
+        while (pos + 1 < body.size() && (body[pos] != 0 || body[pos + 1] != 0))
+            pos += 2;
+        pos += 2;
     }
-    else if (encoding == 1)
+    else
     {
-        // UTF-16 with BOM
-        // Simplified: just extract ASCII-compatible characters
-        for (size_t i = 2; i < size; i += 2)
-        {
-            if (data[i + 1] == 0 && data[i] != 0)
-            {
-                result += data[i];
-            }
-        }
+        pos = body.find('\0', pos);
+        if (pos == std::string_view::npos)
+            return;
+        ++pos;
     }
+    if (pos >= body.size())
+        return;
+
+    record_art(file, body.substr(pos), front_cover, meta);
+}
 
-    // Trim null terminators and whitespace
-    size_t end = result.find_last_not_of("\0 \t\r\n");
-    if (end != std::string::npos)
+std::string MetadataParser::extract_text(std::string_view data, uint8_t encoding)
+{
+    // v2.4 frames may hold several values separated by terminators; they
+    // are joined with "; ". Each UTF-16 value may carry its own BOM.
+    const size_t unit = (encoding == 1 || encoding == 2) ? 2 : 1;
+    std::string result;
+    size_t start = 0;
+    while (start + unit <= data.size())
     {
-        result = result.substr(0, end + 1);
+        size_t end = start;
+        while (end + unit <= data.size() && (data[end] != 0 || (unit == 2 && data[end + 1] != 0)))
+            end += unit;
+        std::string_view raw = data.substr(start, end - start);
+        start = end + unit;
+
+        size_t mark = result.size();
+        if (!result.empty())
+            result += "; ";
+        size_t value_start = result.size();
+        switch (encoding)
+        {
+        case 0: // ISO-8859-1
+            TextEncoding::latin1_to_utf8(raw, result);
+            break;
+        case 1: // UTF-16 with BOM
+            TextEncoding::utf16_bom_to_utf8(raw, result);
+            break;
+        case 2: // UTF-16BE
+            TextEncoding::utf16_to_utf8(raw, true, result);
+            break;
+        case 3: // UTF-8
+            result.append(raw);
+            break;
+        default:
+            return std::string();
+        }
+
+        // Trim trailing whitespace; drop empty values
+        size_t kept = trim(std::string_view(result).substr(value_start)).size();
+        result.resize(kept ? value_start + kept : mark);
     }
 
     return result;
 }
 
-bool MetadataParser::parse_id3v1(const std::string &filepath, TrackMetadata &meta)
+std::string MetadataParser::resolve_genre(const std::string &text)
 {
-    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
-    if (!file.is_open())
-        return false;
+    // ID3v2.3 references ID3v1 genres as "(17)", optionally refined by
+    // text ("(17)Hard Rock"); v2.4 writes a bare "17", one per value. "(("
+    // escapes a literal parenthesis.
+    auto numeric = [](std::string_view s)
+    { return !s.empty() && s.size() <= 3 && s.find_first_not_of("0123456789") == std::string_view::npos; };
 
-    std::streampos file_size = file.tellg();
-    if (file_size < 128)
-        return false;
+    std::string result;
+    std::string_view rest = text;
+    while (!rest.empty())
+    {
+        size_t separator = rest.find("; ");
+        std::string_view value = rest.substr(0, separator);
+        rest = separator == std::string_view::npos ? std::string_view() : rest.substr(separator + 2);
+
+        if (!result.empty())
+            result += "; ";
+        size_t close = value.find(')');
+        if (value.size() > 1 && value[0] == '(' && value[1] != '(' && close != std::string_view::npos)
+        {
+            std::string_view reference = value.substr(1, close - 1);
+            if (close + 1 < value.size())
+                result.append(value.substr(close + 1));
+            else if (reference == "RX")
+                result += "Remix";
+            else if (reference == "CR")
+                result += "Cover";
+            else if (numeric(reference))
+                result += get_id3v1_genre(static_cast<uint8_t>(std::min(parse_int(reference), 255)));
+            else
+                result.append(value);
+        }
+        else if (value.size() > 1 && value[0] == '(' && value[1] == '(')
+        {
+            result.append(value.substr(1));
+        }
+        else if (numeric(value))
+        {
+            result += get_id3v1_genre(static_cast<uint8_t>(std::min(parse_int(value), 255)));
+        }
+        else
+        {
+            result.append(value);
+        }
+    }
+    return result;
+}
 
-    // Read last 128 bytes
-    file.seekg(-128, std::ios::end);
-    char tag[128];
-    file.read(tag, 128);
+bool MetadataParser::parse_id3v1(std::string_view file, TrackMetadata &meta)
+{
+    if (file.size() < 128)
+        return false;
 
-    if (file.gcount() != 128 || strncmp(tag, "TAG", 3) != 0)
+    // Last 128 bytes
+    std::string_view tag = file.substr(file.size() - 128);
+    if (tag.compare(0, 3, "TAG") != 0)
     {
         return false;
     }
 
-    // Extract fields
-    meta.title = std::string(tag + 3, 30);
-    meta.artist = std::string(tag + 33, 30);
-    meta.album = std::string(tag + 63, 30);
-    meta.year = std::string(tag + 93, 4);
-
-    // Trim spaces
-    auto trim = [](std::string &s)
+    // Extract fields, trimming spaces; the text is ISO-8859-1
+    auto field = [&](size_t offset, size_t width)
     {
-        s.erase(s.find_last_not_of(" \0\t\r\n") + 1);
+        std::string text;
+        std::string_view raw = tag.substr(offset, width);
+        TextEncoding::latin1_to_utf8(trim(raw.substr(0, raw.find('\0'))), text);
+        return text;
     };
+    meta.title = field(3, 30);
+    meta.artist = field(33, 30);
+    meta.album = field(63, 30);
+    meta.year = field(93, 4);
 
-    trim(meta.title);
-    trim(meta.artist);
-    trim(meta.album);
-    trim(meta.year);
+    // ID3v1.1 keeps the track number in the last byte of the comment
+    if (tag[125] == 0 && tag[126] != 0)
+        meta.track_number = static_cast<uint8_t>(tag[126]);
 
     // Genre
-    uint8_t genre_id = tag[127];
+    uint8_t genre_id = static_cast<uint8_t>(tag[127]);
     meta.genre = get_id3v1_genre(genre_id);
 
     return true;
 }
 
-bool MetadataParser::parse_vorbis_comment(const std::string &filepath, TrackMetadata &meta)
+bool MetadataParser::parse_vorbis_comment(std::string_view file, size_t offset, TrackMetadata &meta)
 {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file.is_open())
-        return false;
-
-    // Check for FLAC
-    char flac_header[4];
-    file.read(flac_header, 4);
-
-    if (strncmp(flac_header, "fLaC", 4) != 0)
-    {
-        return false; // Not FLAC
-    }
-
-    // Read metadata blocks
-    while (file.good())
+    // Metadata blocks follow the "fLaC" marker; pictures may come before
+    // or after the comments
+    bool found = false;
+    size_t pos = offset + 4;
+    for (int blocks = 0; blocks < 1024 && pos + 4 <= file.size() && !exhausted(meta); ++blocks)
     {
-        uint8_t header_byte;
-        file.read((char *)&header_byte, 1);
-
-        bool is_last = (header_byte & 0x80) != 0;
-        uint8_t block_type = header_byte & 0x7F;
-
-        uint32_t block_size = 0;
-        file.read((char *)&block_size, 3);
-        block_size = (block_size >> 16) | ((block_size & 0xFF00)) | ((block_size & 0xFF) << 16);
+        const uint8_t *header = bytes_of(file) + pos;
+        bool is_last = (header[0] & 0x80) != 0;
+        uint8_t block_type = header[0] & 0x7F;
+        size_t block_size = static_cast<size_t>(header[1]) << 16 | header[2] << 8 | header[3];
+        pos += 4;
+        if (block_size > file.size() - pos)
+            break;
 
         if (block_type == 4)
         { // VORBIS_COMMENT
-            parse_vorbis_block(file, block_size, meta);
-            return true;
+            parse_vorbis_block(file.substr(pos, block_size), meta);
+            found = true;
         }
-        else
-        {
-            file.seekg(block_size, std::ios::cur);
+        else if (block_type == 6)
+        { // PICTURE
+            parse_flac_picture(file, file.substr(pos, block_size), meta);
         }
+        pos += block_size;
 
         if (is_last)
             break;
     }
 
-    return false;
+    return found;
+}
+
+void MetadataParser::parse_flac_picture(std::string_view file, std::string_view block, TrackMetadata &meta)
+{
+    // Picture type, MIME type and description (each length-prefixed),
+    // width, height, depth, colour count, then the length-prefixed image
+    const uint8_t *data = bytes_of(block);
+    if (block.size() < 8)
+        return;
+    bool front_cover = be32(data) == 3;
+    size_t pos = 4;
+    for (int field = 0; field < 2; ++field)
+    {
+        size_t length = be32(data + pos);
+        pos += 4;
+        if (length > block.size() - pos || block.size() - pos - length < 4)
+            return;
+        pos += length;
+    }
+    if (block.size() - pos < 20)
+        return;
+    pos += 16;
+    size_t length = be32(data + pos);
+    pos += 4;
+    if (length > block.size() - pos)
+        return;
+
+    record_art(file, block.substr(pos, length), front_cover, meta);
 }
 
-void MetadataParser::parse_vorbis_block(std::ifstream &file, uint32_t size, TrackMetadata &meta)
+void MetadataParser::parse_vorbis_block(std::string_view block, TrackMetadata &meta)
 {
+    block = within_budget(block, meta);
+    const uint8_t *data = bytes_of(block);
+
     // Skip vendor string
-    uint32_t vendor_len;
-    file.read((char *)&vendor_len, 4);
-    file.seekg(vendor_len, std::ios::cur);
+    if (block.size() < 4)
+        return;
+    size_t pos = 4 + static_cast<size_t>(le32(data));
+    if (pos > block.size() || block.size() - pos < 4)
+        return;
 
-    // Read comment count
-    uint32_t comment_count;
-    file.read((char *)&comment_count, 4);
+    // Comment count
+    uint32_t comment_count = le32(data + pos);
+    pos += 4;
 
-    for (uint32_t i = 0; i < comment_count && file.good(); ++i)
+    for (uint32_t i = 0; i < comment_count && block.size() - pos >= 4 && !exhausted(meta); ++i)
     {
-        uint32_t comment_len;
-        file.read((char *)&comment_len, 4);
+        size_t comment_len = le32(data + pos);
+        pos += 4;
+        if (comment_len > block.size() - pos)
+            break;
+        std::string_view comment = block.substr(pos, comment_len);
+        pos += comment_len;
 
-        if (comment_len > 1024)
-            continue; // Sanity check
+        size_t eq_pos = comment.find('=');
+        if (eq_pos == std::string_view::npos)
+            continue;
 
-        std::string comment(comment_len, '\0');
-        file.read(&comment[0], comment_len);
+        std::string_view key = comment.substr(0, eq_pos);
+        std::string_view value = comment.substr(eq_pos + 1);
 
-        size_t eq_pos = comment.find('=');
-        if (eq_pos != std::string::npos)
+        if (key_equals(key, "TITLE"))
+            meta.title = clamp_text(value, meta);
+        else if (key_equals(key, "ARTIST"))
+            meta.artist = clamp_text(value, meta);
+        else if (key_equals(key, "ALBUM"))
+            meta.album = clamp_text(value, meta);
+        else if (key_equals(key, "DATE"))
+            meta.year = clamp_text(value, meta);
+        else if (key_equals(key, "GENRE"))
+            meta.genre = clamp_text(value, meta);
+        else if (key_equals(key, "BPM"))
+            meta.bpm = parse_int(value);
+        else if (key_equals(key, "TRACKNUMBER"))
+            meta.track_number = parse_int(value);
+        else if (key_equals(key, "DISCNUMBER"))
+            meta.disc = parse_int(value);
+    }
+}
+
+bool MetadataParser::parse_ogg_comments(std::string_view file, TrackMetadata &meta)
+{
+    // Walk the pages of the first logical stream and reassemble its second
+    // packet, the comment header. It usually fits in one page and is then
+    // parsed in place; only a packet spanning pages (e.g. with embedded
+    // cover art) is copied.
+    const size_t MAX_PAGES = 256;
+    const uint8_t *data = bytes_of(file);
+    uint32_t serial = 0;
+    size_t packet_index = 0;
+    std::string_view codec; // Start of the identification packet
+    std::string spanning;
+
+    size_t pos = 0;
+    for (size_t pages = 0; pages < MAX_PAGES && file.size() - pos >= 27 && !exhausted(meta); ++pages)
+    {
+        if (file.compare(pos, 4, "OggS") != 0)
+            return false;
+        const uint8_t *page = data + pos;
+        size_t segments = page[26];
+        size_t body = pos + 27 + segments;
+        if (body > file.size())
+            return false;
+        size_t next = body;
+        for (size_t i = 0; i < segments; ++i)
+            next += page[27 + i];
+        if (next > file.size())
+            return false;
+
+        if (pos == 0)
+            serial = le32(page + 14);
+        else if (le32(page + 14) != serial)
+        {
+            pos = next; // Another multiplexed stream
+            continue;
+        }
+
+        size_t packet_start = body;
+        size_t end = body;
+        for (size_t i = 0; i < segments; ++i)
+        {
+            end += page[27 + i];
+            if (page[27 + i] == 255)
+                continue; // The packet goes on
+
+            if (packet_index == 0)
+            {
+                codec = file.substr(packet_start, end - packet_start);
+            }
+            else
+            {
+                std::string_view packet = file.substr(packet_start, end - packet_start);
+                if (!spanning.empty())
+                {
+                    spanning.append(packet);
+                    packet = spanning;
+                }
+
+                // Strip the codec's header prefix to reach the comment block
+                if (codec.compare(0, 7, "\x01vorbis") == 0 && packet.compare(0, 7, "\x03vorbis") == 0)
+                    packet.remove_prefix(7);
+                else if (codec.compare(0, 8, "OpusHead") == 0 && packet.compare(0, 8, "OpusTags") == 0)
+                    packet.remove_prefix(8);
+                else if (codec.compare(0, 5, "\x7F" "FLAC") == 0 && !packet.empty() && (packet[0] & 0x7F) == 4)
+                    packet.remove_prefix(std::min<size_t>(4, packet.size())); // A VORBIS_COMMENT metadata block
+                else if (codec.compare(0, 8, "Speex   ") != 0)
+                    return false;
+                parse_vorbis_block(packet, meta);
+                return true;
+            }
+            packet_index++;
+            packet_start = end;
+        }
+
+        // The comment packet continues on the next page
+        if (packet_index == 1 && packet_start < end)
         {
-            std::string key = comment.substr(0, eq_pos);
-            std::string value = comment.substr(eq_pos + 1);
+            if (spanning.size() + (end - packet_start) > budget.max_tag_bytes)
+            {
+                meta.truncated = true;
+                return false;
+            }
+            spanning.append(file.substr(packet_start, end - packet_start));
+        }
+        pos = next;
+    }
+
+    return false;
+}
 
-            // Convert to uppercase for comparison
-            std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+bool MetadataParser::parse_mp4_tags(std::string_view udta, uint64_t udta_offset, TrackMetadata &meta)
+{
+    // udta/meta/ilst; the media data is never touched
+    std::string_view file = udta;
+    size_t begin = 0;
+    size_t end = file.size();
+    if (!find_box(file, begin, end, "meta"))
+        return false;
+
+    // ISO meta is a full box with version and flags before its children;
+    // QuickTime's is not
+    if (end - begin >= 8 && file.compare(begin + 4, 4, "hdlr") != 0)
+        begin += 4;
+    if (!find_box(file, begin, end, "ilst"))
+        return false;
 
-            if (key == "TITLE")
-                meta.title = value;
-            else if (key == "ARTIST")
-                meta.artist = value;
-            else if (key == "ALBUM")
-                meta.album = value;
-            else if (key == "DATE")
-                meta.year = value;
-            else if (key == "GENRE")
-                meta.genre = value;
+    // Each item box holds its value in a data box: 4 bytes of type, 4 of
+    // locale, then the value
+    size_t pos = begin;
+    for (int items = 0; items < 1024 && pos < end && !exhausted(meta); ++items)
+    {
+        std::string_view type;
+        size_t payload = 0;
+        size_t next = next_box(file, pos, end, type, payload);
+        if (next == 0)
+            break;
+        size_t data = payload;
+        size_t data_end = next;
+        if (find_box(file, data, data_end, "data") && data_end - data >= 8)
+        {
+            std::string_view value = file.substr(data + 8, data_end - data - 8);
+            if (type == "covr")
+            {
+                if (meta.art_length == 0) // Untyped; keep the first
+                {
+                    record_art(file, value, true, meta);
+                    if (meta.art_length > 0)
+                        meta.art_offset += udta_offset;
+                }
+            }
+            else
+                parse_mp4_item(type, value, meta);
         }
+        pos = next;
+    }
+
+    return !meta.title.empty() || !meta.artist.empty();
+}
+
+void MetadataParser::parse_mp4_item(std::string_view type, std::string_view data, TrackMetadata &meta)
+{
+    const uint8_t *value = bytes_of(data);
+
+    if (type == "\xA9" "nam")
+        meta.title = clamp_text(data, meta);
+    else if (type == "\xA9" "ART")
+        meta.artist = clamp_text(data, meta);
+    else if (type == "\xA9" "alb")
+        meta.album = clamp_text(data, meta);
+    else if (type == "\xA9" "day")
+        meta.year = clamp_text(data, meta);
+    else if (type == "\xA9" "gen")
+        meta.genre = clamp_text(data, meta);
+    else if (type == "gnre" && data.size() >= 2) // ID3v1 genre + 1
+    {
+        int id = value[0] << 8 | value[1];
+        if (id > 0 && id <= 256)
+            meta.genre = get_id3v1_genre(static_cast<uint8_t>(id - 1));
     }
+    else if ((type == "trkn" || type == "disk") && data.size() >= 4) // Reserved, number, total
+        (type == "trkn" ? meta.track_number : meta.disc) = value[2] << 8 | value[3];
+    else if (type == "tmpo" && data.size() >= 2)
+        meta.bpm = value[0] << 8 | value[1];
 }
 
-void MetadataParser::estimate_duration(const std::string &filepath, TrackMetadata &meta)
+void MetadataParser::read_duration(const AudioProperties &props, uint64_t file_size, const std::string &filepath, TrackMetadata &meta)
 {
-    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
-    if (!file.is_open())
+    if (props.duration_ms <= 0)
+    {
+        estimate_duration(file_size, filepath, meta);
         return;
+    }
+    meta.duration_ms = props.duration_ms;
+    meta.duration_seconds = props.duration_ms / 1000;
+    meta.bitrate = props.bitrate_kbps;
+}
 
-    size_t file_size = file.tellg();
+// Last resort for formats the probe does not know: a typical bitrate
+void MetadataParser::estimate_duration(uint64_t file_size, const std::string &filepath, TrackMetadata &meta)
+{
+    if (file_size == 0)
+        return;
 
     // Rough estimation based on file size and typical bitrates
     // This is approximate - real duration requires full parsing
@@ -337,19 +1136,52 @@ void MetadataParser::estimate_duration(const std::string &filepath, TrackMetadat
         estimated_bitrate = 1411000; // CD quality WAV
     }
 
-    meta.duration_seconds = (file_size * 8) / estimated_bitrate;
+    meta.duration_seconds = static_cast<int>(file_size * 8 / estimated_bitrate);
+    meta.duration_ms = static_cast<int>(file_size * 8000 / estimated_bitrate);
     meta.bitrate = estimated_bitrate / 1000;
 }
 
 std::string MetadataParser::get_id3v1_genre(uint8_t id)
 {
+    // ID3v1 genres 0-79 and the Winamp extensions
     static const char *genres[] = {
         "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge",
         "Hip-Hop", "Jazz", "Metal", "New Age", "Oldies", "Other", "Pop", "R&B",
         "Rap", "Reggae", "Rock", "Techno", "Industrial", "Alternative", "Ska",
-        "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient"};
+        "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient",
+        "Trip-Hop", "Vocal", "Jazz+Funk", "Fusion", "Trance", "Classical",
+        "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+        "Alternative Rock", "Bass", "Soul", "Punk", "Space", "Meditative",
+        "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic", "Darkwave",
+        "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream",
+        "Southern Rock", "Comedy", "Cult", "Gangsta", "Top 40", "Christian Rap",
+        "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave",
+        "Psychedelic", "Rave", "Showtunes", "Trailer", "Lo-Fi", "Tribal",
+        "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll",
+        "Hard Rock", "Folk", "Folk-Rock", "National Folk", "Swing",
+        "Fast Fusion", "Bebop", "Latin", "Revival", "Celtic", "Bluegrass",
+        "Avantgarde", "Gothic Rock", "Progressive Rock", "Psychedelic Rock",
+        "Symphonic Rock", "Slow Rock", "Big Band", "Chorus", "Easy Listening",
+        "Acoustic", "Humour", "Speech", "Chanson", "Opera", "Chamber Music",
+        "Sonata", "Symphony", "Booty Bass", "Primus", "Porn Groove", "Satire",
+        "Slow Jam", "Club", "Tango", "Samba", "Folklore", "Ballad",
+        "Power Ballad", "Rhythmic Soul", "Freestyle", "Duet", "Punk Rock",
+        "Drum Solo", "A Cappella", "Euro-House", "Dance Hall", "Goa",
+        "Drum & Bass", "Club-House", "Hardcore", "Terror", "Indie", "Britpop",
+        "Afro-Punk", "Polsk Punk", "Beat", "Christian Gangsta Rap",
+        "Heavy Metal", "Black Metal", "Crossover", "Contemporary Christian",
+        "Christian Rock", "Merengue", "Salsa", "Thrash Metal", "Anime", "JPop",
+        "Synthpop", "Abstract", "Art Rock", "Baroque", "Bhangra", "Big Beat",
+        "Breakbeat", "Chillout", "Downtempo", "Dub", "EBM", "Eclectic",
+        "Electro", "Electroclash", "Emo", "Experimental", "Garage", "Global",
+        "IDM", "Illbient", "Industro-Goth", "Jam Band", "Krautrock", "Leftfield",
+        "Lounge", "Math Rock", "New Romantic", "Nu-Breakz", "Post-Punk",
+        "Post-Rock", "Psytrance", "Shoegaze", "Space Rock", "Trop Rock",
+        "World Music", "Neoclassical", "Audiobook", "Audio Theatre",
+        "Neue Deutsche Welle", "Podcast", "Indie Rock", "G-Funk", "Dubstep",
+        "Garage Rock", "Psybient"};
 
-    if (id < 27)
+    if (id < sizeof(genres) / sizeof(genres[0]))
         return genres[id];
     return "Unknown";
 }
@@ -1,4 +1,8 @@
 #include "network_server.h"
+#include "pcm_utils.h"
+#include "trace.h"
+#include "logger.h"
+#include "realtime.h"
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -8,6 +12,7 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/sendfile.h>
 #include <thread>
 #include <chrono>
 #include <algorithm>
@@ -22,7 +27,7 @@ void NetworkServer::init_libshout()
 
     if (!shout_conn)
     {
-        std::cerr << "Failed to create shout connection" << std::endl;
+        LOG_ERROR("shout", "Failed to create shout connection");
         return;
     }
 
@@ -37,12 +42,12 @@ void NetworkServer::init_libshout()
     if (config.stream_format == "ogg")
     {
         shout_set_format(shout_conn, SHOUT_FORMAT_OGG);
-        std::cout << "  → Streaming format: OGG/Vorbis" << std::endl;
+        LOG_INFO("shout", "Streaming format: OGG/Vorbis");
     }
     else
     {
         shout_set_format(shout_conn, SHOUT_FORMAT_MP3);
-        std::cout << "  → Streaming format: MP3" << std::endl;
+        LOG_INFO("shout", "Streaming format: MP3");
     }
 
     // Set audio parameters for proper encoding
@@ -66,7 +71,7 @@ void NetworkServer::init_libshout()
     shout_set_description(shout_conn, config.stream_description.c_str());
     shout_set_genre(shout_conn, config.stream_genre.c_str());
 
-    std::cout << "✓ Libshout initialized for streaming to " << config.stream_host << ":" << config.stream_server_port << config.stream_mount << std::endl;
+    LOG_INFO("shout", "Libshout initialized for streaming to %s:%d%s", config.stream_host.c_str(), config.stream_server_port, config.stream_mount.c_str());
 }
 
 void NetworkServer::start_libshout_streaming()
@@ -76,12 +81,15 @@ void NetworkServer::start_libshout_streaming()
 
     if (shout_open(shout_conn) != SHOUTERR_SUCCESS)
     {
-        std::cerr << "Failed to open shout connection: " << shout_get_error(shout_conn) << std::endl;
+        LOG_ERROR("shout", "Failed to open shout connection: %s", shout_get_error(shout_conn));
         return;
     }
 
     shout_streaming_thread = std::thread([this]()
                                          {
+        Tracer::set_thread_name("shout-stream");
+        Realtime::apply_to_current_thread(ThreadRole::ENCODER);
+
         // Use buffer size from config for consistent audio processing
         const size_t CHUNK_SIZE = config.buffer_size; // Request frames, not samples
         static bool first_buffer = true;
@@ -99,8 +107,7 @@ void NetworkServer::start_libshout_streaming()
                 for (float sample : buffer) {
                     max_sample = std::max(max_sample, std::abs(sample));
                 }
-                std::cout << "[STREAM] First buffer received - max amplitude: " << max_sample 
-                          << ", buffer size: " << buffer.size() << std::endl;
+                LOG_INFO("shout", "First buffer received - max amplitude: %f, buffer size: %zu", max_sample, buffer.size());
                 first_buffer = false;
             }
 
@@ -111,24 +118,24 @@ void NetworkServer::start_libshout_streaming()
             std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(buffer_duration_ms))); // Match buffer duration for proper timing
         } });
 
-    std::cout << "✓ Libshout streaming started" << std::endl;
+    LOG_INFO("shout", "Libshout streaming started");
 }
 
 void NetworkServer::encode_and_send_audio(const std::vector<float> &buffer)
 {
     // Convert float32 to int16 PCM
     std::vector<int16_t> pcm_data(buffer.size());
-    for (size_t i = 0; i < buffer.size(); ++i)
     {
-        float sample = std::max(-1.0f, std::min(1.0f, buffer[i]));
-        pcm_data[i] = static_cast<int16_t>(sample * 32767.0f);
+        TRACE_SCOPE("network", "encode");
+        float_to_int16(buffer.data(), pcm_data.data(), buffer.size());
     }
 
     // Send as PCM data (libshout handles encoding to MP3/OGG)
+    TRACE_SCOPE("network", "send");
     int ret = shout_send(shout_conn, reinterpret_cast<unsigned char *>(pcm_data.data()), pcm_data.size() * sizeof(int16_t));
     if (ret != SHOUTERR_SUCCESS)
     {
-        std::cerr << "Shout send error: " << shout_get_error(shout_conn) << std::endl;
+        LOG_ERROR("shout", "Shout send error: %s", shout_get_error(shout_conn));
         return;
     }
 
@@ -164,13 +171,13 @@ void NetworkServer::init_websocket_server()
 
             std::lock_guard<std::mutex> lock(ws_connections_mutex);
             ws_connections.push_back(hdl);
-            std::cout << "WebSocket client connected to " << uri->get_resource() << std::endl; });
+            LOG_INFO("websocket", "WebSocket client connected to %s", uri->get_resource().c_str()); });
 
         ws_srv.set_close_handler([this](websocketpp::connection_hdl hdl)
                                  {
             std::lock_guard<std::mutex> lock(ws_connections_mutex);
             ws_connections.erase(std::remove(ws_connections.begin(), ws_connections.end(), hdl), ws_connections.end());
-            std::cout << "WebSocket client disconnected" << std::endl; });
+            LOG_INFO("websocket", "WebSocket client disconnected"); });
 
         ws_srv.set_message_handler([this](websocketpp::connection_hdl hdl, ws_server::message_ptr msg)
                                    {
@@ -179,7 +186,7 @@ void NetworkServer::init_websocket_server()
     }
     catch (const std::exception &e)
     {
-        std::cerr << "WebSocket server init error: " << e.what() << std::endl;
+        LOG_ERROR("websocket", "WebSocket server init error: %s", e.what());
     }
 }
 #endif
@@ -196,7 +203,7 @@ void NetworkServer::start_websocket_server()
             ws_srv.start_accept();
             ws_srv.run();
         } catch (const std::exception& e) {
-            std::cerr << "WebSocket server error: " << e.what() << std::endl;
+            LOG_ERROR("websocket", "WebSocket server error: %s", e.what());
         } });
 
     // Start FFT broadcasting thread
@@ -207,7 +214,7 @@ void NetworkServer::start_websocket_server()
             std::this_thread::sleep_for(std::chrono::milliseconds(50)); // ~20 FPS
         } });
 
-    std::cout << "✓ WebSocket server started on port " << (config.web_port + 1) << std::endl;
+    LOG_INFO("websocket", "WebSocket server started on port %d", config.web_port + 1);
 }
 #endif
 
@@ -267,7 +274,7 @@ void NetworkServer::broadcast_fft_data()
         }
         catch (const std::exception &e)
         {
-            std::cerr << "WebSocket send error: " << e.what() << std::endl;
+            LOG_WARN("websocket", "WebSocket send error: %s", e.what());
         }
     }
 }
@@ -304,6 +311,8 @@ void NetworkServer::broadcast_fft_data()
 void NetworkServer::start()
 {
     running = true;
+    Tracer::set_thread_name("http-accept");
+    Realtime::apply_to_current_thread(ThreadRole::NETWORK);
 
     // Initialize libshout for all modes - CODER mode streams live generated music
     init_libshout();
@@ -346,7 +355,7 @@ void NetworkServer::start()
         throw std::runtime_error("Failed to listen");
     }
 
-    std::cout << "✓ Network server listening on port " << config.web_port << std::endl;
+    LOG_INFO("http", "Network server listening on port %d", config.web_port);
 
     // Accept connections in loop
     while (running)
@@ -396,6 +405,9 @@ void NetworkServer::stop()
 
 void NetworkServer::handle_client(int client_fd)
 {
+    Tracer::set_thread_name("http-client");
+    Realtime::apply_to_current_thread(ThreadRole::NETWORK);
+
     char buffer[8192];
     ssize_t bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
 
@@ -413,6 +425,18 @@ void NetworkServer::handle_client(int client_fd)
     {
         send_html_response(client_fd);
     }
+    else if (request.find("GET /api/search") == 0)
+    {
+        send_search_response(client_fd, request);
+    }
+    else if (request.find("GET /api/tracks/") == 0)
+    {
+        send_art_response(client_fd, request);
+    }
+    else if (request.find("GET /api/tracks") == 0)
+    {
+        send_tracks_page(client_fd, request);
+    }
     else if (request.find("GET /api/track") == 0)
     {
         send_track_response(client_fd);
@@ -437,6 +461,14 @@ void NetworkServer::handle_client(int client_fd)
     {
         handle_mute_toggle(client_fd);
     }
+    else if (request.find("GET /api/trace") == 0)
+    {
+        send_trace_response(client_fd);
+    }
+    else if (request.find("POST /api/trace") == 0)
+    {
+        handle_trace_toggle(client_fd);
+    }
     else if (request.find("GET /stream") == 0)
     {
         send_audio_stream(client_fd);
@@ -510,7 +542,7 @@ void NetworkServer::send_fft_response(int client_fd)
 
 void NetworkServer::send_track_response(int client_fd)
 {
-    Track *current_track = playlist_mgr->get_current_track();
+    std::optional<Track> current_track = playlist_mgr->get_current_track();
 
     std::stringstream json;
     json << "{";
@@ -545,6 +577,219 @@ void NetworkServer::send_track_response(int client_fd)
     send(client_fd, resp_str.c_str(), resp_str.length(), 0);
 }
 
+void NetworkServer::send_tracks_page(int client_fd, const std::string& request)
+{
+    TRACE_SCOPE("network", "tracks_page");
+
+    // Request line: GET /api/tracks?cursor=...&limit=... HTTP/1.1
+    size_t target_end = request.find(' ', 4);
+    std::string target = request.substr(4, target_end == std::string::npos ? std::string::npos : target_end - 4);
+    size_t question = target.find('?');
+    std::string query_string = question == std::string::npos ? "" : target.substr(question + 1);
+
+    BrowseQuery query;
+    std::string error;
+    if (!LibraryBrowser::parse_query(query_string, query, error))
+    {
+        std::string json_str = "{\"error\":\"" + escape_json(error) + "\"}";
+        std::stringstream response;
+        response << "HTTP/1.1 400 Bad Request\r\n";
+        response << "Content-Type: application/json\r\n";
+        response << "Content-Length: " << json_str.length() << "\r\n";
+        response << "Access-Control-Allow-Origin: *\r\n";
+        response << "Connection: close\r\n";
+        response << "\r\n";
+        response << json_str;
+
+        std::string resp_str = response.str();
+        send(client_fd, resp_str.c_str(), resp_str.length(), MSG_NOSIGNAL);
+        return;
+    }
+
+    // The page is streamed with chunked encoding as it is generated, from
+    // one snapshot so it is consistent even if the library changes meanwhile
+    std::stringstream response;
+    response << "HTTP/1.1 200 OK\r\n";
+    response << "Content-Type: application/json\r\n";
+    response << "Transfer-Encoding: chunked\r\n";
+    response << "Access-Control-Allow-Origin: *\r\n";
+    response << "Connection: close\r\n";
+    response << "\r\n";
+
+    std::string resp_str = response.str();
+    if (send(client_fd, resp_str.c_str(), resp_str.length(), MSG_NOSIGNAL) < 0)
+        return;
+
+    auto send_chunk = [client_fd](std::string_view chunk)
+    {
+        char header[16];
+        int header_len = snprintf(header, sizeof(header), "%zx\r\n", chunk.size());
+        return send(client_fd, header, header_len, MSG_NOSIGNAL) == header_len &&
+               send(client_fd, chunk.data(), chunk.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(chunk.size()) &&
+               send(client_fd, "\r\n", 2, MSG_NOSIGNAL) == 2;
+    };
+
+    if (library_browser.write_page(*playlist_mgr->snapshot(), query, send_chunk))
+    {
+        send(client_fd, "0\r\n\r\n", 5, MSG_NOSIGNAL);
+    }
+}
+
+void NetworkServer::send_art_response(int client_fd, const std::string& request)
+{
+    TRACE_SCOPE("network", "track_art");
+
+    // Request line: GET /api/tracks/{id}/art HTTP/1.1
+    const size_t id_start = strlen("GET /api/tracks/");
+    size_t id_end = request.find_first_not_of("0123456789", id_start);
+    if (id_end == std::string::npos || id_end == id_start || id_end - id_start > 9 ||
+        request.compare(id_end, 4, "/art") != 0 || (request[id_end + 4] != ' ' && request[id_end + 4] != '?'))
+    {
+        send_404(client_fd);
+        return;
+    }
+    TrackId id = static_cast<TrackId>(std::stoul(request.substr(id_start, id_end - id_start)));
+
+    ArtSource source;
+    {
+        auto snapshot = playlist_mgr->snapshot();
+        const TrackTable& tracks = *snapshot->tracks;
+        if (!tracks.alive(id) || tracks.art_length(id) == 0)
+        {
+            send_404(client_fd);
+            return;
+        }
+        source.path = std::string(tracks.path(id));
+        source.file_size = tracks.file_size(id);
+        source.mtime_ns = tracks.mtime_ns(id);
+        source.offset = tracks.art_offset(id);
+        source.length = tracks.art_length(id);
+    }
+
+    CachedArt art;
+    if (!art_cache.open(source, art))
+    {
+        send_404(client_fd);
+        return;
+    }
+
+    // The ETag is the hash of the image bytes, so a client's copy is current
+    // exactly when the tag matches, whichever track it was fetched for
+    std::string etag = "\"" + art.hash + "\"";
+    std::string headers = request.substr(0, request.find("\r\n\r\n"));
+    std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+    size_t if_none_match = headers.find("\r\nif-none-match:");
+    bool not_modified = if_none_match != std::string::npos &&
+                        headers.substr(if_none_match, headers.find("\r\n", if_none_match + 2) - if_none_match).find(etag) != std::string::npos;
+
+    std::stringstream response;
+    if (not_modified)
+    {
+        response << "HTTP/1.1 304 Not Modified\r\n";
+    }
+    else
+    {
+        response << "HTTP/1.1 200 OK\r\n";
+        response << "Content-Type: " << art.mime_type << "\r\n";
+        response << "Content-Length: " << art.size << "\r\n";
+    }
+    response << "ETag: " << etag << "\r\n";
+    response << "Cache-Control: no-cache\r\n";
+    response << "Access-Control-Allow-Origin: *\r\n";
+    response << "Connection: close\r\n";
+    response << "\r\n";
+
+    std::string resp_str = response.str();
+    if (send(client_fd, resp_str.c_str(), resp_str.length(), MSG_NOSIGNAL) == static_cast<ssize_t>(resp_str.length()) &&
+        !not_modified)
+    {
+        // Straight from the page cache to the socket
+        off_t offset = 0;
+        while (static_cast<uint64_t>(offset) < art.size)
+        {
+            if (sendfile(client_fd, art.fd, &offset, art.size - offset) <= 0)
+                break;
+        }
+    }
+    close(art.fd);
+}
+
+void NetworkServer::send_search_response(int client_fd, const std::string& request)
+{
+    TRACE_SCOPE("network", "search");
+
+    // Request line: GET /api/search?q=...&limit=... HTTP/1.1
+    size_t target_end = request.find(' ', 4);
+    std::string target = request.substr(4, target_end == std::string::npos ? std::string::npos : target_end - 4);
+    size_t question = target.find('?');
+    std::string_view query_string = question == std::string::npos ? std::string_view() : std::string_view(target).substr(question + 1);
+
+    std::string text;
+    size_t limit = 20;
+    while (!query_string.empty())
+    {
+        size_t amp = query_string.find('&');
+        std::string_view param = query_string.substr(0, amp);
+        query_string = amp == std::string_view::npos ? std::string_view() : query_string.substr(amp + 1);
+
+        size_t eq = param.find('=');
+        std::string_view name = param.substr(0, eq);
+        std::string value = eq == std::string_view::npos ? std::string() : LibraryBrowser::url_decode(param.substr(eq + 1));
+        if (name == "q")
+        {
+            text = value;
+        }
+        else if (name == "limit" && !value.empty() && value.size() <= 9 &&
+                 value.find_first_not_of("0123456789") == std::string::npos)
+        {
+            limit = std::min<size_t>(std::max<size_t>(std::stoul(value), 1), 100);
+        }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<SearchHit> hits = playlist_mgr->search(text, limit);
+    auto took_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+
+    // Materialize from one snapshot; a hit may have been removed since
+    std::shared_ptr<const PlaylistSnapshot> view = playlist_mgr->snapshot();
+    const TrackTable &tracks = *view->tracks;
+
+    std::stringstream json;
+    json << "{\"query\":\"" << escape_json(text) << "\",";
+    json << "\"took_us\":" << took_us << ",";
+    json << "\"results\":[";
+    bool first = true;
+    for (const SearchHit &hit : hits)
+    {
+        if (!tracks.alive(hit.id))
+            continue;
+        if (!first)
+            json << ",";
+        first = false;
+        json << "{\"id\":" << hit.id << ",";
+        json << "\"title\":\"" << escape_json(std::string(tracks.title(hit.id))) << "\",";
+        json << "\"artist\":\"" << escape_json(std::string(tracks.artist(hit.id))) << "\",";
+        json << "\"album\":\"" << escape_json(std::string(tracks.album(hit.id))) << "\",";
+        json << "\"duration\":" << tracks.duration_ms(hit.id) << ",";
+        json << "\"score\":" << hit.score << "}";
+    }
+    json << "]}";
+
+    std::string json_str = json.str();
+    std::stringstream response;
+
+    response << "HTTP/1.1 200 OK\r\n";
+    response << "Content-Type: application/json\r\n";
+    response << "Content-Length: " << json_str.length() << "\r\n";
+    response << "Access-Control-Allow-Origin: *\r\n";
+    response << "Connection: close\r\n";
+    response << "\r\n";
+    response << json_str;
+
+    std::string resp_str = response.str();
+    send(client_fd, resp_str.c_str(), resp_str.length(), MSG_NOSIGNAL);
+}
+
 void NetworkServer::send_theme_response(int client_fd)
 {
     std::string theme_str = get_theme_param();
@@ -632,6 +877,47 @@ void NetworkServer::send_mode_response(int client_fd)
     send(client_fd, resp_str.c_str(), resp_str.length(), 0);
 }
 
+void NetworkServer::send_trace_response(int client_fd)
+{
+    std::string json_str = Tracer::dump_chrome_json();
+    std::stringstream response;
+
+    response << "HTTP/1.1 200 OK\r\n";
+    response << "Content-Type: application/json\r\n";
+    response << "Content-Length: " << json_str.length() << "\r\n";
+    response << "Content-Disposition: attachment; filename=\"harmonic_trace.json\"\r\n";
+    response << "Access-Control-Allow-Origin: *\r\n";
+    response << "Connection: close\r\n";
+    response << "\r\n";
+    response << json_str;
+
+    std::string resp_str = response.str();
+    send(client_fd, resp_str.c_str(), resp_str.length(), MSG_NOSIGNAL);
+}
+
+void NetworkServer::handle_trace_toggle(int client_fd)
+{
+    bool enable = !Tracer::is_enabled();
+    Tracer::set_enabled(enable);
+
+    std::stringstream json;
+    json << "{\"tracing\":" << (enable ? "true" : "false") << "}";
+
+    std::string json_str = json.str();
+    std::stringstream response;
+
+    response << "HTTP/1.1 200 OK\r\n";
+    response << "Content-Type: application/json\r\n";
+    response << "Content-Length: " << json_str.length() << "\r\n";
+    response << "Access-Control-Allow-Origin: *\r\n";
+    response << "Connection: close\r\n";
+    response << "\r\n";
+    response << json_str;
+
+    std::string resp_str = response.str();
+    send(client_fd, resp_str.c_str(), resp_str.length(), 0);
+}
+
 std::vector<char> generate_wav_header(int sample_rate, int channels, int bits_per_sample, size_t data_size)
 {
     std::vector<char> header(44);
@@ -681,10 +967,14 @@ std::vector<char> generate_wav_header(int sample_rate, int channels, int bits_pe
 
 void NetworkServer::send_audio_stream(int client_fd)
 {
+    // Listener threads spend their life encoding and sending audio
+    Tracer::set_thread_name("stream-listener");
+    Realtime::apply_to_current_thread(ThreadRole::ENCODER);
+
     // In CODER mode, stream the generated coder audio
     if (config.mode == PlaybackMode::CODER)
     {
-        std::cout << "[STREAM] CODER mode - streaming live-generated coder audio as WAV format" << std::endl;
+        LOG_INFO("stream", "CODER mode - streaming live-generated coder audio as WAV format");
 
         // Send WAV header for streaming (we'll use a large data size since we're streaming)
         std::vector<char> wav_header = generate_wav_header(config.sample_rate, 2, 16, 0x7FFFFFFF); // Large size for streaming
@@ -720,15 +1010,18 @@ void NetworkServer::send_audio_stream(int client_fd)
 
             // Convert float to PCM (16-bit stereo, little-endian)
             std::vector<int16_t> pcm_data(buffer.size());
-            for (size_t i = 0; i < buffer.size(); ++i)
             {
-                float sample = std::max(-1.0f, std::min(1.0f, buffer[i]));
-                pcm_data[i] = static_cast<int16_t>(sample * 32767.0f);
+                TRACE_SCOPE("network", "encode");
+                float_to_int16(buffer.data(), pcm_data.data(), buffer.size());
             }
 
             // Send raw PCM data
             size_t pcm_size = pcm_data.size() * sizeof(int16_t);
-            ssize_t sent = send(client_fd, reinterpret_cast<char *>(pcm_data.data()), pcm_size, MSG_NOSIGNAL);
+            ssize_t sent;
+            {
+                TRACE_SCOPE("network", "send");
+                sent = send(client_fd, reinterpret_cast<char *>(pcm_data.data()), pcm_size, MSG_NOSIGNAL);
+            }
             if (sent < 0)
             {
                 break; // Client disconnected
@@ -742,7 +1035,7 @@ void NetworkServer::send_audio_stream(int client_fd)
     }
 
     // In RADIO/DJ mode, stream the currently playing decoded audio as MP3 with chunked encoding
-    Track *current_track = playlist_mgr->get_current_track();
+    std::optional<Track> current_track = playlist_mgr->get_current_track();
 
     if (!current_track || current_track->filepath.empty())
     {
@@ -758,7 +1051,7 @@ void NetworkServer::send_audio_stream(int client_fd)
         return;
     }
 
-    std::cout << "[STREAM] RADIO/DJ mode - streaming decoded audio as MP3 format with chunked encoding" << std::endl;
+    LOG_INFO("stream", "RADIO/DJ mode - streaming decoded audio as MP3 format with chunked encoding");
 
     // Send headers for chunked MP3 streaming
     std::stringstream response;
@@ -778,7 +1071,7 @@ void NetworkServer::send_audio_stream(int client_fd)
     lame_t lame = lame_init();
     if (!lame)
     {
-        std::cerr << "Failed to initialize LAME encoder" << std::endl;
+        LOG_ERROR("stream", "Failed to initialize LAME encoder");
         return;
     }
 
@@ -791,7 +1084,7 @@ void NetworkServer::send_audio_stream(int client_fd)
 
     if (lame_init_params(lame) < 0)
     {
-        std::cerr << "Failed to initialize LAME parameters" << std::endl;
+        LOG_ERROR("stream", "Failed to initialize LAME parameters");
         lame_close(lame);
         return;
     }
@@ -811,21 +1104,24 @@ void NetworkServer::send_audio_stream(int client_fd)
             continue;
         }
 
-        // Convert float to PCM (16-bit stereo)
-        std::vector<int16_t> pcm_data(buffer.size());
-        for (size_t i = 0; i < buffer.size(); ++i)
+        int bytes_encoded;
         {
-            float sample = std::max(-1.0f, std::min(1.0f, buffer[i]));
-            pcm_data[i] = static_cast<int16_t>(sample * 32767.0f);
-        }
+            TRACE_SCOPE("network", "encode");
 
-        // Encode to MP3
-        int num_samples = pcm_data.size() / 2; // Stereo samples
-        int bytes_encoded = lame_encode_buffer_interleaved(lame,
+            // Convert float to PCM (16-bit stereo)
+            std::vector<int16_t> pcm_data(buffer.size());
+            float_to_int16(buffer.data(), pcm_data.data(), buffer.size());
+
+            // Encode to MP3
+            int num_samples = pcm_data.size() / 2; // Stereo samples
+            bytes_encoded = lame_encode_buffer_interleaved(lame,
                                                            pcm_data.data(), num_samples, mp3_buffer, MP3_BUFFER_SIZE);
+        }
 
         if (bytes_encoded > 0)
         {
+            TRACE_SCOPE("network", "send");
+
             // Send MP3 data as HTTP chunk
             std::stringstream chunk_header;
             chunk_header << std::hex << bytes_encoded << "\r\n";
@@ -845,7 +1141,7 @@ void NetworkServer::send_audio_stream(int client_fd)
         }
         else if (bytes_encoded < 0)
         {
-            std::cerr << "LAME encoding error: " << bytes_encoded << std::endl;
+            LOG_ERROR("stream", "LAME encoding error: %d", bytes_encoded);
             break;
         }
 
@@ -871,7 +1167,7 @@ void NetworkServer::send_audio_stream(int client_fd)
     send(client_fd, "0\r\n\r\n", 5, MSG_NOSIGNAL);
 
     lame_close(lame);
-    std::cout << "✓ Real-time MP3 stream ended for: " << current_track->title << std::endl;
+    LOG_INFO("stream", "Real-time MP3 stream ended for: %s", current_track->title.c_str());
 }
 
 void NetworkServer::send_404(int client_fd)
@@ -935,7 +1231,7 @@ std::string NetworkServer::generate_html()
     std::ifstream file("templates/index.html");
     if (!file.is_open())
     {
-        std::cerr << "Error: Could not open templates/index.html" << std::endl;
+        LOG_ERROR("http", "Could not open templates/index.html");
         return "<html><body><h1>Error: Template not found</h1></body></html>";
     }
 
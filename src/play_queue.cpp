@@ -0,0 +1,179 @@
+#include "play_queue.h"
+
+void TrackRing::grow()
+{
+    // Unwrap into a ring twice the size, the front at slot 0
+    std::vector<TrackId> larger(slots.empty() ? 16 : slots.size() * 2);
+    for (size_t i = 0; i < count; ++i)
+        larger[i] = (*this)[i];
+    slots.swap(larger);
+    head = 0;
+}
+
+void TrackRing::push_back(TrackId id)
+{
+    if (count == slots.size())
+        grow();
+    at(count++) = id;
+}
+
+void TrackRing::push_front(TrackId id)
+{
+    if (count == slots.size())
+        grow();
+    head = (head + slots.size() - 1) & (slots.size() - 1);
+    count++;
+    at(0) = id;
+}
+
+TrackId TrackRing::pop_front()
+{
+    TrackId id = (*this)[0];
+    head = (head + 1) & (slots.size() - 1);
+    count--;
+    return id;
+}
+
+void TrackRing::insert(size_t position, TrackId id)
+{
+    push_back(id);
+    for (size_t i = count - 1; i > position; --i)
+        at(i) = (*this)[i - 1];
+    at(position) = id;
+}
+
+void TrackRing::erase(size_t position)
+{
+    for (size_t i = position; i + 1 < count; ++i)
+        at(i) = (*this)[i + 1];
+    count--;
+}
+
+void TrackRing::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+void PlayQueue::push(TrackId id, QueuePriority priority)
+{
+    lanes[static_cast<size_t>(priority)].push_back(id);
+}
+
+void PlayQueue::push_front(TrackId id, QueuePriority priority)
+{
+    lanes[static_cast<size_t>(priority)].push_front(id);
+}
+
+bool PlayQueue::pop(TrackId &id)
+{
+    for (TrackRing &lane : lanes)
+    {
+        if (!lane.empty())
+        {
+            id = lane.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<TrackId> PlayQueue::front() const
+{
+    for (const TrackRing &lane : lanes)
+    {
+        if (!lane.empty())
+            return lane[0];
+    }
+    return std::nullopt;
+}
+
+bool PlayQueue::locate(size_t position, size_t &lane, size_t &offset) const
+{
+    for (lane = 0; lane < LANES; ++lane)
+    {
+        if (position < lanes[lane].size())
+        {
+            offset = position;
+            return true;
+        }
+        position -= lanes[lane].size();
+    }
+    return false;
+}
+
+QueueEntry PlayQueue::at(size_t position) const
+{
+    size_t lane = 0, offset = 0;
+    locate(position, lane, offset);
+    return {lanes[lane][offset], static_cast<QueuePriority>(lane)};
+}
+
+bool PlayQueue::move(size_t from, size_t to)
+{
+    size_t lane = 0, offset = 0;
+    if (!locate(from, lane, offset) || to >= size())
+        return false;
+    TrackId id = lanes[lane][offset];
+    lanes[lane].erase(offset);
+
+    size_t own_lane = lane;
+    if (locate(to, lane, offset))
+    {
+        lanes[lane].insert(offset, id);
+        return true;
+    }
+    // Past the last entry: join that entry's lane, or go back to its own
+    // lane if it was the only entry
+    lane = LANES;
+    while (lane > 0 && lanes[lane - 1].empty())
+        lane--;
+    lanes[lane > 0 ? lane - 1 : own_lane].push_back(id);
+    return true;
+}
+
+bool PlayQueue::set_priority(size_t position, QueuePriority priority)
+{
+    size_t lane = 0, offset = 0;
+    if (!locate(position, lane, offset))
+        return false;
+    TrackId id = lanes[lane][offset];
+    lanes[lane].erase(offset);
+    push(id, priority);
+    return true;
+}
+
+bool PlayQueue::erase(size_t position)
+{
+    size_t lane = 0, offset = 0;
+    if (!locate(position, lane, offset))
+        return false;
+    lanes[lane].erase(offset);
+    return true;
+}
+
+void PlayQueue::clear()
+{
+    for (TrackRing &lane : lanes)
+        lane.clear();
+}
+
+size_t PlayQueue::size() const
+{
+    size_t total = 0;
+    for (const TrackRing &lane : lanes)
+        total += lane.size();
+    return total;
+}
+
+std::vector<QueueEntry> PlayQueue::entries() const
+{
+    std::vector<QueueEntry> result;
+    result.reserve(size());
+    for (size_t lane = 0; lane < LANES; ++lane)
+    {
+        for (size_t i = 0; i < lanes[lane].size(); ++i)
+            result.push_back({lanes[lane][i], static_cast<QueuePriority>(lane)});
+    }
+    return result;
+}
@@ -1,6 +1,14 @@
 // playlist_manager.cpp - Complete playlist management with M3U/PLS support
 #include "playlist_manager.h"
 #include "metadata_parser.h"
+#include "binary_playlist.h"
+#include "library_index.h"
+#include "library_scanner.h"
+#include "library_watcher.h"
+#include "playlist_parser.h"
+#include "realtime.h"
+#include "trace.h"
+#include "logger.h"
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -11,52 +19,610 @@
 
 namespace fs = std::filesystem;
 
+namespace {
+    constexpr size_t RESOLVE_BATCH = 32;        // Tracks claimed per resolver pass
+    constexpr size_t RESOLVE_PRIORITY_AHEAD = 8; // Current track and the next few go first
+    constexpr size_t VALIDATE_BATCH = 1024;      // Playlist entries checked per lock
+    constexpr auto PUBLISH_INTERVAL = std::chrono::milliseconds(100); // Bulk updates coalesce
+}
+
+std::optional<Track> PlaylistSnapshot::track_at(size_t position) const {
+    if (position >= order->size()) return std::nullopt;
+    return tracks->get((*order)[position]);
+}
+
+std::optional<Track> PlaylistSnapshot::current_track() const {
+    if (playing_queued) return tracks->get(*playing_queued);
+    return track_at(current_index);
+}
+
+std::optional<Track> PlaylistSnapshot::next_track() const {
+    if (!queue->empty()) return tracks->get(queue->front().id);
+    if (order->empty()) return std::nullopt;
+    // After a queued track the playlist resumes at current_index itself
+    return track_at(playing_queued ? current_index : (current_index + 1) % order->size());
+}
+
 PlaylistManager::PlaylistManager(const Config& cfg) 
-    : config(cfg), current_index(0), auto_advance_enabled(false), cue_system_enabled(false) {
+    : config(cfg), library_subset(false), shuffled(false), shuffle_mode(ShuffleMode::SMART),
+      shuffle_rng(std::random_device{}()), version(0), unpublished_changes(0), current_index(0),
+      auto_advance_enabled(false), cue_system_enabled(false),
+      cancel_scans(false), library_load_cancel(false), library_loaded(false), resolver_running(false),
+      scanning(false), index_dirty(false), library_backed(true), pending_metadata(0), playlist_generation(0) {
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        publish(PUBLISH_TRACKS | PUBLISH_ORDER);
+    }
+    
+    bool filter_library = SmartPlaylist::is_smart_playlist(config.playlist_file);
+    if (!config.playlist_file.empty() && !filter_library) {
+        load_playlist_file(config.playlist_file);
+        library_loaded = true;
+        return;
+    }
     
-    if (!config.playlist_file.empty()) {
+    // A smart playlist is a view of the library: install the rules, then
+    // scan as usual and only matching tracks enter the playlist
+    if (filter_library) {
         load_playlist_file(config.playlist_file);
+    }
+    if (config.lazy_metadata) {
+        start_background_load();
     } else {
         scan_music_directory();
+        library_loaded = true;
+        start_watcher();
     }
 }
 
+PlaylistManager::~PlaylistManager() {
+    // Stop everything that calls back into this object before members are
+    // destroyed. A library scan in progress is abandoned rather than awaited.
+    cancel_scans = true;
+    library_load_cancel = true;
+    std::unique_lock<std::mutex> owner(thread_owner_mutex);
+    if (library_thread.joinable()) {
+        library_thread.join();
+    }
+    watcher.reset();
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        resolver_running = false;
+        playlist_generation++; // Stops the validator
+    }
+    if (validator_thread.joinable()) {
+        validator_thread.join();
+    }
+    owner.unlock();
+    resolver_cv.notify_all();
+    for (auto& t : resolver_threads) {
+        t.join();
+    }
+    
+    // Play counts recorded since the last library change
+    TrackTable snapshot;
+    bool save_index;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        save_index = take_index_snapshot(snapshot);
+    }
+    if (save_index) {
+        save_library_index(snapshot);
+    }
+}
+
+void PlaylistManager::start_watcher() {
+    if (!config.watch_library) return;
+    
+    watcher = std::make_unique<LibraryWatcher>(config,
+        [this](const std::set<std::string>& changed, const std::set<std::string>& removed) {
+            apply_library_changes(changed, removed);
+        },
+        [this]() {
+            rescan_library();
+        });
+    watcher->start();
+}
+
+void PlaylistManager::start_resolvers() {
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        if (resolver_running) return;
+        resolver_running = true;
+    }
+    size_t threads = LibraryScanner::thread_count(config);
+    for (size_t i = 0; i < threads; ++i) {
+        resolver_threads.emplace_back(&PlaylistManager::resolve_metadata_loop, this);
+    }
+}
+
+void PlaylistManager::start_background_load() {
+    start_resolvers();
+    
+    library_thread = std::thread([this]() {
+        Tracer::set_thread_name("library-load");
+        scan_library(false, library_load_cancel);
+        if (!library_load_cancel) {
+            start_watcher();
+            search_index.sync(snapshot()->tracks);
+        }
+        {
+            std::lock_guard<std::mutex> lock(playlist_mutex);
+            library_loaded = true;
+        }
+        library_cv.notify_all();
+    });
+    
+    // Return as soon as there is something to play
+    std::unique_lock<std::mutex> lock(playlist_mutex);
+    library_cv.wait(lock, [this]() { return !order.empty() || library_loaded; });
+    LOG_INFO("playlist", "Library playable with %zu tracks; loading continues in the background", order.size());
+}
+
 void PlaylistManager::scan_music_directory() {
-    std::lock_guard<std::mutex> lock(playlist_mutex);
-    tracks.clear();
+    scan_library(false, cancel_scans);
+}
+
+void PlaylistManager::rescan_library() {
+    scan_library(true, cancel_scans);
+}
+
+void PlaylistManager::scan_library(bool rescan, const std::atomic<bool>& stop) {
+    bool first_load;
+    uint64_t generation; // A playlist file installed meanwhile ends the scan
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        // A playlist file loaded since replaced the library; a rescan would
+        // drop its rows and put the library back. Checked under the same lock
+        // that takes the generation, so a later install still ends the scan.
+        if (rescan && !library_backed) return;
+        generation = playlist_generation;
+        first_load = order.empty();
+        scanning = true;
+        if (!rescan) library_backed = true;
+    }
     
     if (!fs::exists(config.music_directory)) {
-        std::cerr << "Warning: Music directory does not exist: " << config.music_directory << std::endl;
+        LOG_WARN("playlist", "Music directory does not exist: %s", config.music_directory.c_str());
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        scanning = false;
         return;
     }
     
-    std::cout << "Scanning music directory: " << config.music_directory << std::endl;
+    LOG_INFO("playlist", "Scanning music directory: %s", config.music_directory.c_str());
     
-    for (const auto& entry : fs::recursive_directory_iterator(config.music_directory)) {
-        if (entry.is_regular_file()) {
-            std::string ext = entry.path().extension().string();
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-            
-            if (is_supported_format(ext)) {
-                fs::path full_path = fs::absolute(entry.path());
-                Track track(full_path.string());
-
-                // Parse metadata
-                TrackMetadata meta = MetadataParser::parse(full_path.string());
-                track.title = meta.title.empty() ? entry.path().filename().string() : meta.title;
-                track.artist = meta.artist.empty() ? "Unknown" : meta.artist;
-                track.album = meta.album;
-                track.year = meta.year;
-                track.genre = meta.genre;
-                track.duration_ms = meta.duration_seconds * 1000;
-                track.bitrate = meta.bitrate;
-                
-                tracks.push_back(track);
+    // Files whose size and mtime match the index reuse its metadata; only new
+    // or changed files are parsed
+    LibraryIndex index;
+    bool use_index = !config.library_index_file.empty();
+    if (use_index && index.open(config.library_index_file)) {
+        LOG_INFO("playlist", "Loaded library index with %zu entries", index.size());
+    }
+    
+    // Workers publish in batches; the playlist lock is only held per batch.
+    // With lazy_metadata, unindexed files are published as placeholders and
+    // the resolver threads read their tags afterwards. A rescan reconciles
+    // against the table by path, so known tracks keep their IDs and position.
+    std::vector<bool> seen;
+    LibraryScanner scanner(config, &index);
+    scanner.set_defer_metadata(config.lazy_metadata);
+    scanner.set_stop_flag(&stop);
+    ScanStats stats = scanner.scan(config.music_directory, [this, &seen, &stop, generation](std::vector<Track>& batch) {
+        if (stop) return;
+        size_t queued = 0;
+        {
+            std::lock_guard<std::mutex> lock(playlist_mutex);
+            if (generation != playlist_generation) return;
+            for (const auto& track : batch) {
+                std::optional<TrackId> id = table.find(track.filepath);
+                bool queue = track.metadata_pending;
+                if (!id) {
+                    id = table.add(track);
+                    admit(*id);
+                } else if (!(track.metadata_pending && table.file_size(*id) == track.file_size &&
+                             table.mtime_ns(*id) == track.mtime_ns)) {
+                    // A placeholder for an unchanged file keeps what is already known
+                    if (table.metadata_pending(*id)) pending_metadata--;
+                    table.update(*id, track);
+                    refresh_membership(*id);
+                } else {
+                    queue = false;
+                }
+                if (queue) {
+                    pending_metadata++;
+                    resolve_queue.push_back(*id);
+                    queued++;
+                }
+                if (seen.size() <= *id) seen.resize(*id + 1, false);
+                seen[*id] = true;
+            }
+            publish_batched(PUBLISH_TRACKS | PUBLISH_ORDER);
+        }
+        library_cv.notify_all();
+        wake_resolvers(queued);
+    });
+    
+    // Rewrite the index only if something was added, changed or removed, or
+    // it is from an older version
+    bool index_stale = stats.parsed > 0 || stats.deferred > 0 || stats.reused != index.size() ||
+        index.is_outdated();
+    index.close();
+    
+    // An abandoned walk has not seen every file; dropping the unseen ones
+    // would empty the library
+    if (stats.cancelled) {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        scanning = false;
+        return;
+    }
+    
+    TrackTable snapshot;
+    bool save_now = false;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        if (generation != playlist_generation) {
+            // The rows unseen by this scan are the new playlist's
+            scanning = false;
+            return;
+        }
+        std::optional<TrackId> current = current_track_id();
+        
+        // Drop tracks whose files are gone
+        size_t dropped = 0;
+        for (TrackId id = 0; id < table.row_count(); ++id) {
+            if (table.alive(id) && (id >= seen.size() || !seen[id])) {
+                table.remove(id);
+                dropped++;
+            }
+        }
+        if (dropped > 0) {
+            order.erase(std::remove_if(order.begin(), order.end(),
+                [this](TrackId id) { return !table.alive(id); }), order.end());
+            pending_metadata = table.count_metadata_pending();
+        }
+        
+        // Workers finish in any order; sort a fresh library by path so the
+        // order is stable across runs. A rescan leaves the user's order alone.
+        if (first_load) {
+            std::sort(order.begin(), order.end(),
+                [this](TrackId a, TrackId b) { return table.path(a) < table.path(b); });
+        }
+        restore_current(current);
+        
+        if (table.needs_compaction()) {
+            table.compact();
+        }
+        
+        scanning = false;
+        index_dirty = index_dirty || index_stale || dropped > 0;
+        publish(PUBLISH_TRACKS | PUBLISH_ORDER);
+        
+        // With placeholders still pending, the last resolver pass writes the index
+        save_now = take_index_snapshot(snapshot);
+        LOG_INFO("playlist", "Found %zu tracks (%zu removed); track table uses %.1f MB",
+                 order.size(), dropped, table.memory_bytes() / (1024.0 * 1024.0));
+    }
+    
+    if (save_now) {
+        save_library_index(snapshot);
+    }
+}
+
+bool PlaylistManager::claim_metadata_work(std::vector<std::pair<TrackId, Track>>& work) {
+    // Called with playlist_mutex held, as the resolvers' wait predicate, so
+    // it must stay cheap when there is nothing to claim
+    if (pending_metadata <= resolving.size()) return false;
+    
+    auto claim = [&](TrackId id) {
+        if (table.alive(id) && table.metadata_pending(id) && resolving.insert(id).second) {
+            work.emplace_back(id, table.get(id));
+        }
+    };
+    
+    // What is playing now and next matters most: the queue, then the playlist
+    if (playing_queued) claim(*playing_queued);
+    for (size_t position = 0; position < RESOLVE_PRIORITY_AHEAD && position < queue.size(); ++position) {
+        claim(queue.at(position).id);
+    }
+    for (size_t ahead = 0; ahead < RESOLVE_PRIORITY_AHEAD && ahead < order.size(); ++ahead) {
+        claim(order[(current_index + ahead) % order.size()]);
+    }
+    
+    // Then everything else in the order it was found, which with a smart
+    // playlist includes tracks that may only match once their tags are known.
+    // Rows claimed above, resolved, or removed since are dropped on the way.
+    while (work.size() < RESOLVE_BATCH && !resolve_queue.empty()) {
+        claim(resolve_queue.front());
+        resolve_queue.pop_front();
+    }
+    return !work.empty();
+}
+
+void PlaylistManager::wake_resolvers(size_t queued) {
+    // One resolver per batch of new work; waking them all for a few rows
+    // only has them contend for playlist_mutex
+    size_t wake = std::min((queued + RESOLVE_BATCH - 1) / RESOLVE_BATCH, LibraryScanner::thread_count(config));
+    for (size_t i = 0; i < wake; ++i) {
+        resolver_cv.notify_one();
+    }
+}
+
+void PlaylistManager::resolve_metadata_loop() {
+    Tracer::set_thread_name("metadata-resolver");
+    Realtime::apply_to_current_thread(ThreadRole::SCANNER);
+    
+    std::vector<std::pair<TrackId, Track>> work;
+    while (true) {
+        work.clear();
+        {
+            std::unique_lock<std::mutex> lock(playlist_mutex);
+            resolver_cv.wait(lock, [&]() { return !resolver_running || claim_metadata_work(work); });
+            if (!resolver_running) return;
+        }
+        
+        {
+            TRACE_SCOPE("playlist", "resolve_metadata");
+            for (auto& item : work) {
+                Track& placeholder = item.second;
+                item.second = LibraryScanner::read_track(placeholder.filepath, placeholder.file_size, placeholder.mtime_ns);
+            }
+        }
+        
+        bool finished = false;
+        bool save_index = false;
+        size_t total = 0;
+        TrackTable snapshot;
+        {
+            std::lock_guard<std::mutex> lock(playlist_mutex);
+            unsigned changes = PUBLISH_TRACKS;
+            for (auto& item : work) {
+                TrackId id = item.first;
+                // The playlist may have been replaced meanwhile, removing the row
+                if (table.alive(id) && table.metadata_pending(id) && table.path(id) == item.second.filepath) {
+                    table.update(id, item.second);
+                    pending_metadata--;
+                    index_dirty = true;
+                    if (refresh_membership(id)) changes |= PUBLISH_ORDER;
+                }
+                resolving.erase(id);
+            }
+            finished = pending_metadata == 0 && resolving.empty() && !scanning;
+            total = order.size();
+            if (pending_metadata == 0) {
+                publish(changes);
+            } else {
+                publish_batched(changes);
             }
+            save_index = take_index_snapshot(snapshot);
+        }
+        
+        if (finished) {
+            LOG_INFO("playlist", "Metadata resolved for all %zu tracks", total);
+        }
+        if (save_index) {
+            save_library_index(snapshot);
         }
     }
+}
+
+bool PlaylistManager::take_index_snapshot(TrackTable& snapshot) {
+    // Called with playlist_mutex held. The index is only written once every
+    // placeholder has been resolved, so it never caches a file-name title.
+    if (!index_dirty || scanning || pending_metadata > 0 || !resolving.empty() ||
+        !library_backed || config.library_index_file.empty()) {
+        return false;
+    }
+    index_dirty = false;
+    snapshot = table.snapshot();
+    return true;
+}
+
+size_t PlaylistManager::get_pending_metadata_count() const {
+    return snapshot()->pending_metadata;
+}
+
+void PlaylistManager::apply_library_changes(const std::set<std::string>& changed, const std::set<std::string>& removed) {
+    // Changes under music_directory mean nothing to a playlist file's rows
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        if (!library_backed) return;
+    }
+    
+    // Read tags without holding the playlist lock so playback and readers
+    // are only blocked for the final merge
+    std::map<std::string, Track> updated;
+    std::string scanned_dir;
+    for (const auto& path : changed) {
+        // Sorted order puts a new directory before its children; scan it once
+        if (!scanned_dir.empty() && path.compare(0, scanned_dir.size() + 1, scanned_dir + "/") == 0) {
+            continue;
+        }
+        std::error_code ec;
+        if (fs::is_directory(path, ec)) {
+            scanned_dir = path;
+            LibraryScanner scanner(config);
+            scanner.set_stop_flag(&cancel_scans);
+            if (scanner.scan(path, [&updated](std::vector<Track>& batch) {
+                for (auto& track : batch) updated.emplace(track.filepath, std::move(track));
+            }).cancelled) {
+                return;
+            }
+        } else {
+            uint64_t file_size = 0;
+            int64_t mtime_ns = 0;
+            if (LibraryIndex::stat_file(path, file_size, mtime_ns)) {
+                updated.emplace(path, LibraryScanner::read_track(path, file_size, mtime_ns));
+            }
+        }
+    }
+    
+    auto is_removed = [&removed](std::string_view path) {
+        for (const auto& r : removed) {
+            if (path.compare(0, r.size(), r) == 0 && (path.size() == r.size() || path[r.size()] == '/')) {
+                return true;
+            }
+        }
+        return false;
+    };
     
-    std::cout << "Found " << tracks.size() << " tracks" << std::endl;
+    size_t added = 0, modified = 0, dropped = 0;
+    bool save_index = false;
+    TrackTable snapshot;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        if (!library_backed) return; // A playlist file was loaded meanwhile
+        std::optional<TrackId> current = current_track_id();
+        
+        // New files go to the end so a sorted or shuffled order is undisturbed
+        for (const auto& entry : updated) {
+            if (std::optional<TrackId> id = table.find(entry.first)) {
+                table.update(*id, entry.second);
+                refresh_membership(*id);
+                modified++;
+            } else {
+                admit(table.add(entry.second));
+                added++;
+            }
+        }
+        if (!removed.empty()) {
+            for (TrackId id = 0; id < table.row_count(); ++id) {
+                if (table.alive(id) && !updated.count(std::string(table.path(id))) && is_removed(table.path(id))) {
+                    table.remove(id);
+                    dropped++;
+                }
+            }
+        }
+        if (dropped > 0) {
+            order.erase(std::remove_if(order.begin(), order.end(),
+                [this](TrackId id) { return !table.alive(id); }), order.end());
+            if (table.needs_compaction()) {
+                table.compact();
+            }
+        }
+        pending_metadata = table.count_metadata_pending();
+        restore_current(current);
+        publish(PUBLISH_TRACKS | PUBLISH_ORDER);
+        
+        index_dirty = index_dirty || added || modified || dropped;
+        save_index = take_index_snapshot(snapshot);
+    }
+    
+    LOG_INFO("playlist", "Library updated: %zu added, %zu changed, %zu removed", added, modified, dropped);
+    
+    if (save_index) {
+        save_library_index(snapshot);
+    }
+}
+
+void PlaylistManager::save_library_index(const TrackTable& snapshot) {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    LibraryIndex::save(config.library_index_file, snapshot);
+}
+
+void PlaylistManager::publish(unsigned changes) {
+    // Writers are serialized by playlist_mutex; readers swap to the new
+    // version on their next snapshot() and keep the old one alive until then
+    changes |= unpublished_changes;
+    unpublished_changes = 0;
+    
+    // Removed rows leave the queue with their last version
+    if (changes & PUBLISH_TRACKS) {
+        if (queue.remove_if([this](TrackId id) { return !table.alive(id); }) > 0) {
+            changes |= PUBLISH_QUEUE;
+        }
+        if (playing_queued && !table.alive(*playing_queued)) playing_queued.reset();
+    }
+    
+    std::shared_ptr<const PlaylistSnapshot> previous = std::atomic_load(&published);
+    auto next = std::make_shared<PlaylistSnapshot>();
+    next->version = ++version;
+    next->tracks = (changes & PUBLISH_TRACKS) || !previous
+        ? std::make_shared<const TrackTable>(table.snapshot()) : previous->tracks;
+    next->order = (changes & PUBLISH_ORDER) || !previous
+        ? std::make_shared<const std::vector<TrackId>>(order) : previous->order;
+    next->queue = (changes & PUBLISH_QUEUE) || !previous
+        ? std::make_shared<const std::vector<QueueEntry>>(queue.entries()) : previous->queue;
+    next->current_index = current_index;
+    next->playing_queued = playing_queued;
+    next->pending_metadata = pending_metadata;
+    next->shuffled = shuffled;
+    
+    std::atomic_store(&published, std::shared_ptr<const PlaylistSnapshot>(std::move(next)));
+    last_publish = std::chrono::steady_clock::now();
+}
+
+void PlaylistManager::publish_batched(unsigned changes) {
+    // Copying the order is O(tracks); while a large library streams in, only
+    // the first batch (to become playable) and one per interval are published
+    unpublished_changes |= changes;
+    if (std::atomic_load(&published)->order->empty() ||
+        std::chrono::steady_clock::now() - last_publish >= PUBLISH_INTERVAL) {
+        publish(PUBLISH_POSITION);
+    }
+}
+
+void PlaylistManager::append_track(const Track& track) {
+    // A playlist may list the same file twice; both entries share one row
+    std::optional<TrackId> id = table.find(track.filepath);
+    if (!id) id = table.add(track);
+    order.push_back(*id);
+}
+
+std::optional<TrackId> PlaylistManager::current_track_id() const {
+    if (order.empty()) return std::nullopt;
+    return order[current_index];
+}
+
+void PlaylistManager::restore_current(std::optional<TrackId> id) {
+    // Keep playing the same track after the order changed, if it still exists
+    if (id) {
+        auto it = std::find(order.begin(), order.end(), *id);
+        if (it != order.end()) {
+            current_index = it - order.begin();
+            return;
+        }
+    }
+    if (current_index >= order.size()) current_index = 0;
+}
+
+void PlaylistManager::admit(TrackId id) {
+    if (smart) {
+        refresh_membership(id);
+    } else if (!library_subset) {
+        order.push_back(id);
+    }
+}
+
+bool PlaylistManager::refresh_membership(TrackId id) {
+    if (!smart) return false;
+    if (smart_members.size() <= id) smart_members.resize(id + 1, false);
+    // Placeholders join once their tags are read, rather than matching on
+    // empty fields now and dropping out later
+    bool member = !table.metadata_pending(id) && smart->matches(table, id);
+    if (member == smart_members[id]) return false;
+    
+    smart_members[id] = member;
+    if (member) {
+        order.push_back(id);
+    } else {
+        remove_from_order(id);
+    }
+    return true;
+}
+
+void PlaylistManager::remove_from_order(TrackId id) {
+    auto it = std::find(order.begin(), order.end(), id);
+    if (it == order.end()) return;
+    size_t position = it - order.begin();
+    order.erase(it);
+    // Dropping the current track leaves the previous one current, so the
+    // next advance plays the track that followed it
+    if (position < current_index || (position == current_index && current_index > 0)) {
+        current_index--;
+    } else if (position == current_index && !order.empty()) {
+        current_index = order.size() - 1;
+    }
+    if (current_index >= order.size()) current_index = 0;
 }
 
 bool PlaylistManager::load_playlist_file(const std::string& filepath) {
@@ -67,162 +633,248 @@ bool PlaylistManager::load_playlist_file(const std::string& filepath) {
         return load_m3u(filepath);
     } else if (ext == "pls") {
         return load_pls(filepath);
+    } else if (ext == "smart") {
+        return load_smart(filepath);
+    } else if (ext == "hpl") {
+        return load_binary(filepath);
     }
     
-    std::cerr << "Unsupported playlist format: " << ext << std::endl;
+    LOG_ERROR("playlist", "Unsupported playlist format: %s", ext.c_str());
     return false;
 }
 
 bool PlaylistManager::load_m3u(const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open playlist: " << filepath << std::endl;
+    std::vector<Track> tracks;
+    if (!PlaylistParser::parse_m3u(filepath, tracks)) {
+        LOG_ERROR("playlist", "Failed to open playlist: %s", filepath.c_str());
+        return false;
+    }
+    install_playlist(tracks);
+    LOG_INFO("playlist", "Loaded %zu tracks from playlist", tracks.size());
+    return !tracks.empty();
+}
+
+bool PlaylistManager::load_pls(const std::string& filepath) {
+    std::vector<Track> tracks;
+    if (!PlaylistParser::parse_pls(filepath, tracks)) {
+        LOG_ERROR("playlist", "Failed to open playlist: %s", filepath.c_str());
+        return false;
+    }
+    install_playlist(tracks);
+    LOG_INFO("playlist", "Loaded %zu tracks from PLS playlist", tracks.size());
+    return !tracks.empty();
+}
+
+bool PlaylistManager::load_binary(const std::string& filepath) {
+    TRACE_SCOPE("playlist", "load_binary");
+    BinaryPlaylist playlist;
+    if (!playlist.open(filepath)) {
+        LOG_ERROR("playlist", "Failed to open playlist: %s", filepath.c_str());
         return false;
     }
     
-    std::lock_guard<std::mutex> lock(playlist_mutex);
-    tracks.clear();
-    
-    std::string line;
-    std::string current_title;
-    int current_duration = -1;
-    
-    fs::path playlist_dir = fs::path(filepath).parent_path();
-    
-    while (std::getline(file, line)) {
-        // Trim whitespace
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        
-        if (line.empty() || line[0] == '#') {
-            // Extended M3U info
-            if (line.rfind("#EXTINF:", 0) == 0) {
-                size_t comma = line.find(',');
-                if (comma != std::string::npos) {
-                    std::string duration_str = line.substr(8, comma - 8);
-                    current_duration = std::stoi(duration_str);
-                    current_title = line.substr(comma + 1);
-                }
-            }
-            continue;
-        }
-        
-        // File path
-        fs::path track_path(line);
-        
-        // Handle relative paths
-        if (track_path.is_relative()) {
-            track_path = playlist_dir / track_path;
-        }
-        
-        if (fs::exists(track_path)) {
-            Track track(track_path.string());
-            
-            // Use EXTINF data if available
-            if (!current_title.empty()) {
-                // Parse "Artist - Title" format
-                size_t dash = current_title.find(" - ");
-                if (dash != std::string::npos) {
-                    track.artist = current_title.substr(0, dash);
-                    track.title = current_title.substr(dash + 3);
+    {
+        // With the library in the table, entries are picked out of it by
+        // path: no tags are read and no files are touched
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        if (library_backed && library_loaded && !scanning && table.size() > 0) {
+            std::optional<TrackId> current = current_track_id();
+            order.clear();
+            order.reserve(playlist.size());
+            smart.reset();
+            smart_members.clear();
+            invalid_entries.clear();
+            library_subset = true;
+            end_shuffle();
+            for (size_t i = 0; i < playlist.size(); ++i) {
+                std::optional<TrackId> id = table.find(playlist.path(i));
+                if (id) {
+                    order.push_back(*id);
                 } else {
-                    track.title = current_title;
-                }
-                
-                if (current_duration > 0) {
-                    track.duration_ms = current_duration * 1000;
+                    invalid_entries.emplace_back(playlist.path(i));
                 }
-                
-                current_title.clear();
-                current_duration = -1;
-            } else {
-                // Parse metadata from file
-                TrackMetadata meta = MetadataParser::parse(track_path.string());
-                track.title = meta.title.empty() ? track_path.filename().string() : meta.title;
-                track.artist = meta.artist.empty() ? "Unknown" : meta.artist;
-                track.duration_ms = meta.duration_seconds * 1000;
             }
+            restore_current(current);
+            publish(PUBLISH_ORDER);
             
-            tracks.push_back(track);
+            if (!invalid_entries.empty()) {
+                LOG_WARN("playlist", "%zu playlist entries not in the library, e.g. %s",
+                         invalid_entries.size(), invalid_entries[0].c_str());
+            }
+            LOG_INFO("playlist", "Loaded %zu tracks from binary playlist", order.size());
+            return !order.empty();
         }
     }
     
-    std::cout << "Loaded " << tracks.size() << " tracks from playlist" << std::endl;
+    std::vector<Track> tracks;
+    tracks.reserve(playlist.size());
+    for (size_t i = 0; i < playlist.size(); ++i) {
+        tracks.push_back(playlist.get(i));
+    }
+    install_playlist(tracks);
+    LOG_INFO("playlist", "Loaded %zu tracks from binary playlist", tracks.size());
     return !tracks.empty();
 }
 
-bool PlaylistManager::load_pls(const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open playlist: " << filepath << std::endl;
-        return false;
+void PlaylistManager::install_playlist(const std::vector<Track>& tracks) {
+    // Concurrent loads install one at a time, each joining the previous
+    // validator once; the destructor takes the same lock to join
+    std::lock_guard<std::mutex> owner(thread_owner_mutex);
+    
+    // A library load still walking the tree would add its files to the
+    // playlist; abandon it first. Only that load is stopped: cancel_scans
+    // belongs to the destructor and is never cleared.
+    if (library_thread.joinable()) {
+        library_load_cancel = true;
+        library_thread.join();
     }
     
-    std::lock_guard<std::mutex> lock(playlist_mutex);
-    tracks.clear();
+    // Parsed without the lock; installing is one pass over the entries.
+    // Existence is checked afterwards by the validator and tags without
+    // EXTINF data are read by the resolver threads.
+    uint64_t generation;
+    size_t queued;
+    {
+        std::lock_guard<std::mutex> lock(playlist_mutex);
+        // The old rows are tombstoned rather than cleared, so their IDs are
+        // never reused by the new playlist's tracks
+        for (TrackId id = 0; id < table.row_count(); ++id) {
+            table.remove(id);
+        }
+        if (table.needs_compaction()) {
+            table.compact();
+        }
+        order.clear();
+        order.reserve(tracks.size());
+        smart.reset();
+        smart_members.clear();
+        library_subset = false;
+        end_shuffle();
+        history.clear(); // Its rows are gone
+        queue.clear();
+        playing_queued.reset();
+        invalid_entries.clear();
+        library_backed = false;
+        current_index = 0;
+        resolve_queue.clear();
+        
+        for (const auto& track : tracks) {
+            append_track(track);
+        }
+        pending_metadata = table.count_metadata_pending();
+        // In playlist order; a file listed twice is queued twice and skipped
+        // the second time
+        for (TrackId id : order) {
+            if (table.metadata_pending(id)) resolve_queue.push_back(id);
+        }
+        queued = resolve_queue.size();
+        generation = ++playlist_generation;
+        publish(PUBLISH_TRACKS | PUBLISH_ORDER);
+    }
     
-    std::map<int, std::string> file_paths;
-    std::map<int, std::string> titles;
-    std::map<int, int> lengths;
+    start_resolvers();
+    wake_resolvers(queued);
     
-    std::string line;
-    fs::path playlist_dir = fs::path(filepath).parent_path();
+    // A validator for a previous playlist sees the new generation and stops
+    if (validator_thread.joinable()) {
+        validator_thread.join();
+    }
+    validator_thread = std::thread(&PlaylistManager::validate_playlist_loop, this, generation);
+}
+
+void PlaylistManager::validate_playlist_loop(uint64_t generation) {
+    Tracer::set_thread_name("playlist-validator");
+    Realtime::apply_to_current_thread(ThreadRole::SCANNER);
     
-    while (std::getline(file, line)) {
-        // Trim whitespace
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        
-        if (line.empty() || line == "[playlist]") continue;
-        
-        size_t eq = line.find('=');
-        if (eq == std::string::npos) continue;
-        
-        std::string key = line.substr(0, eq);
-        std::string value = line.substr(eq + 1);
-        
-        if (key.rfind("File", 0) == 0) {
-            int num = std::stoi(key.substr(4));
-            file_paths[num] = value;
-        } else if (key.rfind("Title", 0) == 0) {
-            int num = std::stoi(key.substr(5));
-            titles[num] = value;
-        } else if (key.rfind("Length", 0) == 0) {
-            int num = std::stoi(key.substr(6));
-            lengths[num] = std::stoi(value);
-        }
-    }
-    
-    // Build track list
-    for (const auto& pair : file_paths) {
-        int num = pair.first;
-        fs::path track_path(pair.second);
-        
-        if (track_path.is_relative()) {
-            track_path = playlist_dir / track_path;
+    std::vector<std::pair<TrackId, std::string>> batch;
+    std::vector<TrackId> missing;
+    TrackId next_id = 0;
+    size_t checked = 0, missing_total = 0;
+    
+    while (true) {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(playlist_mutex);
+            if (generation != playlist_generation) return;
+            for (; next_id < table.row_count() && batch.size() < VALIDATE_BATCH; ++next_id) {
+                if (table.alive(next_id)) batch.emplace_back(next_id, std::string(table.path(next_id)));
+            }
         }
+        if (batch.empty()) break;
         
-        if (fs::exists(track_path)) {
-            Track track(track_path.string());
-            
-            if (titles.count(num)) {
-                track.title = titles[num];
-            } else {
-                TrackMetadata meta = MetadataParser::parse(track_path.string());
-                track.title = meta.title.empty() ? track_path.filename().string() : meta.title;
-                track.artist = meta.artist;
+        missing.clear();
+        {
+            TRACE_SCOPE("playlist", "validate_entries");
+            for (const auto& entry : batch) {
+                uint64_t file_size;
+                int64_t mtime_ns;
+                if (!LibraryIndex::stat_file(entry.second, file_size, mtime_ns)) {
+                    missing.push_back(entry.first);
+                }
             }
-            
-            if (lengths.count(num)) {
-                track.duration_ms = lengths[num] * 1000;
+        }
+        checked += batch.size();
+        if (missing.empty()) continue;
+        
+        // Missing files leave the playlist and are reported as they are found
+        std::string example;
+        {
+            std::lock_guard<std::mutex> lock(playlist_mutex);
+            if (generation != playlist_generation) return;
+            std::optional<TrackId> current = current_track_id();
+            example = table.path(missing[0]);
+            for (TrackId id : missing) {
+                if (table.metadata_pending(id)) pending_metadata--;
+                invalid_entries.emplace_back(table.path(id));
+                table.remove(id);
             }
-            
-            tracks.push_back(track);
+            order.erase(std::remove_if(order.begin(), order.end(),
+                [this](TrackId id) { return !table.alive(id); }), order.end());
+            restore_current(current);
+            publish(PUBLISH_TRACKS | PUBLISH_ORDER);
         }
+        missing_total += missing.size();
+        LOG_WARN("playlist", "%zu playlist entries not found, e.g. %s", missing.size(), example.c_str());
     }
     
-    std::cout << "Loaded " << tracks.size() << " tracks from PLS playlist" << std::endl;
-    return !tracks.empty();
+    LOG_INFO("playlist", "Playlist checked: %zu entries, %zu missing", checked, missing_total);
+}
+
+std::vector<std::string> PlaylistManager::get_invalid_entries() const {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    return invalid_entries;
+}
+
+bool PlaylistManager::load_smart(const std::string& filepath) {
+    SmartPlaylist rules;
+    std::string error;
+    if (!rules.load(filepath, error)) {
+        LOG_ERROR("playlist", "Invalid smart playlist %s: %s", filepath.c_str(), error.c_str());
+        return false;
+    }
+    
+    // Filter the rows already in the table; nothing is rescanned or copied
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    std::optional<TrackId> current = current_track_id();
+    smart = std::move(rules);
+    smart_members.assign(table.row_count(), false);
+    library_subset = false;
+    end_shuffle();
+    order.clear();
+    for (TrackId id = 0; id < table.row_count(); ++id) {
+        if (!table.metadata_pending(id) && smart->matches(table, id)) {
+            smart_members[id] = true;
+            order.push_back(id);
+        }
+    }
+    std::sort(order.begin(), order.end(),
+        [this](TrackId a, TrackId b) { return table.path(a) < table.path(b); });
+    restore_current(current);
+    publish(PUBLISH_ORDER);
+    
+    LOG_INFO("playlist", "Smart playlist %s: %zu rules, %zu of %zu tracks match",
+             filepath.c_str(), smart->rule_count(), order.size(), table.size());
+    return true;
 }
 
 bool PlaylistManager::save_playlist(const std::string& filepath, PlaylistFormat format) {
@@ -232,21 +884,39 @@ bool PlaylistManager::save_playlist(const std::string& filepath, PlaylistFormat
         return save_m3u(filepath);
     } else if (format == PlaylistFormat::PLS) {
         return save_pls(filepath);
+    } else if (format == PlaylistFormat::BINARY) {
+        return BinaryPlaylist::save(filepath, table, order);
     }
     
     return false;
 }
 
+std::string PlaylistManager::display_title(TrackId id) const {
+    // "Artist - Title", as PlaylistParser reads it back; without a known
+    // artist the title stands alone
+    std::string display;
+    std::string_view artist = table.artist(id);
+    if (!artist.empty() && artist != "Unknown") {
+        display += artist;
+        display += " - ";
+    }
+    display += table.title(id);
+    return display;
+}
+
 bool PlaylistManager::save_m3u(const std::string& filepath) {
     std::ofstream file(filepath);
     if (!file.is_open()) return false;
     
     file << "#EXTM3U\n";
     
-    for (const auto& track : tracks) {
-        int duration_sec = track.duration_ms / 1000;
-        file << "#EXTINF:" << duration_sec << "," << track.artist << " - " << track.title << "\n";
-        file << track.filepath << "\n";
+    for (TrackId id : order) {
+        // Unread entries stay bare, so they load as placeholders again
+        if (!table.metadata_pending(id)) {
+            int duration_sec = table.duration_ms(id) / 1000;
+            file << "#EXTINF:" << duration_sec << "," << display_title(id) << "\n";
+        }
+        file << table.path(id) << "\n";
     }
     
     return true;
@@ -257,57 +927,98 @@ bool PlaylistManager::save_pls(const std::string& filepath) {
     if (!file.is_open()) return false;
     
     file << "[playlist]\n";
-    file << "NumberOfEntries=" << tracks.size() << "\n\n";
+    file << "NumberOfEntries=" << order.size() << "\n\n";
     
-    for (size_t i = 0; i < tracks.size(); ++i) {
-        file << "File" << (i + 1) << "=" << tracks[i].filepath << "\n";
-        file << "Title" << (i + 1) << "=" << tracks[i].artist << " - " << tracks[i].title << "\n";
-        file << "Length" << (i + 1) << "=" << (tracks[i].duration_ms / 1000) << "\n\n";
+    for (size_t i = 0; i < order.size(); ++i) {
+        TrackId id = order[i];
+        file << "File" << (i + 1) << "=" << table.path(id) << "\n";
+        if (!table.metadata_pending(id)) {
+            file << "Title" << (i + 1) << "=" << display_title(id) << "\n";
+            file << "Length" << (i + 1) << "=" << (table.duration_ms(id) / 1000) << "\n";
+        }
+        file << "\n";
     }
     
     file << "Version=2\n";
     return true;
 }
 
-void PlaylistManager::shuffle() {
+void PlaylistManager::shuffle(ShuffleMode mode) {
     std::lock_guard<std::mutex> lock(playlist_mutex);
-    if (tracks.empty()) return;
+    if (order.empty()) return;
     
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(tracks.begin(), tracks.end(), g);
+    // The listed order is kept once; shuffling again only redraws
+    if (!shuffled) {
+        unshuffled = order;
+        shuffled = true;
+    }
+    shuffle_mode = mode;
+    reshuffle();
+    publish(PUBLISH_ORDER);
+}
+
+void PlaylistManager::unshuffle() {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    if (!shuffled) return;
+    
+    // Back to the listed order, less rows that left the playlist since and
+    // plus those that joined, which go at the end in play order. Counting
+    // handles tracks listed twice.
+    std::optional<TrackId> current = current_track_id();
+    std::vector<uint32_t> remaining(table.row_count(), 0);
+    for (TrackId id : order) {
+        if (id < remaining.size()) remaining[id]++;
+    }
+    std::vector<TrackId> restored;
+    restored.reserve(order.size());
+    for (TrackId id : unshuffled) {
+        if (id < remaining.size() && remaining[id] > 0) {
+            remaining[id]--;
+            restored.push_back(id);
+        }
+    }
+    for (TrackId id : order) {
+        if (id < remaining.size() && remaining[id] > 0) {
+            remaining[id]--;
+            restored.push_back(id);
+        }
+    }
+    
+    order = std::move(restored);
+    end_shuffle();
+    restore_current(current);
+    publish(PUBLISH_ORDER);
+}
+
+void PlaylistManager::reshuffle() {
+    std::optional<TrackId> current = current_track_id();
+    Shuffler::shuffle(order, table, shuffle_mode, history, shuffle_rng);
+    if (current) {
+        std::iter_swap(order.begin(), std::find(order.begin(), order.end(), *current));
+    }
     current_index = 0;
 }
 
+void PlaylistManager::end_shuffle() {
+    shuffled = false;
+    unshuffled.clear();
+    unshuffled.shrink_to_fit();
+}
+
 void PlaylistManager::sort_by(SortCriteria criteria) {
     std::lock_guard<std::mutex> lock(playlist_mutex);
+    std::optional<TrackId> current = current_track_id();
+    end_shuffle();
     
-    switch (criteria) {
-        case SortCriteria::TITLE:
-            std::sort(tracks.begin(), tracks.end(), 
-                [](const Track& a, const Track& b) { return a.title < b.title; });
-            break;
-        case SortCriteria::ARTIST:
-            std::sort(tracks.begin(), tracks.end(),
-                [](const Track& a, const Track& b) { return a.artist < b.artist; });
-            break;
-        case SortCriteria::ALBUM:
-            std::sort(tracks.begin(), tracks.end(),
-                [](const Track& a, const Track& b) { return a.album < b.album; });
-            break;
-        case SortCriteria::DURATION:
-            std::sort(tracks.begin(), tracks.end(),
-                [](const Track& a, const Track& b) { return a.duration_ms < b.duration_ms; });
-            break;
-    }
+    // Collation keys and the sorted library are cached between sorts; only
+    // the IDs move
+    sort_index.sort(table, order, criteria);
+    restore_current(current);
+    publish(PUBLISH_ORDER);
 }
 
 bool PlaylistManager::is_supported_format(const std::string& ext) {
-    std::string lower_ext = ext;
-    std::transform(lower_ext.begin(), lower_ext.end(), lower_ext.begin(), ::tolower);
-    
-    return lower_ext == ".mp3" || lower_ext == ".wav" || lower_ext == ".ogg" || 
-           lower_ext == ".flac" || lower_ext == ".m4a" || lower_ext == ".aac";
+    return LibraryScanner::is_supported_format(ext);
 }
 
 void PlaylistManager::set_auto_advance(bool enable) { 
@@ -318,70 +1029,191 @@ void PlaylistManager::enable_cue_system(bool enable) {
     cue_system_enabled = enable; 
 }
 
-Track* PlaylistManager::get_current_track() {
-    std::lock_guard<std::mutex> lock(playlist_mutex);
-    if (tracks.empty()) return nullptr;
-    return &tracks[current_index];
+std::shared_ptr<const PlaylistSnapshot> PlaylistManager::snapshot() const {
+    return std::atomic_load(&published);
 }
 
-Track* PlaylistManager::get_next_track() {
-    std::lock_guard<std::mutex> lock(playlist_mutex);
-    if (tracks.empty()) return nullptr;
-    size_t next = (current_index + 1) % tracks.size();
-    return &tracks[next];
+std::optional<Track> PlaylistManager::get_current_track() {
+    return snapshot()->current_track();
+}
+
+std::optional<Track> PlaylistManager::get_next_track() {
+    return snapshot()->next_track();
+}
+
+unsigned PlaylistManager::advance() {
+    if (order.empty()) return PUBLISH_POSITION;
+    if (shuffled && current_index + 1 >= order.size() && order.size() > 1) {
+        // Every track had its turn: draw the next round, which must not
+        // open with the track that just ended
+        TrackId last = order[current_index];
+        Shuffler::shuffle(order, table, shuffle_mode, history, shuffle_rng);
+        if (order.front() == last) {
+            std::iter_swap(order.begin(), order.end() - 1);
+        }
+        current_index = 0;
+        return PUBLISH_ORDER;
+    }
+    current_index = (current_index + 1) % order.size();
+    return PUBLISH_POSITION;
 }
 
 void PlaylistManager::next() {
     std::lock_guard<std::mutex> lock(playlist_mutex);
-    if (tracks.empty()) return;
-    current_index = (current_index + 1) % tracks.size();
+    TrackId queued;
+    if (queue.pop(queued)) {
+        // Leaving the playlist: step past the track that was playing now,
+        // so play resumes after it once the queue is empty
+        unsigned changes = PUBLISH_QUEUE;
+        if (!playing_queued) changes |= advance();
+        playing_queued = queued;
+        publish(changes);
+        return;
+    }
+    if (playing_queued) {
+        playing_queued.reset();
+        publish(PUBLISH_POSITION);
+        return;
+    }
+    publish(advance());
 }
 
 void PlaylistManager::previous() {
     std::lock_guard<std::mutex> lock(playlist_mutex);
-    if (tracks.empty()) return;
+    // From a queued track, back to the playlist track played before it
+    playing_queued.reset();
+    if (order.empty()) {
+        publish(PUBLISH_POSITION);
+        return;
+    }
     if (current_index > 0) {
         current_index--;
     } else {
-        current_index = tracks.size() - 1;
+        current_index = order.size() - 1;
     }
+    publish(PUBLISH_POSITION);
 }
 
 void PlaylistManager::jump_to(size_t index) {
     std::lock_guard<std::mutex> lock(playlist_mutex);
-    if (index < tracks.size()) {
+    if (index < order.size()) {
         current_index = index;
+        playing_queued.reset();
+        publish(PUBLISH_POSITION);
     }
 }
 
-void PlaylistManager::add_to_queue(const std::string& filepath) {
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    queue.push_back(filepath);
+bool PlaylistManager::jump_to_track(TrackId id) {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    auto it = std::find(order.begin(), order.end(), id);
+    if (it == order.end()) return false;
+    current_index = it - order.begin();
+    playing_queued.reset();
+    publish(PUBLISH_POSITION);
+    return true;
 }
 
-Track* PlaylistManager::get_queued_track() {
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    if (queue.empty()) return nullptr;
+void PlaylistManager::record_play() {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    std::optional<TrackId> id = playing_queued ? playing_queued : current_track_id();
+    if (!id) return;
+    table.add_play(*id);
+    history.record(*id);
+    index_dirty = true;
     
-    Track* track = new Track(queue.front());
-    queue.erase(queue.begin());
-    return track;
+    unsigned changes = PUBLISH_TRACKS;
+    if (smart && smart->uses_play_count() && refresh_membership(*id)) {
+        changes |= PUBLISH_ORDER;
+    }
+    publish(changes);
+}
+
+bool PlaylistManager::enqueue(TrackId id, QueuePriority priority) {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    if (!table.alive(id)) return false;
+    queue.push(id, priority);
+    publish(PUBLISH_QUEUE);
+    return true;
+}
+
+bool PlaylistManager::play_next(TrackId id) {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    if (!table.alive(id)) return false;
+    queue.push_front(id, QueuePriority::HIGH);
+    publish(PUBLISH_QUEUE);
+    return true;
+}
+
+bool PlaylistManager::add_to_queue(const std::string& filepath, QueuePriority priority) {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    std::optional<TrackId> id = table.find(filepath);
+    if (!id || !table.alive(*id)) return false;
+    queue.push(*id, priority);
+    publish(PUBLISH_QUEUE);
+    return true;
+}
+
+bool PlaylistManager::move_queued(size_t from, size_t to) {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    if (!queue.move(from, to)) return false;
+    publish(PUBLISH_QUEUE);
+    return true;
+}
+
+bool PlaylistManager::set_queued_priority(size_t position, QueuePriority priority) {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    if (!queue.set_priority(position, priority)) return false;
+    publish(PUBLISH_QUEUE);
+    return true;
 }
 
-bool PlaylistManager::has_queued() {
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    return !queue.empty();
+bool PlaylistManager::remove_queued(size_t position) {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    if (!queue.erase(position)) return false;
+    publish(PUBLISH_QUEUE);
+    return true;
+}
+
+void PlaylistManager::clear_queue() {
+    std::lock_guard<std::mutex> lock(playlist_mutex);
+    queue.clear();
+    publish(PUBLISH_QUEUE);
 }
 
 size_t PlaylistManager::get_track_count() const { 
-    return tracks.size(); 
+    return snapshot()->size(); 
 }
 
 size_t PlaylistManager::get_current_index() const { 
-    return current_index; 
+    return snapshot()->current_index; 
 }
 
 std::vector<Track> PlaylistManager::get_all_tracks() {
+    std::shared_ptr<const PlaylistSnapshot> view = snapshot();
+    std::vector<Track> result;
+    result.reserve(view->size());
+    for (TrackId id : *view->order) {
+        result.push_back(view->tracks->get(id));
+    }
+    return result;
+}
+
+std::vector<Track> PlaylistManager::get_tracks(size_t start, size_t count) const {
+    std::shared_ptr<const PlaylistSnapshot> view = snapshot();
+    std::vector<Track> result;
+    for (size_t i = start; i < view->size() && result.size() < count; ++i) {
+        result.push_back(*view->track_at(i));
+    }
+    return result;
+}
+
+size_t PlaylistManager::get_library_memory_bytes() const {
     std::lock_guard<std::mutex> lock(playlist_mutex);
-    return tracks;
+    return table.memory_bytes() + order.capacity() * sizeof(TrackId);
+}
+
+std::vector<SearchHit> PlaylistManager::search(std::string_view query, size_t limit) {
+    std::shared_ptr<const PlaylistSnapshot> view = snapshot();
+    search_index.sync(view->tracks);
+    return search_index.search(query, limit);
 }
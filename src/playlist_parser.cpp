@@ -0,0 +1,208 @@
+#include "playlist_parser.h"
+#include "mapped_file.h"
+#include "trace.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+
+namespace
+{
+    std::string_view trim(std::string_view s)
+    {
+        size_t start = s.find_first_not_of(" \t\r\n");
+        if (start == std::string_view::npos)
+            return std::string_view();
+        size_t end = s.find_last_not_of(" \t\r\n");
+        return s.substr(start, end - start + 1);
+    }
+
+    // Calls `line` for each trimmed, non-empty line
+    template <typename Fn>
+    void for_each_line(std::string_view text, Fn line)
+    {
+        if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) // UTF-8 byte order mark
+            text.remove_prefix(3);
+        while (!text.empty())
+        {
+            size_t newline = text.find('\n');
+            std::string_view current = trim(text.substr(0, newline));
+            text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+            if (!current.empty())
+                line(current);
+        }
+    }
+
+    // Leading integer of `s` ("123", "-1", "215.5"); false if there is none
+    bool leading_int(std::string_view s, long &value)
+    {
+        s = trim(s);
+        bool negative = !s.empty() && s[0] == '-';
+        size_t i = negative ? 1 : 0;
+        if (i >= s.size() || s[i] < '0' || s[i] > '9')
+            return false;
+        value = 0;
+        for (; i < s.size() && s[i] >= '0' && s[i] <= '9' && value < 100000000; ++i)
+            value = value * 10 + (s[i] - '0');
+        if (negative)
+            value = -value;
+        return true;
+    }
+
+    // Playlist lengths reach about 1e9 seconds; clamp so milliseconds fit an int
+    int seconds_to_ms(long seconds)
+    {
+        constexpr long MAX_SECONDS = std::numeric_limits<int>::max() / 1000;
+        return static_cast<int>(std::min(seconds, MAX_SECONDS) * 1000);
+    }
+
+    std::string resolve_path(std::string_view entry, const std::string &base_dir)
+    {
+        if (entry.compare(0, 7, "file://") == 0)
+            entry.remove_prefix(7);
+        if (entry.empty() || entry[0] == '/' || base_dir.empty())
+            return std::string(entry);
+        std::string path = base_dir;
+        path += '/';
+        path.append(entry.data(), entry.size());
+        return path;
+    }
+
+    std::string base_directory(const std::string &filepath)
+    {
+        size_t slash = filepath.find_last_of('/');
+        return slash == std::string::npos ? std::string(".") : filepath.substr(0, slash);
+    }
+
+    Track placeholder(std::string path)
+    {
+        Track track(std::move(path));
+        size_t slash = track.filepath.find_last_of('/');
+        track.title = slash == std::string::npos ? track.filepath : track.filepath.substr(slash + 1);
+        track.metadata_pending = true;
+        return track;
+    }
+
+    // "Artist - Title" as written by save_m3u/save_pls
+    void set_display_title(Track &track, std::string_view display)
+    {
+        size_t dash = display.find(" - ");
+        if (dash != std::string_view::npos)
+        {
+            track.artist = std::string(display.substr(0, dash));
+            track.title = std::string(display.substr(dash + 3));
+        }
+        else
+        {
+            track.title = std::string(display);
+        }
+    }
+}
+
+void PlaylistParser::parse_m3u_text(std::string_view text, const std::string &base_dir, std::vector<Track> &tracks)
+{
+    TRACE_SCOPE("playlist", "parse_m3u");
+    // A playlist line is ~60 bytes; reserving avoids most regrowth
+    tracks.reserve(tracks.size() + text.size() / 64);
+
+    std::string_view extinf;
+    for_each_line(text, [&](std::string_view line)
+                  {
+        if (line[0] == '#')
+        {
+            if (line.compare(0, 8, "#EXTINF:") == 0)
+                extinf = line.substr(8);
+            return;
+        }
+
+        std::string path = resolve_path(line, base_dir);
+        if (extinf.empty())
+        {
+            tracks.push_back(placeholder(std::move(path)));
+            return;
+        }
+
+        // #EXTINF:<seconds>[ attributes],<display title>
+        Track track(std::move(path));
+        size_t comma = extinf.find(',');
+        long seconds = 0;
+        if (leading_int(extinf.substr(0, comma), seconds) && seconds > 0)
+            track.duration_ms = seconds_to_ms(seconds);
+        std::string_view display = comma == std::string_view::npos ? std::string_view() : trim(extinf.substr(comma + 1));
+        if (display.empty())
+        {
+            // Duration only: the tags still have to be read
+            Track pending = placeholder(std::move(track.filepath));
+            pending.duration_ms = track.duration_ms;
+            tracks.push_back(std::move(pending));
+        }
+        else
+        {
+            set_display_title(track, display);
+            tracks.push_back(std::move(track));
+        }
+        extinf = std::string_view(); });
+}
+
+void PlaylistParser::parse_pls_text(std::string_view text, const std::string &base_dir, std::vector<Track> &tracks)
+{
+    TRACE_SCOPE("playlist", "parse_pls");
+
+    // FileN, TitleN and LengthN may come in any order; collect by N
+    struct Entry
+    {
+        std::string_view file;
+        std::string_view title;
+        long length = 0;
+    };
+    std::map<long, Entry> entries;
+
+    for_each_line(text, [&](std::string_view line)
+                  {
+        size_t eq = line.find('=');
+        if (eq == std::string_view::npos)
+            return;
+        std::string_view key = trim(line.substr(0, eq));
+        std::string_view value = trim(line.substr(eq + 1));
+        long number = 0;
+
+        if (key.compare(0, 4, "File") == 0 && leading_int(key.substr(4), number))
+            entries[number].file = value;
+        else if (key.compare(0, 5, "Title") == 0 && leading_int(key.substr(5), number))
+            entries[number].title = value;
+        else if (key.compare(0, 6, "Length") == 0 && leading_int(key.substr(6), number))
+            leading_int(value, entries[number].length); });
+
+    tracks.reserve(tracks.size() + entries.size());
+    for (const auto &item : entries)
+    {
+        const Entry &entry = item.second;
+        if (entry.file.empty())
+            continue;
+
+        std::string path = resolve_path(entry.file, base_dir);
+        Track track = entry.title.empty() ? placeholder(std::move(path)) : Track(std::move(path));
+        if (!entry.title.empty())
+            set_display_title(track, entry.title);
+        if (entry.length > 0)
+            track.duration_ms = seconds_to_ms(entry.length);
+        tracks.push_back(std::move(track));
+    }
+}
+
+bool PlaylistParser::parse_m3u(const std::string &filepath, std::vector<Track> &tracks)
+{
+    MappedFile file(filepath);
+    if (!file.is_open())
+        return false;
+    parse_m3u_text(file.bytes(), base_directory(filepath), tracks);
+    return true;
+}
+
+bool PlaylistParser::parse_pls(const std::string &filepath, std::vector<Track> &tracks)
+{
+    MappedFile file(filepath);
+    if (!file.is_open())
+        return false;
+    parse_pls_text(file.bytes(), base_directory(filepath), tracks);
+    return true;
+}
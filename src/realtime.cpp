@@ -0,0 +1,252 @@
+#include "realtime.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+    constexpr int ROLE_COUNT = 5;
+    constexpr size_t STACK_PREFAULT_BYTES = 64 * 1024;
+
+    std::mutex g_rt_mutex;
+    ThreadSchedConfig g_settings[ROLE_COUNT];
+    std::string g_results[ROLE_COUNT];
+    std::atomic<bool> g_reported[ROLE_COUNT];
+    std::string g_mlock_result = "not requested";
+    bool g_mlock = false;
+
+    std::vector<int> parse_cpu_list(const std::string &spec)
+    {
+        // "2,3" or "0-3" or "0-1,4"
+        std::vector<int> cpus;
+        std::stringstream ss(spec);
+        std::string part;
+        while (std::getline(ss, part, ','))
+        {
+            size_t dash = part.find('-');
+            try
+            {
+                if (dash == std::string::npos)
+                {
+                    cpus.push_back(std::stoi(part));
+                }
+                else
+                {
+                    int first = std::stoi(part.substr(0, dash));
+                    int last = std::stoi(part.substr(dash + 1));
+                    for (int cpu = first; cpu <= last; ++cpu)
+                        cpus.push_back(cpu);
+                }
+            }
+            catch (const std::exception &)
+            {
+                // Ignore malformed entries
+            }
+        }
+        return cpus;
+    }
+
+    std::string apply_nice(int nice_level)
+    {
+#ifdef __linux__
+        // On Linux, setpriority on a TID affects only that thread
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        if (setpriority(PRIO_PROCESS, tid, nice_level) == 0)
+        {
+            return "nice " + std::to_string(nice_level);
+        }
+        return "nice " + std::to_string(nice_level) + " denied (" + strerror(errno) + ")";
+#else
+        return "per-thread nice unsupported";
+#endif
+    }
+
+    std::string apply_policy(const ThreadSchedConfig &cfg)
+    {
+        int policy = SCHED_OTHER;
+        if (cfg.policy == "fifo")
+            policy = SCHED_FIFO;
+        else if (cfg.policy == "rr")
+            policy = SCHED_RR;
+
+        if (policy == SCHED_OTHER)
+        {
+            return cfg.nice != 0 ? apply_nice(cfg.nice) : "default scheduling";
+        }
+
+        int min_prio = sched_get_priority_min(policy);
+        int max_prio = sched_get_priority_max(policy);
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = std::max(min_prio, std::min(max_prio, cfg.priority));
+
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        std::string name = policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR";
+        if (err == 0)
+        {
+            return name + " priority " + std::to_string(param.sched_priority);
+        }
+
+        // Typically EPERM without CAP_SYS_NICE / RLIMIT_RTPRIO: fall back to nice
+        return name + " denied (" + strerror(err) + "), " + apply_nice(cfg.nice);
+    }
+
+    std::string apply_affinity(const std::string &spec)
+    {
+        if (spec.empty())
+            return "";
+
+        std::vector<int> cpus = parse_cpu_list(spec);
+        if (cpus.empty())
+            return ", invalid cpu list '" + spec + "'";
+
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err == 0)
+            return ", pinned to cpus " + spec;
+        return ", pinning to " + spec + " failed (" + strerror(err) + ")";
+#else
+        return ", cpu pinning unsupported on this platform";
+#endif
+    }
+
+    void prefault_stack()
+    {
+        volatile char stack[STACK_PREFAULT_BYTES];
+        for (size_t i = 0; i < sizeof(stack); i += 4096)
+        {
+            stack[i] = 0;
+        }
+    }
+}
+
+const char *Realtime::role_name(ThreadRole role)
+{
+    switch (role)
+    {
+    case ThreadRole::AUDIO:
+        return "audio";
+    case ThreadRole::DECODER:
+        return "decoder";
+    case ThreadRole::ENCODER:
+        return "encoder";
+    case ThreadRole::NETWORK:
+        return "network";
+    case ThreadRole::SCANNER:
+        return "scanner";
+    }
+    return "unknown";
+}
+
+void Realtime::configure(const Config &config)
+{
+    std::lock_guard<std::mutex> lock(g_rt_mutex);
+
+    for (int i = 0; i < ROLE_COUNT; ++i)
+    {
+        auto it = config.thread_sched.find(role_name(static_cast<ThreadRole>(i)));
+        g_settings[i] = it != config.thread_sched.end() ? it->second : ThreadSchedConfig();
+        g_results[i] = "not started";
+        g_reported[i] = false;
+    }
+
+    g_mlock = config.rt_mlock;
+    if (g_mlock)
+    {
+        int flags = MCL_CURRENT | MCL_FUTURE;
+        const char *locked = "all current and future pages locked";
+#ifdef MCL_ONFAULT
+        // Lock pages as they are first touched instead of populating every
+        // mapping (thread stacks, the library index) in full; the audio
+        // buffers and thread stacks are prefaulted explicitly
+        flags |= MCL_ONFAULT;
+        locked = "all current and future pages locked on first touch";
+#endif
+        int result = mlockall(flags);
+#ifdef MCL_ONFAULT
+        if (result != 0 && errno == EINVAL) // Kernel before 4.4
+        {
+            result = mlockall(MCL_CURRENT | MCL_FUTURE);
+            locked = "all current and future pages locked";
+        }
+#endif
+        if (result == 0)
+        {
+            g_mlock_result = locked;
+        }
+        else
+        {
+            g_mlock_result = std::string("mlockall failed (") + strerror(errno) + ")";
+        }
+        LOG_INFO("realtime", "Memory locking: %s", g_mlock_result.c_str());
+    }
+}
+
+void Realtime::apply_to_current_thread(ThreadRole role)
+{
+    int idx = static_cast<int>(role);
+    ThreadSchedConfig cfg;
+    {
+        std::lock_guard<std::mutex> lock(g_rt_mutex);
+        cfg = g_settings[idx];
+    }
+
+    std::string result = apply_policy(cfg) + apply_affinity(cfg.cpus);
+    if (g_mlock)
+    {
+        prefault_stack();
+    }
+
+    // Many threads share a role (one per listener); report the first outcome
+    if (!g_reported[idx].exchange(true))
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_rt_mutex);
+            g_results[idx] = result;
+        }
+        LOG_INFO("realtime", "%s threads: %s", role_name(role), result.c_str());
+    }
+}
+
+void Realtime::prefault(void *data, size_t bytes)
+{
+    volatile char *p = static_cast<volatile char *>(data);
+    long page = sysconf(_SC_PAGESIZE);
+    size_t step = page > 0 ? static_cast<size_t>(page) : 4096;
+    for (size_t i = 0; i < bytes; i += step)
+    {
+        p[i] = p[i];
+    }
+}
+
+std::string Realtime::report()
+{
+    std::lock_guard<std::mutex> lock(g_rt_mutex);
+    std::stringstream ss;
+    ss << "memory: " << g_mlock_result;
+    for (int i = 0; i < ROLE_COUNT; ++i)
+    {
+        ss << "; " << role_name(static_cast<ThreadRole>(i)) << ": " << g_results[i];
+    }
+    return ss.str();
+}
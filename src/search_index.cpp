@@ -0,0 +1,428 @@
+#include "search_index.h"
+#include "sort_index.h"
+#include "trace.h"
+#include "logger.h"
+#include <algorithm>
+#include <mutex>
+
+namespace
+{
+    enum : uint8_t
+    {
+        FIELD_TITLE = 1,
+        FIELD_ARTIST = 2,
+        FIELD_ALBUM = 4,
+        FIELD_GENRE = 8
+    };
+
+    constexpr size_t MAX_PREFIX_TERMS = 64; // Words a prefix may expand to
+    constexpr size_t MAX_FUZZY_TERMS = 16;  // Closest words a misspelling may match
+    constexpr size_t MIN_FUZZY_LENGTH = 4;  // Shorter words match too much by trigram
+    constexpr float MIN_SIMILARITY = 0.3f;  // Trigram Jaccard; two swapped letters in eight score 0.33
+    constexpr size_t REBUILD_MIN_ROWS = 1024;
+
+    float field_weight(uint8_t fields)
+    {
+        if (fields & FIELD_TITLE)
+            return 3.0f;
+        if (fields & FIELD_ARTIST)
+            return 2.0f;
+        if (fields & FIELD_ALBUM)
+            return 1.5f;
+        return 1.0f;
+    }
+
+    // Trigrams of "$word$"; a word of n bytes has n of them
+    void word_trigrams(const std::string &word, std::vector<uint32_t> &out)
+    {
+        std::string padded = "$" + word + "$";
+        for (size_t i = 0; i + 3 <= padded.size(); ++i)
+        {
+            out.push_back(static_cast<uint8_t>(padded[i]) << 16 | static_cast<uint8_t>(padded[i + 1]) << 8 |
+                          static_cast<uint8_t>(padded[i + 2]));
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    using Hits = std::vector<std::pair<TrackId, float>>;
+
+    // Union of two ID-sorted lists, keeping the better score per track
+    Hits merge_best(const Hits &a, const Hits &b)
+    {
+        Hits merged;
+        merged.reserve(a.size() + b.size());
+        auto i = a.begin();
+        auto j = b.begin();
+        while (i != a.end() && j != b.end())
+        {
+            if (i->first < j->first)
+                merged.push_back(*i++);
+            else if (j->first < i->first)
+                merged.push_back(*j++);
+            else
+            {
+                merged.emplace_back(i->first, std::max(i->second, j->second));
+                ++i;
+                ++j;
+            }
+        }
+        merged.insert(merged.end(), i, a.end());
+        merged.insert(merged.end(), j, b.end());
+        return merged;
+    }
+}
+
+void SearchIndex::tokenize(std::string_view text, std::vector<std::string> &words)
+{
+    Collation::words(text, words);
+}
+
+void SearchIndex::clear()
+{
+    lookup.clear();
+    dictionary.clear();
+    term_text.clear();
+    postings.clear();
+    trigrams.clear();
+    rows.clear();
+    row_terms.clear();
+}
+
+uint32_t SearchIndex::term_id(const std::string &word)
+{
+    auto found = lookup.find(word);
+    if (found != lookup.end())
+        return found->second;
+
+    uint32_t id = static_cast<uint32_t>(term_text.size());
+    auto it = dictionary.emplace(word, id).first;
+    lookup.emplace(it->first, id);
+    term_text.push_back(&it->first);
+    postings.emplace_back();
+
+    if (word.size() >= 3)
+    {
+        std::vector<uint32_t> grams;
+        word_trigrams(word, grams);
+        for (uint32_t gram : grams)
+            trigrams[gram].push_back(id);
+    }
+    return id;
+}
+
+void SearchIndex::index_row(const TrackTable &tracks, TrackId id, FieldTerms &field_terms)
+{
+    // Term -> fields it occurs in, for this track
+    std::vector<std::pair<uint32_t, uint8_t>> terms;
+    auto add_terms = [&terms](const std::vector<uint32_t> &ids, uint8_t field)
+    {
+        for (uint32_t term : ids)
+        {
+            auto it = std::find_if(terms.begin(), terms.end(), [term](const auto &t)
+                                   { return t.first == term; });
+            if (it != terms.end())
+                it->second |= field;
+            else
+                terms.emplace_back(term, field);
+        }
+    };
+    std::vector<std::string> words;
+    auto tokenize_terms = [&](std::string_view text)
+    {
+        std::vector<uint32_t> ids;
+        words.clear();
+        tokenize(text, words);
+        for (const auto &word : words)
+            ids.push_back(term_id(word));
+        return ids;
+    };
+    // Artists, albums and genres repeat across many rows; tokenize each value once
+    auto add_interned = [&](uint32_t string_id, uint8_t field)
+    {
+        auto it = field_terms.find(string_id);
+        if (it == field_terms.end())
+            it = field_terms.emplace(string_id, tokenize_terms(tracks.string_pool().get(string_id))).first;
+        add_terms(it->second, field);
+    };
+
+    add_terms(tokenize_terms(tracks.title(id)), FIELD_TITLE);
+    add_interned(tracks.artist_id(id), FIELD_ARTIST);
+    add_interned(tracks.album_id(id), FIELD_ALBUM);
+    add_interned(tracks.genre_id(id), FIELD_GENRE);
+
+    row_terms[id].reserve(terms.size());
+    for (const auto &t : terms)
+    {
+        std::vector<Posting> &list = postings[t.first];
+        Posting posting{id, t.second};
+        // Initial indexing visits rows in ID order, so this is nearly always an append
+        if (list.empty() || list.back().id < id)
+        {
+            list.push_back(posting);
+        }
+        else
+        {
+            list.insert(std::lower_bound(list.begin(), list.end(), id, [](const Posting &p, TrackId v)
+                                         { return p.id < v; }),
+                        posting);
+        }
+        row_terms[id].push_back(t.first);
+    }
+}
+
+void SearchIndex::unindex_row(TrackId id)
+{
+    for (uint32_t term : row_terms[id])
+    {
+        std::vector<Posting> &list = postings[term];
+        auto it = std::lower_bound(list.begin(), list.end(), id, [](const Posting &p, TrackId v)
+                                   { return p.id < v; });
+        if (it != list.end() && it->id == id)
+            list.erase(it);
+    }
+    row_terms[id].clear();
+}
+
+void SearchIndex::sync(const std::shared_ptr<const TrackTable> &tracks)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (indexed.lock() == tracks)
+            return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (indexed.lock() == tracks)
+        return;
+    TRACE_SCOPE("search", "sync");
+
+    const TrackTable &table = *tracks;
+    auto signature = [&table](TrackId id)
+    {
+        RowSignature sig;
+        sig.alive = table.alive(id);
+        if (sig.alive)
+        {
+            sig.title = table.title_id(id);
+            sig.artist = table.artist_id(id);
+            sig.album = table.album_id(id);
+            sig.genre = table.genre_id(id);
+        }
+        return sig;
+    };
+
+    // New rows are cheap appends; changed rows must first be unindexed. When
+    // most rows changed (a new playlist, a compacted string pool) start over.
+    std::vector<TrackId> changed;
+    size_t modified = 0;
+    bool rebuild = table.lineage() != lineage;
+    if (!rebuild)
+    {
+        for (TrackId id = 0; id < table.row_count(); ++id)
+        {
+            if (id >= rows.size() || !(rows[id] == signature(id)))
+            {
+                changed.push_back(id);
+                if (id < rows.size())
+                    modified++;
+            }
+        }
+        rebuild = modified > REBUILD_MIN_ROWS && modified * 4 > rows.size();
+    }
+    if (rebuild)
+    {
+        clear();
+        lineage = table.lineage();
+        changed.clear();
+        for (TrackId id = 0; id < table.row_count(); ++id)
+            changed.push_back(id);
+    }
+
+    rows.resize(table.row_count());
+    row_terms.resize(table.row_count());
+    FieldTerms field_terms;
+    for (TrackId id : changed)
+    {
+        unindex_row(id);
+        rows[id] = signature(id);
+        if (rows[id].alive)
+            index_row(table, id, field_terms);
+    }
+    indexed = tracks;
+
+    if (rebuild)
+    {
+        LOG_DEBUG("search", "Rebuilt search index: %zu tracks, %zu terms", table.size(), term_text.size());
+    }
+}
+
+size_t SearchIndex::term_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return term_text.size();
+}
+
+void SearchIndex::expand(const std::string &word, std::vector<TermMatch> &matches) const
+{
+    auto exact = lookup.find(word);
+    if (exact != lookup.end())
+        matches.push_back({exact->second, 1.0f});
+
+    // Prefixes from two letters on; shorter completions score lower
+    if (word.size() >= 2)
+    {
+        size_t expanded = 0;
+        for (auto it = dictionary.upper_bound(word);
+             it != dictionary.end() && expanded < MAX_PREFIX_TERMS && it->first.compare(0, word.size(), word) == 0;
+             ++it, ++expanded)
+        {
+            matches.push_back({it->second, 0.5f + 0.3f * word.size() / it->first.size()});
+        }
+    }
+
+    if (exact != lookup.end() || word.size() < MIN_FUZZY_LENGTH)
+        return;
+
+    // Typos: words sharing enough trigrams with the query word
+    std::vector<uint32_t> grams;
+    word_trigrams(word, grams);
+    std::unordered_map<uint32_t, uint32_t> shared;
+    for (uint32_t gram : grams)
+    {
+        auto it = trigrams.find(gram);
+        if (it == trigrams.end())
+            continue;
+        for (uint32_t term : it->second)
+            shared[term]++;
+    }
+
+    std::vector<std::pair<float, uint32_t>> close;
+    for (const auto &entry : shared)
+    {
+        float term_grams = static_cast<float>(term_text[entry.first]->size());
+        float similarity = entry.second / (grams.size() + term_grams - entry.second);
+        if (similarity >= MIN_SIMILARITY && term_text[entry.first]->compare(0, word.size(), word) != 0)
+            close.emplace_back(similarity, entry.first);
+    }
+    size_t keep = std::min(close.size(), MAX_FUZZY_TERMS);
+    std::partial_sort(close.begin(), close.begin() + keep, close.end(), std::greater<>());
+    for (size_t i = 0; i < keep; ++i)
+        matches.push_back({close[i].second, 0.6f * close[i].first});
+}
+
+std::vector<SearchHit> SearchIndex::search(std::string_view query, size_t limit) const
+{
+    TRACE_SCOPE("search", "query");
+    std::vector<std::string> words;
+    tokenize(query, words);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    if (words.empty() || limit == 0)
+        return {};
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    // Expand every word; process the most selective first
+    struct WordPlan
+    {
+        std::vector<TermMatch> matches;
+        size_t cost = 0; // Total postings
+    };
+    std::vector<WordPlan> plans(words.size());
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        expand(words[i], plans[i].matches);
+        for (const auto &m : plans[i].matches)
+            plans[i].cost += postings[m.term].size();
+        if (plans[i].cost == 0)
+            return {}; // Every word must match
+    }
+    std::sort(plans.begin(), plans.end(), [](const WordPlan &a, const WordPlan &b)
+              { return a.cost < b.cost; });
+
+    // Every track a word matches, by ID: posting lists are already sorted, so
+    // merge them pairwise rather than sorting their concatenation
+    auto gather = [this](const WordPlan &plan)
+    {
+        std::vector<Hits> lists;
+        lists.reserve(plan.matches.size());
+        for (const auto &m : plan.matches)
+        {
+            Hits hits;
+            hits.reserve(postings[m.term].size());
+            for (const Posting &p : postings[m.term])
+                hits.emplace_back(p.id, m.weight * field_weight(p.fields));
+            lists.push_back(std::move(hits));
+        }
+        while (lists.size() > 1)
+        {
+            std::vector<Hits> merged;
+            for (size_t i = 0; i + 1 < lists.size(); i += 2)
+                merged.push_back(merge_best(lists[i], lists[i + 1]));
+            if (lists.size() % 2)
+                merged.push_back(std::move(lists.back()));
+            lists.swap(merged);
+        }
+        return lists.empty() ? Hits() : std::move(lists[0]);
+    };
+
+    Hits candidates = gather(plans[0]);
+    for (size_t w = 1; w < plans.size() && !candidates.empty(); ++w)
+    {
+        const WordPlan &plan = plans[w];
+        Hits next;
+
+        if (candidates.size() * plan.matches.size() * 16 < plan.cost)
+        {
+            // Few candidates left: probe this word's postings for each
+            for (const auto &candidate : candidates)
+            {
+                float best = 0.0f;
+                for (const auto &m : plan.matches)
+                {
+                    const std::vector<Posting> &list = postings[m.term];
+                    auto it = std::lower_bound(list.begin(), list.end(), candidate.first,
+                                               [](const Posting &p, TrackId v)
+                                               { return p.id < v; });
+                    if (it != list.end() && it->id == candidate.first)
+                        best = std::max(best, m.weight * field_weight(it->fields));
+                }
+                if (best > 0.0f)
+                    next.emplace_back(candidate.first, candidate.second + best);
+            }
+        }
+        else
+        {
+            // Otherwise intersect two sorted lists
+            Hits hits = gather(plan);
+            auto a = candidates.begin();
+            auto b = hits.begin();
+            while (a != candidates.end() && b != hits.end())
+            {
+                if (a->first < b->first)
+                    ++a;
+                else if (b->first < a->first)
+                    ++b;
+                else
+                {
+                    next.emplace_back(a->first, a->second + b->second);
+                    ++a;
+                    ++b;
+                }
+            }
+        }
+        candidates.swap(next);
+    }
+
+    size_t keep = std::min(limit, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+                      [](const auto &a, const auto &b)
+                      { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+
+    std::vector<SearchHit> result;
+    result.reserve(keep);
+    for (size_t i = 0; i < keep; ++i)
+        result.push_back({candidates[i].first, candidates[i].second});
+    return result;
+}
@@ -0,0 +1,168 @@
+#include "shuffle.h"
+#include <algorithm>
+
+namespace
+{
+    // Buffers reused across calls at one grouping level. Keys are string
+    // pool IDs, so groups are found by direct indexing rather than hashing;
+    // a key's entry counts only if its stamp is the current call's.
+    struct Scratch
+    {
+        explicit Scratch(size_t key_count) : group_of_key(key_count), key_stamp(key_count, 0) {}
+
+        std::vector<uint32_t> group_of_key;
+        std::vector<uint32_t> key_stamp;
+        uint32_t stamp = 0;
+        std::vector<uint32_t> item_group;
+        std::vector<uint32_t> ends; // Group ends, then bucket ends
+        std::vector<TrackId> buffer;
+        std::vector<uint32_t> bucket;
+    };
+
+    // Reorders ids[0, n) so that the members of each key's group sit at
+    // evenly spaced positions. inner(first, count) orders a group's members
+    // beforehand. Grouping and placement are both counting sorts: O(n).
+    template <typename Key, typename Inner>
+    void spread(TrackId *ids, size_t n, Key key, Inner inner, std::mt19937_64 &rng, Scratch &s)
+    {
+        if (n < 2)
+            return;
+
+        s.stamp++;
+        s.ends.clear();
+        s.item_group.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint32_t k = key(ids[i]);
+            if (s.key_stamp[k] != s.stamp)
+            {
+                s.key_stamp[k] = s.stamp;
+                s.group_of_key[k] = static_cast<uint32_t>(s.ends.size());
+                s.ends.push_back(0);
+            }
+            s.item_group[i] = s.group_of_key[k];
+            s.ends[s.group_of_key[k]]++;
+        }
+        if (s.ends.size() == 1)
+        {
+            inner(ids, n);
+            return;
+        }
+
+        // Stable scatter into contiguous groups; ends[g] becomes group g's end
+        uint32_t offset = 0;
+        for (auto &end : s.ends)
+        {
+            uint32_t count = end;
+            end = offset;
+            offset += count;
+        }
+        s.buffer.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            s.buffer[s.ends[s.item_group[i]]++] = ids[i];
+
+        // A group of k gets one slot every n/k positions, from a random phase
+        s.bucket.resize(n);
+        size_t begin = 0;
+        for (uint32_t end : s.ends)
+        {
+            size_t count = end - begin;
+            inner(&s.buffer[begin], count);
+            double step = 1.0 / static_cast<double>(count);
+            double phase = std::uniform_real_distribution<double>(0.0, step)(rng);
+            for (size_t j = 0; j < count; ++j)
+            {
+                size_t slot = static_cast<size_t>((phase + static_cast<double>(j) * step) * static_cast<double>(n));
+                s.bucket[begin + j] = static_cast<uint32_t>(std::min(slot, n - 1));
+            }
+            begin = end;
+        }
+
+        s.ends.assign(n, 0);
+        for (size_t i = 0; i < n; ++i)
+            s.ends[s.bucket[i]]++;
+        uint32_t position = 0;
+        for (auto &end : s.ends)
+        {
+            uint32_t count = end;
+            end = position;
+            position += count;
+        }
+        for (size_t i = 0; i < n; ++i)
+            ids[s.ends[s.bucket[i]]++] = s.buffer[i];
+
+        // Tracks landing on the same slot come from different groups
+        begin = 0;
+        for (uint32_t end : s.ends)
+        {
+            if (end - begin > 1)
+                std::shuffle(ids + begin, ids + end, rng);
+            begin = end;
+        }
+    }
+}
+
+void PlayHistory::record(TrackId id)
+{
+    if (capacity == 0 || contains(id))
+        return;
+    if (recent.size() <= id)
+        recent.resize(id + 1, false);
+
+    if (ring.size() < capacity)
+    {
+        ring.push_back(id);
+    }
+    else
+    {
+        recent[ring[oldest]] = false;
+        ring[oldest] = id;
+        oldest = (oldest + 1) % capacity;
+    }
+    recent[id] = true;
+}
+
+void PlayHistory::clear()
+{
+    ring.clear();
+    oldest = 0;
+    recent.clear();
+}
+
+void Shuffler::shuffle(std::vector<TrackId> &ids, const TrackTable &tracks, ShuffleMode mode,
+                       const PlayHistory &history, std::mt19937_64 &rng)
+{
+    // Fresh tracks first; recently played ones are shuffled among themselves
+    auto recent = ids.end();
+    if (history.size() > 0)
+    {
+        recent = std::stable_partition(ids.begin(), ids.end(), [&history](TrackId id)
+                                       { return !history.contains(id); });
+    }
+
+    if (mode == ShuffleMode::RANDOM)
+    {
+        std::shuffle(ids.begin(), recent, rng);
+        std::shuffle(recent, ids.end(), rng);
+        return;
+    }
+
+    Scratch artists(tracks.string_pool().size()), albums(tracks.string_pool().size());
+    auto by_album = [&](TrackId *first, size_t count)
+    {
+        spread(first, count, [&tracks](TrackId id)
+               { return tracks.album_id(id); },
+               [&rng](TrackId *f, size_t c)
+               { std::shuffle(f, f + c, rng); },
+               rng, albums);
+    };
+    auto by_artist = [&](TrackId *first, size_t count)
+    {
+        spread(first, count, [&tracks](TrackId id)
+               { return tracks.artist_id(id); },
+               by_album, rng, artists);
+    };
+    size_t fresh = static_cast<size_t>(recent - ids.begin());
+    by_artist(ids.data(), fresh);
+    by_artist(ids.data() + fresh, ids.size() - fresh);
+}
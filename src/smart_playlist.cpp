@@ -0,0 +1,304 @@
+#include "smart_playlist.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    std::string_view trim(std::string_view s)
+    {
+        size_t start = s.find_first_not_of(" \t\r\n");
+        if (start == std::string_view::npos)
+            return std::string_view();
+        size_t end = s.find_last_not_of(" \t\r\n");
+        return s.substr(start, end - start + 1);
+    }
+
+    std::string lowercase(std::string_view s)
+    {
+        std::string result(s);
+        std::transform(result.begin(), result.end(), result.begin(),
+                       [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        return result;
+    }
+
+    bool starts_with(std::string_view s, std::string_view prefix)
+    {
+        return s.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    bool equals_folded(std::string_view value, const std::string &lowered)
+    {
+        if (value.size() != lowered.size())
+            return false;
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(value[i])) != static_cast<unsigned char>(lowered[i]))
+                return false;
+        }
+        return true;
+    }
+
+    bool contains_folded(std::string_view value, const std::string &lowered)
+    {
+        auto it = std::search(value.begin(), value.end(), lowered.begin(), lowered.end(),
+                              [](char a, char b)
+                              { return std::tolower(static_cast<unsigned char>(a)) == static_cast<unsigned char>(b); });
+        return it != value.end() || lowered.empty();
+    }
+
+    bool parse_number(std::string_view text, int64_t &value)
+    {
+        text = trim(text);
+        bool negative = !text.empty() && text[0] == '-';
+        if (negative)
+            text.remove_prefix(1);
+        if (text.empty() || text.size() > 15 || text.find_first_not_of("0123456789") != std::string_view::npos)
+            return false;
+        value = 0;
+        for (char c : text)
+            value = value * 10 + (c - '0');
+        if (negative)
+            value = -value;
+        return true;
+    }
+}
+
+bool SmartPlaylist::is_smart_playlist(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    return dot != std::string::npos && lowercase(path.substr(dot + 1)) == "smart";
+}
+
+bool SmartPlaylist::load(const std::string &path, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), error);
+}
+
+bool SmartPlaylist::parse(std::string_view text, std::string &error)
+{
+    std::vector<Rule> parsed;
+    bool any = false;
+    size_t line_number = 0;
+
+    while (!text.empty())
+    {
+        size_t newline = text.find('\n');
+        std::string_view line = trim(text.substr(0, newline));
+        text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+        line_number++;
+
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::string lowered = lowercase(line);
+        if (lowered == "match any" || lowered == "match all")
+        {
+            any = lowered == "match any";
+            continue;
+        }
+
+        Rule rule;
+        if (!parse_rule(line, rule, error))
+        {
+            error = "line " + std::to_string(line_number) + ": " + error;
+            return false;
+        }
+        parsed.push_back(std::move(rule));
+    }
+
+    // Integer comparisons are cheaper than string ones; try them first
+    std::stable_partition(parsed.begin(), parsed.end(), [](const Rule &r)
+                          { return is_numeric(r.field); });
+    rules = std::move(parsed);
+    match_any = any;
+    return true;
+}
+
+bool SmartPlaylist::parse_rule(std::string_view line, Rule &rule, std::string &error)
+{
+    static const std::pair<const char *, Field> fields[] = {
+        {"title", Field::TITLE},
+        {"artist", Field::ARTIST},
+        {"album", Field::ALBUM},
+        {"genre", Field::GENRE},
+        {"path", Field::PATH},
+        {"year", Field::YEAR},
+        {"duration", Field::DURATION},
+        {"bitrate", Field::BITRATE},
+        {"bpm", Field::BPM},
+        {"play_count", Field::PLAY_COUNT}};
+
+    size_t space = line.find_first_of(" \t");
+    std::string name = lowercase(line.substr(0, space));
+    std::string_view rest = space == std::string_view::npos ? std::string_view() : trim(line.substr(space));
+
+    auto field = std::find_if(std::begin(fields), std::end(fields), [&name](const auto &f)
+                              { return name == f.first; });
+    if (field == std::end(fields))
+    {
+        error = "unknown field '" + name + "'";
+        return false;
+    }
+    rule.field = field->second;
+
+    if (!is_numeric(rule.field))
+    {
+        std::string_view values;
+        if (starts_with(rest, "in ") || starts_with(rest, "in\t"))
+            values = rest.substr(3);
+        else if (starts_with(rest, "is ") || starts_with(rest, "is\t"))
+            values = rest.substr(3);
+        else if (starts_with(rest, "~"))
+        {
+            rule.contains = true;
+            values = rest.substr(1);
+        }
+        else
+        {
+            error = name + " needs 'in', 'is' or '~'";
+            return false;
+        }
+
+        // "is" and "~" take one value, which may contain commas
+        bool list = starts_with(rest, "in");
+        while (true)
+        {
+            size_t comma = list ? values.find(',') : std::string_view::npos;
+            std::string_view value = trim(values.substr(0, comma));
+            if (!value.empty())
+                rule.values.push_back(lowercase(value));
+            if (comma == std::string_view::npos)
+                break;
+            values = values.substr(comma + 1);
+        }
+        if (rule.values.empty())
+        {
+            error = name + " needs a value";
+            return false;
+        }
+        return true;
+    }
+
+    size_t range = rest.find("..");
+    bool ok = true;
+    if (range != std::string_view::npos)
+    {
+        std::string_view low = trim(rest.substr(0, range));
+        std::string_view high = trim(rest.substr(range + 2));
+        ok = (low.empty() || parse_number(low, rule.min)) && (high.empty() || parse_number(high, rule.max)) &&
+             !(low.empty() && high.empty());
+    }
+    else
+    {
+        int64_t value = 0;
+        if (starts_with(rest, ">=") && (ok = parse_number(rest.substr(2), value)))
+            rule.min = value;
+        else if (starts_with(rest, "<=") && (ok = parse_number(rest.substr(2), value)))
+            rule.max = value;
+        else if (starts_with(rest, ">") && (ok = parse_number(rest.substr(1), value)))
+            rule.min = value + 1;
+        else if (starts_with(rest, "<") && (ok = parse_number(rest.substr(1), value)))
+            rule.max = value - 1;
+        else if (starts_with(rest, "=") && (ok = parse_number(rest.substr(1), value)))
+            rule.min = rule.max = value;
+        else
+            ok = false;
+    }
+    if (!ok)
+    {
+        error = name + " needs a range like 'lo..hi' or a comparison like '>= n'";
+        return false;
+    }
+    return true;
+}
+
+bool SmartPlaylist::uses_play_count() const
+{
+    return std::any_of(rules.begin(), rules.end(), [](const Rule &r)
+                       { return r.field == Field::PLAY_COUNT; });
+}
+
+bool SmartPlaylist::matches_rule(const TrackTable &tracks, TrackId id, const Rule &rule) const
+{
+    if (is_numeric(rule.field))
+    {
+        int64_t value = 0;
+        switch (rule.field)
+        {
+        case Field::YEAR:
+        {
+            // Dates may be "1997" or "1997-05-21"; only the year counts
+            std::string_view year = tracks.year(id);
+            size_t digits = 0;
+            while (digits < year.size() && digits < 4 && std::isdigit(static_cast<unsigned char>(year[digits])))
+                value = value * 10 + (year[digits++] - '0');
+            if (digits == 0)
+                return false;
+            break;
+        }
+        case Field::DURATION:
+            value = tracks.duration_ms(id) / 1000;
+            break;
+        case Field::BITRATE:
+            value = tracks.bitrate(id);
+            break;
+        case Field::BPM:
+            value = tracks.bpm(id);
+            if (value == 0)
+                return false;
+            break;
+        default:
+            value = tracks.play_count(id);
+            break;
+        }
+        return value >= rule.min && value <= rule.max;
+    }
+
+    std::string_view text;
+    switch (rule.field)
+    {
+    case Field::TITLE:
+        text = tracks.title(id);
+        break;
+    case Field::ARTIST:
+        text = tracks.artist(id);
+        break;
+    case Field::ALBUM:
+        text = tracks.album(id);
+        break;
+    case Field::GENRE:
+        text = tracks.genre(id);
+        break;
+    default:
+        text = tracks.path(id);
+        break;
+    }
+    for (const auto &value : rule.values)
+    {
+        if (rule.contains ? contains_folded(text, value) : equals_folded(text, value))
+            return true;
+    }
+    return false;
+}
+
+bool SmartPlaylist::matches(const TrackTable &tracks, TrackId id) const
+{
+    if (!tracks.alive(id))
+        return false;
+    for (const auto &rule : rules)
+    {
+        if (matches_rule(tracks, id, rule) == match_any)
+            return match_any;
+    }
+    return !match_any || rules.empty();
+}
@@ -0,0 +1,540 @@
+#include "sort_index.h"
+#include "trace.h"
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
+namespace
+{
+    // Base letters of U+00C0..U+00FF, upper and lower halves alike. '*'
+    // marks the code points handled separately (Æ, ×/÷, Þ, ß/ÿ).
+    constexpr char LATIN1_BASE[] = "aaaaaa*ceeeeiiiidnooooo*ouuuuy**";
+    // Base letters of U+0100..U+017F (Latin Extended-A)
+    constexpr char LATIN_EXT_A_BASE[] =
+        "aaaaaaccccccccdd"
+        "ddeeeeeeeeeegggg"
+        "gggghhhhiiiiiiii"
+        "iiiijjkkklllllll"
+        "lllnnnnnnnnnoooo"
+        "oooorrrrrrssssss"
+        "ssttttttuuuuuuuu"
+        "uuuuwwyyyzzzzzzs";
+
+    // Next code point of `text` at `i`; bytes that are not valid UTF-8 are
+    // taken as Latin-1, which is what untagged-encoding ID3 text usually is
+    uint32_t next_code_point(std::string_view text, size_t &i)
+    {
+        auto byte = [&text](size_t at)
+        { return static_cast<unsigned char>(text[at]); };
+        unsigned char c = byte(i);
+        size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (length <= 1 || i + length > text.size())
+        {
+            i++;
+            return c;
+        }
+        uint32_t cp = c & (0x7F >> length);
+        for (size_t k = 1; k < length; ++k)
+        {
+            if ((byte(i + k) & 0xC0) != 0x80)
+            {
+                i++;
+                return c;
+            }
+            cp = (cp << 6) | (byte(i + k) & 0x3F);
+        }
+        i += length;
+        return cp;
+    }
+
+    void append_utf8(std::string &out, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool is_separator(uint32_t cp)
+    {
+        return cp == ' ' || cp == '\t' || cp == '\n' || cp == '\r' || cp == 0xA0 || (cp >= 0x2000 && cp <= 0x200A);
+    }
+
+    // Code points that carry no sorting weight: ASCII and Latin-1
+    // punctuation, combining marks, and general punctuation (dashes, quotes)
+    bool is_ignorable(uint32_t cp)
+    {
+        if (cp < 0x80)
+            return !((cp >= '0' && cp <= '9') || (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z'));
+        return (cp >= 0x80 && cp < 0xC0) || (cp >= 0x300 && cp < 0x370) || (cp >= 0x200B && cp < 0x2070);
+    }
+
+    // Folded form of one code point, appended to `out`
+    void fold(uint32_t cp, std::string &out)
+    {
+        if (cp >= 'A' && cp <= 'Z')
+        {
+            out += static_cast<char>(cp + ('a' - 'A'));
+        }
+        else if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp >= 0xC0 && cp <= 0xFF)
+        {
+            char base = LATIN1_BASE[cp & 0x1F];
+            switch (cp)
+            {
+            case 0xC6:
+            case 0xE6:
+                out += "ae";
+                break;
+            case 0xD7:
+            case 0xF7:
+                append_utf8(out, cp);
+                break;
+            case 0xDE:
+            case 0xFE:
+                out += "th";
+                break;
+            case 0xDF:
+                out += "ss";
+                break;
+            case 0xFF:
+                out += 'y';
+                break;
+            default:
+                out += base;
+                break;
+            }
+        }
+        else if (cp >= 0x100 && cp <= 0x17F)
+        {
+            out += LATIN_EXT_A_BASE[cp - 0x100];
+        }
+        else if (cp >= 0x391 && cp <= 0x3A9) // Greek capitals
+        {
+            append_utf8(out, cp + 0x20);
+        }
+        else if (cp == 0x3C2) // Final sigma
+        {
+            append_utf8(out, 0x3C3);
+        }
+        else if (cp >= 0x410 && cp <= 0x42F) // Cyrillic capitals
+        {
+            append_utf8(out, cp + 0x20);
+        }
+        else if (cp >= 0x400 && cp <= 0x40F)
+        {
+            append_utf8(out, cp + 0x50);
+        }
+        else
+        {
+            append_utf8(out, cp);
+        }
+    }
+
+    // Marks that belong to the letter before them, so they are dropped
+    // without ending a word: combining accents and zero-width joiners
+    bool is_mark(uint32_t cp)
+    {
+        return (cp >= 0x300 && cp < 0x370) || (cp >= 0x200B && cp <= 0x200D);
+    }
+
+    bool starts_with(std::string_view s, std::string_view prefix)
+    {
+        return s.compare(0, prefix.size(), prefix) == 0;
+    }
+}
+
+std::string Collation::key(std::string_view text)
+{
+    std::string key;
+    key.reserve(text.size());
+    bool pending_space = false;
+    for (size_t i = 0; i < text.size();)
+    {
+        uint32_t cp = next_code_point(text, i);
+        if (is_separator(cp))
+        {
+            pending_space = !key.empty();
+            continue;
+        }
+        if (is_ignorable(cp))
+            continue;
+        if (pending_space)
+            key += ' ';
+        pending_space = false;
+        fold(cp, key);
+    }
+
+    for (std::string_view article : {"the ", "a ", "an "})
+    {
+        if (starts_with(key, article) && key.size() > article.size())
+        {
+            key.erase(0, article.size());
+            break;
+        }
+    }
+    return key;
+}
+
+void Collation::words(std::string_view text, std::vector<std::string> &words)
+{
+    std::string word;
+    for (size_t i = 0; i < text.size();)
+    {
+        uint32_t cp = next_code_point(text, i);
+        if (is_mark(cp))
+            continue;
+        if (is_separator(cp) || is_ignorable(cp))
+        {
+            if (!word.empty())
+                words.push_back(std::move(word));
+            word.clear();
+            continue;
+        }
+        fold(cp, word);
+    }
+    if (!word.empty())
+        words.push_back(std::move(word));
+}
+
+namespace
+{
+    // A collation key compared as a string, with empty (untagged) values last
+    struct KeyText
+    {
+        std::string_view text;
+
+        bool operator<(const KeyText &o) const
+        {
+            if (text.empty() != o.text.empty())
+                return o.text.empty();
+            return text < o.text;
+        }
+    };
+
+    // Big-endian first bytes of a key, so most comparisons are one integer
+    // compare; 0 for empty keys is lifted above every non-empty prefix
+    uint64_t key_prefix(std::string_view key)
+    {
+        if (key.empty())
+            return UINT64_MAX;
+        uint64_t prefix = 0;
+        for (size_t i = 0; i < 8; ++i)
+            prefix = (prefix << 8) | (i < key.size() ? static_cast<unsigned char>(key[i]) : 0);
+        return std::min<uint64_t>(prefix, UINT64_MAX - 1);
+    }
+}
+
+// Orders two rows by `criteria` (build_sorted() packs the same fields).
+// `key(index)` maps a collation key index to something comparable.
+template <typename Key>
+bool SortIndex::row_less(SortCriteria criteria, TrackId a, TrackId b, Key key) const
+{
+    const RowKeys &x = rows[a];
+    const RowKeys &y = rows[b];
+    switch (criteria)
+    {
+    case SortCriteria::TITLE:
+        return std::make_tuple(key(x.title), key(x.artist), key(x.album), a) <
+               std::make_tuple(key(y.title), key(y.artist), key(y.album), b);
+    case SortCriteria::ARTIST:
+        return std::make_tuple(key(x.artist), key(x.album), x.position, key(x.title), a) <
+               std::make_tuple(key(y.artist), key(y.album), y.position, key(y.title), b);
+    case SortCriteria::ALBUM:
+        return std::make_tuple(key(x.album), key(x.artist), x.position, key(x.title), a) <
+               std::make_tuple(key(y.album), key(y.artist), y.position, key(y.title), b);
+    default:
+        return std::make_tuple(x.duration, key(x.title), a) < std::make_tuple(y.duration, key(y.title), b);
+    }
+}
+
+void SortIndex::clear()
+{
+    rows.clear();
+    keys = StringPool();
+    key_rank.clear();
+    for (size_t c = 0; c < CRITERIA; ++c)
+    {
+        permutations[c].clear();
+        permutation_valid[c] = false;
+    }
+}
+
+void SortIndex::sync(const TrackTable &tracks)
+{
+    if (tracks.lineage() == lineage && tracks.modification_count() == synced_modifications &&
+        rows.size() == tracks.row_count())
+        return;
+    TRACE_SCOPE("sort", "sync");
+
+    // Keys of removed or retagged rows stay in the pool; start over once
+    // they outnumber the live ones
+    if (tracks.lineage() != lineage || keys.size() > 4 * tracks.row_count() + 1024)
+    {
+        clear();
+        lineage = tracks.lineage();
+    }
+
+    // Artists and albums repeat: normalize each distinct string once per sync
+    std::unordered_map<uint32_t, uint32_t> artist_keys, album_keys;
+    auto shared_key = [this](std::unordered_map<uint32_t, uint32_t> &cache, uint32_t source, std::string_view text)
+    {
+        auto it = cache.find(source);
+        if (it == cache.end())
+            it = cache.emplace(source, keys.append(Collation::key(text))).first;
+        return it->second;
+    };
+
+    std::vector<TrackId> changed;
+    size_t previous_keys = keys.size();
+    rows.resize(tracks.row_count());
+    for (TrackId id = 0; id < tracks.row_count(); ++id)
+    {
+        RowKeys &row = rows[id];
+        if (!tracks.alive(id))
+        {
+            if (row.alive)
+                changed.push_back(id);
+            row.alive = false;
+            continue;
+        }
+
+        // Untagged disc and track numbers (0) sort after tagged ones
+        uint32_t disc = static_cast<uint32_t>(tracks.disc(id) - 1) & 0xFFFF;
+        uint32_t track = static_cast<uint32_t>(tracks.track_number(id) - 1) & 0xFFFF;
+        RowKeys next = row;
+        next.alive = true;
+        next.title_source = tracks.title_id(id);
+        next.artist_source = tracks.artist_id(id);
+        next.album_source = tracks.album_id(id);
+        next.duration = tracks.duration_ms(id);
+        next.position = (disc << 16) | track;
+
+        if (!row.alive || row.title_source != next.title_source)
+        {
+            next.title = keys.append(Collation::key(tracks.title(id)));
+        }
+        if (!row.alive || row.artist_source != next.artist_source)
+        {
+            // The scanner's stand-in for a missing artist sorts with the untagged
+            std::string_view text = tracks.artist(id);
+            next.artist = shared_key(artist_keys, next.artist_source, text == "Unknown" ? std::string_view() : text);
+        }
+        if (!row.alive || row.album_source != next.album_source)
+        {
+            next.album = shared_key(album_keys, next.album_source, tracks.album(id));
+        }
+        if (!row.alive || next.title != row.title || next.artist != row.artist || next.album != row.album ||
+            next.duration != row.duration || next.position != row.position)
+        {
+            changed.push_back(id);
+        }
+        row = next;
+    }
+
+    if (keys.size() != previous_keys)
+        key_rank.clear();
+    synced_modifications = tracks.modification_count();
+
+    // A few changed rows are merged into the sorted orders already built;
+    // after larger changes those are rebuilt when next asked for
+    for (size_t c = 0; c < CRITERIA; ++c)
+    {
+        if (!permutation_valid[c] || changed.empty())
+            continue;
+        if (changed.size() * PATCH_MAX_FRACTION > permutations[c].size())
+            permutation_valid[c] = false;
+        else
+            patch(static_cast<SortCriteria>(c), changed);
+    }
+}
+
+void SortIndex::patch(SortCriteria criteria, const std::vector<TrackId> &changed)
+{
+    TRACE_SCOPE("sort", "patch");
+    auto text = [this](uint32_t key)
+    { return KeyText{keys.get(key)}; };
+    auto less = [&](TrackId a, TrackId b)
+    { return row_less(criteria, a, b, text); };
+
+    std::vector<bool> is_changed(rows.size(), false);
+    std::vector<TrackId> moved;
+    for (TrackId id : changed)
+    {
+        is_changed[id] = true;
+        if (rows[id].alive)
+            moved.push_back(id);
+    }
+    std::sort(moved.begin(), moved.end(), less);
+
+    std::vector<TrackId> &permutation = permutations[static_cast<size_t>(criteria)];
+    permutation.erase(std::remove_if(permutation.begin(), permutation.end(), [&is_changed](TrackId id)
+                                     { return is_changed[id]; }),
+                      permutation.end());
+
+    // Binary-search each moved row's place: O(k log n) comparisons, and
+    // the rest of the order is copied across in runs
+    std::vector<TrackId> merged;
+    merged.reserve(permutation.size() + moved.size());
+    auto from = permutation.begin();
+    for (TrackId id : moved)
+    {
+        auto at = std::upper_bound(from, permutation.end(), id, less);
+        merged.insert(merged.end(), from, at);
+        merged.push_back(id);
+        from = at;
+    }
+    merged.insert(merged.end(), from, permutation.end());
+    permutation.swap(merged);
+}
+
+void SortIndex::build_ranks()
+{
+    TRACE_SCOPE("sort", "build_ranks");
+    // One string sort over the keys, mostly settled by an 8-byte prefix;
+    // equal keys share a rank so rows then compare integers
+    struct Entry
+    {
+        uint64_t prefix;
+        uint32_t key;
+    };
+    std::vector<Entry> entries(keys.size());
+    for (uint32_t k = 0; k < keys.size(); ++k)
+        entries[k] = {key_prefix(keys.get(k)), k};
+    std::sort(entries.begin(), entries.end(), [this](const Entry &a, const Entry &b)
+              {
+        if (a.prefix != b.prefix)
+            return a.prefix < b.prefix;
+        return KeyText{keys.get(a.key)} < KeyText{keys.get(b.key)}; });
+
+    key_rank.assign(keys.size(), 0);
+    uint32_t rank = 0;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (i > 0 && (entries[i].prefix != entries[i - 1].prefix ||
+                      keys.get(entries[i].key) != keys.get(entries[i - 1].key)))
+            rank++;
+        key_rank[entries[i].key] = rank;
+    }
+}
+
+void SortIndex::build_sorted(SortCriteria criteria)
+{
+    TRACE_SCOPE("sort", "build_sorted");
+    if (key_rank.size() != keys.size())
+        build_ranks();
+
+    // The fields row_less() compares, packed into two words per row so the
+    // sort runs over contiguous integers
+    struct Entry
+    {
+        uint64_t first, second;
+        TrackId id;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(rows.size());
+    for (TrackId id = 0; id < rows.size(); ++id)
+    {
+        const RowKeys &row = rows[id];
+        if (!row.alive)
+            continue;
+        uint64_t title = key_rank[row.title], artist = key_rank[row.artist], album = key_rank[row.album];
+        switch (criteria)
+        {
+        case SortCriteria::TITLE:
+            entries.push_back({title << 32 | artist, album, id});
+            break;
+        case SortCriteria::ARTIST:
+            entries.push_back({artist << 32 | album, uint64_t(row.position) << 32 | title, id});
+            break;
+        case SortCriteria::ALBUM:
+            entries.push_back({album << 32 | artist, uint64_t(row.position) << 32 | title, id});
+            break;
+        default:
+            entries.push_back({uint64_t(uint32_t(row.duration) ^ 0x80000000u) << 32 | title, 0, id});
+            break;
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+              { return std::tie(a.first, a.second, a.id) < std::tie(b.first, b.second, b.id); });
+
+    std::vector<TrackId> &permutation = permutations[static_cast<size_t>(criteria)];
+    permutation.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+        permutation[i] = entries[i].id;
+    permutation_valid[static_cast<size_t>(criteria)] = true;
+}
+
+const std::vector<TrackId> &SortIndex::sorted(const TrackTable &tracks, SortCriteria criteria)
+{
+    sync(tracks);
+    if (!permutation_valid[static_cast<size_t>(criteria)])
+        build_sorted(criteria);
+    return permutations[static_cast<size_t>(criteria)];
+}
+
+void SortIndex::sort(const TrackTable &tracks, std::vector<TrackId> &ids, SortCriteria criteria)
+{
+    const std::vector<TrackId> &order = sorted(tracks, criteria);
+    TRACE_SCOPE("sort", "sort_ids");
+
+    // How often each row occurs in `ids`; walking the sorted permutation
+    // then emits them in order without comparing anything
+    std::vector<uint32_t> count(rows.size(), 0);
+    for (TrackId id : ids)
+    {
+        if (id < count.size())
+            count[id]++;
+    }
+    std::vector<TrackId> result;
+    result.reserve(ids.size());
+    for (TrackId id : order)
+    {
+        for (; count[id] > 0; --count[id])
+            result.push_back(id);
+    }
+    // Rows that are not live keep their relative order, at the end
+    for (TrackId id : ids)
+    {
+        if (id >= count.size())
+        {
+            result.push_back(id);
+        }
+        else if (count[id] > 0)
+        {
+            result.push_back(id);
+            count[id]--;
+        }
+    }
+    ids.swap(result);
+}
+
+size_t SortIndex::memory_bytes() const
+{
+    size_t bytes = rows.capacity() * sizeof(RowKeys) + keys.memory_bytes() + key_rank.capacity() * sizeof(uint32_t);
+    for (size_t c = 0; c < CRITERIA; ++c)
+        bytes += permutations[c].capacity() * sizeof(TrackId);
+    return bytes;
+}
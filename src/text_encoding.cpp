@@ -0,0 +1,141 @@
+#include "text_encoding.h"
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+    constexpr uint32_t REPLACEMENT = 0xFFFD;
+
+    uint64_t load64(const char *p)
+    {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        return w;
+    }
+
+    void append_code_point(std::string &out, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | cp >> 6);
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | cp >> 12);
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | cp >> 18);
+            out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+}
+
+void TextEncoding::latin1_to_utf8(std::string_view in, std::string &out)
+{
+    out.reserve(out.size() + in.size() + in.size() / 4);
+    const char *p = in.data();
+    const char *end = p + in.size();
+    while (p < end)
+    {
+        // Copy ASCII eight bytes at a time
+        const char *run = p;
+        while (end - p >= 8 && (load64(p) & HIGH_BITS) == 0)
+            p += 8;
+        while (p < end && static_cast<unsigned char>(*p) < 0x80)
+            ++p;
+        out.append(run, p - run);
+
+        // Latin-1 code points are the byte values
+        while (p < end && static_cast<unsigned char>(*p) >= 0x80)
+        {
+            unsigned char c = static_cast<unsigned char>(*p++);
+            out += static_cast<char>(0xC0 | c >> 6);
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+void TextEncoding::utf16_to_utf8(std::string_view in, bool big_endian, std::string &out)
+{
+    out.reserve(out.size() + in.size() / 2 + in.size() / 8);
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(in.data());
+    const unsigned char *end = p + (in.size() & ~static_cast<size_t>(1));
+    auto unit = [big_endian](const unsigned char *q)
+    { return big_endian ? static_cast<uint32_t>(q[0]) << 8 | q[1] : static_cast<uint32_t>(q[1]) << 8 | q[0]; };
+
+    // In each 16-bit unit of an ASCII run only the low seven bits of the
+    // low byte may be set. The mask is built byte-wise so that it matches
+    // the data's byte order whatever the host's.
+    const size_t low = big_endian ? 1 : 0;
+    unsigned char mask_bytes[8];
+    for (size_t i = 0; i < 8; ++i)
+        mask_bytes[i] = (i & 1) == low ? 0x80 : 0xFF;
+    uint64_t non_ascii;
+    memcpy(&non_ascii, mask_bytes, sizeof(non_ascii));
+
+    while (p < end)
+    {
+        // Four ASCII units at a time
+        while (end - p >= 8)
+        {
+            uint64_t w;
+            memcpy(&w, p, sizeof(w));
+            if (w & non_ascii)
+                break;
+            char ascii[4] = {static_cast<char>(p[low]), static_cast<char>(p[low + 2]),
+                             static_cast<char>(p[low + 4]), static_cast<char>(p[low + 6])};
+            out.append(ascii, 4);
+            p += 8;
+        }
+        if (p >= end)
+            break;
+
+        uint32_t cu = unit(p);
+        p += 2;
+        if (cu >= 0xD800 && cu <= 0xDBFF)
+        {
+            uint32_t trail = p < end ? unit(p) : 0;
+            if (trail >= 0xDC00 && trail <= 0xDFFF)
+            {
+                append_code_point(out, 0x10000 + ((cu - 0xD800) << 10) + (trail - 0xDC00));
+                p += 2;
+            }
+            else
+            {
+                append_code_point(out, REPLACEMENT);
+            }
+        }
+        else if (cu >= 0xDC00 && cu <= 0xDFFF)
+        {
+            append_code_point(out, REPLACEMENT);
+        }
+        else
+        {
+            append_code_point(out, cu);
+        }
+    }
+
+    if (in.size() & 1)
+        append_code_point(out, REPLACEMENT);
+}
+
+void TextEncoding::utf16_bom_to_utf8(std::string_view in, std::string &out)
+{
+    if (in.size() >= 2 && static_cast<unsigned char>(in[0]) == 0xFE && static_cast<unsigned char>(in[1]) == 0xFF)
+        utf16_to_utf8(in.substr(2), true, out);
+    else if (in.size() >= 2 && static_cast<unsigned char>(in[0]) == 0xFF && static_cast<unsigned char>(in[1]) == 0xFE)
+        utf16_to_utf8(in.substr(2), false, out);
+    else
+        utf16_to_utf8(in, false, out);
+}
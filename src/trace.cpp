@@ -0,0 +1,252 @@
+#include "trace.h"
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include <signal.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t TRACE_CAPACITY = 8192; // Events per thread ring
+
+    struct TraceEvent
+    {
+        const char *category;
+        const char *name;
+        uint64_t start_ns;
+        uint64_t dur_ns;
+    };
+
+    // A ring slot is a seqlock: `seq` is odd while the owner writes it and
+    // 2 * (index + 1) once event `index` is complete, so a reader can tell a
+    // torn or recycled slot from the event it expected. The fields are
+    // relaxed atomics so the concurrent copy is not a data race.
+    struct TraceSlot
+    {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<const char *> category{nullptr};
+        std::atomic<const char *> name{nullptr};
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> dur_ns{0};
+    };
+
+    // One ring per live thread. Rings of exited threads are recycled so the
+    // per-request HTTP threads do not grow the registry without bound.
+    struct ThreadBuffer
+    {
+        std::unique_ptr<TraceSlot[]> events;
+        std::atomic<uint64_t> head{0};
+        std::atomic<bool> in_use{true};
+        uint32_t tid = 0;
+        std::string name;
+    };
+
+    std::atomic<bool> g_trace_enabled(false);
+    std::mutex g_registry_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> g_registry;
+
+    const std::chrono::steady_clock::time_point g_trace_epoch = std::chrono::steady_clock::now();
+
+    struct ThreadSlot
+    {
+        ThreadBuffer *buffer = nullptr;
+        std::string pending_name;
+
+        ~ThreadSlot()
+        {
+            if (buffer)
+            {
+                buffer->in_use.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    thread_local ThreadSlot t_slot;
+
+    ThreadBuffer *acquire_buffer()
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+
+        ThreadBuffer *buffer = nullptr;
+        for (auto &candidate : g_registry)
+        {
+            if (!candidate->in_use.load(std::memory_order_acquire))
+            {
+                buffer = candidate.get();
+                buffer->in_use.store(true, std::memory_order_release);
+                // Start a fresh timeline; the previous owner's events would
+                // otherwise appear under this thread's name. Dumps hold the
+                // registry lock, so none is reading the ring meanwhile.
+                buffer->head.store(0, std::memory_order_release);
+                break;
+            }
+        }
+
+        if (!buffer)
+        {
+            g_registry.push_back(std::make_unique<ThreadBuffer>());
+            buffer = g_registry.back().get();
+            buffer->events.reset(new TraceSlot[TRACE_CAPACITY]);
+            buffer->tid = static_cast<uint32_t>(g_registry.size());
+        }
+
+        buffer->name = t_slot.pending_name.empty() ? "thread-" + std::to_string(buffer->tid) : t_slot.pending_name;
+        return buffer;
+    }
+
+    std::atomic<bool> g_dump_requested(false);
+
+    void dump_signal_handler(int)
+    {
+        g_dump_requested.store(true);
+    }
+
+    void append_json_string(std::ostream &out, const std::string &str)
+    {
+        out << '"';
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << ' ';
+            else
+                out << c;
+        }
+        out << '"';
+    }
+}
+
+void Tracer::set_enabled(bool enable)
+{
+    g_trace_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Tracer::is_enabled()
+{
+    return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::set_thread_name(const char *name)
+{
+    t_slot.pending_name = name;
+    if (t_slot.buffer)
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        t_slot.buffer->name = name;
+    }
+}
+
+uint64_t Tracer::now_ns()
+{
+    // +1 so a valid timestamp is never 0 (TraceScope uses 0 as "not started")
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - g_trace_epoch)
+                                     .count()) +
+           1;
+}
+
+void Tracer::record(const char *category, const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+    if (!t_slot.buffer)
+    {
+        t_slot.buffer = acquire_buffer();
+    }
+
+    ThreadBuffer *buffer = t_slot.buffer;
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    TraceSlot &slot = buffer->events[index % TRACE_CAPACITY];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.dur_ns.store(end_ns > start_ns ? end_ns - start_ns : 0, std::memory_order_relaxed);
+    slot.seq.store(2 * (index + 1), std::memory_order_release);
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+std::string Tracer::dump_chrome_json()
+{
+    std::stringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    const int pid = static_cast<int>(getpid());
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    for (const auto &buffer : g_registry)
+    {
+        // Copy the ring without stopping the writer; a slot the writer is
+        // rewriting, or has already reused for a newer event, is dropped
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+        std::vector<TraceEvent> events;
+        events.reserve(head - begin);
+        for (uint64_t i = begin; i < head; ++i)
+        {
+            const TraceSlot &slot = buffer->events[i % TRACE_CAPACITY];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            TraceEvent event{slot.category.load(std::memory_order_relaxed), slot.name.load(std::memory_order_relaxed),
+                             slot.start_ns.load(std::memory_order_relaxed), slot.dur_ns.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq == 2 * (i + 1) && slot.seq.load(std::memory_order_relaxed) == seq)
+                events.push_back(event);
+        }
+
+        json << (first ? "" : ",");
+        first = false;
+        json << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+             << ",\"args\":{\"name\":";
+        append_json_string(json, buffer->name);
+        json << "}}";
+
+        for (const TraceEvent &e : events)
+        {
+            json << ",{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\""
+                 << ",\"ts\":" << (e.start_ns / 1000.0) << ",\"dur\":" << (e.dur_ns / 1000.0)
+                 << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid << "}";
+        }
+    }
+
+    json << "]}";
+    return json.str();
+}
+
+bool Tracer::dump_to_file(const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        LOG_ERROR("trace", "Failed to write trace file: %s", path.c_str());
+        return false;
+    }
+    out << dump_chrome_json();
+    return true;
+}
+
+void Tracer::install_dump_signal(int signum, const std::string &path)
+{
+    signal(signum, dump_signal_handler);
+
+    std::thread([path]()
+                {
+        Tracer::set_thread_name("trace-dump");
+        while (true) {
+            if (g_dump_requested.exchange(false)) {
+                if (Tracer::dump_to_file(path)) {
+                    LOG_INFO("trace", "Trace written to %s", path.c_str());
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        } })
+        .detach();
+}
@@ -0,0 +1,298 @@
+#include "track_table.h"
+#include "playlist_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+namespace
+{
+    constexpr size_t COMPACT_MIN_DEAD_BYTES = 64 * 1024;
+
+    size_t hash_string(std::string_view value)
+    {
+        return std::hash<std::string_view>()(value);
+    }
+
+    std::string_view file_name(std::string_view path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string_view::npos ? path : path.substr(slash + 1);
+    }
+}
+
+StringPool::StringPool()
+{
+    count = 1; // ID 0: "", never stored
+}
+
+uint32_t StringPool::intern(std::string_view value)
+{
+    if (value.empty())
+        return EMPTY;
+
+    size_t hash = hash_string(value);
+    auto range = interned.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (get(it->second) == value)
+            return it->second;
+    }
+
+    uint32_t id = append(value);
+    interned.emplace(hash, id);
+    return id;
+}
+
+uint32_t StringPool::append(std::string_view value)
+{
+    if (value.empty())
+        return EMPTY;
+
+    value = value.substr(0, BLOCK_SIZE);
+    if (block_used + value.size() > BLOCK_SIZE)
+    {
+        blocks.push_back(std::make_shared<Block>());
+        block_used = 0;
+    }
+    if (count / SPAN_CHUNK >= spans.size())
+    {
+        spans.push_back(std::make_shared<SpanChunk>());
+    }
+
+    // Only bytes and spans past what earlier snapshots can see are written
+    std::copy(value.begin(), value.end(), blocks.back()->bytes + block_used);
+    uint32_t id = static_cast<uint32_t>(count++);
+    spans[id / SPAN_CHUNK]->items[id % SPAN_CHUNK] = {
+        static_cast<uint32_t>((blocks.size() - 1) * BLOCK_SIZE + block_used),
+        static_cast<uint32_t>(value.size())};
+    block_used += value.size();
+    bytes_used += value.size();
+    return id;
+}
+
+StringPool StringPool::snapshot() const
+{
+    StringPool copy;
+    copy.blocks = blocks;
+    copy.spans = spans;
+    copy.count = count;
+    copy.block_used = block_used;
+    copy.bytes_used = bytes_used;
+    return copy;
+}
+
+size_t StringPool::memory_bytes() const
+{
+    // Hash nodes are roughly two pointers plus the key and value
+    return blocks.size() * sizeof(Block) + spans.size() * sizeof(SpanChunk) +
+           interned.size() * (sizeof(void *) * 2 + sizeof(size_t) + sizeof(uint32_t)) +
+           interned.bucket_count() * sizeof(void *);
+}
+
+uint64_t TrackTable::next_lineage()
+{
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+TrackTable::Segment &TrackTable::writable(TrackId id)
+{
+    std::shared_ptr<Segment> &segment = segments[id / SEGMENT_ROWS];
+    if (segment->generation != generation)
+    {
+        // Shared with a snapshot: copy before writing
+        segment = std::make_shared<Segment>(*segment);
+        segment->generation = generation;
+    }
+    return *segment;
+}
+
+TrackId TrackTable::add(const Track &track)
+{
+    TrackId id = static_cast<TrackId>(rows);
+    if (rows % SEGMENT_ROWS == 0)
+    {
+        segments.push_back(std::make_shared<Segment>());
+        segments.back()->generation = generation;
+    }
+    rows++;
+
+    Segment &segment = writable(id);
+    segment.path[slot(id)] = strings.append(track.filepath);
+    segment.plays[slot(id)] = track.play_count;
+    set_metadata(id, track);
+    by_path.emplace(hash_string(track.filepath), id);
+    live_rows++;
+    modifications++;
+    return id;
+}
+
+void TrackTable::update(TrackId id, const Track &track)
+{
+    if (!alive(id))
+        return;
+    dead_string_bytes += strings.get(row(id).title[slot(id)]).size();
+    set_metadata(id, track);
+    modifications++;
+}
+
+void TrackTable::set_metadata(TrackId id, const Track &track)
+{
+    Segment &segment = writable(id);
+    size_t i = slot(id);
+
+    // A title equal to the file name (placeholders, untagged files) is not stored
+    std::string_view title = track.title;
+    segment.title[i] = title == file_name(strings.get(segment.path[i])) ? StringPool::EMPTY : strings.append(title);
+    segment.artist[i] = strings.intern(track.artist);
+    segment.album[i] = strings.intern(track.album);
+    segment.year[i] = strings.intern(track.year);
+    segment.genre[i] = strings.intern(track.genre);
+    segment.duration[i] = track.duration_ms;
+    segment.bitrate[i] = track.bitrate;
+    segment.bpm[i] = static_cast<uint16_t>(std::clamp(track.bpm, 0, 65535));
+    segment.disc[i] = static_cast<uint16_t>(std::clamp(track.disc, 0, 65535));
+    segment.track_number[i] = static_cast<uint16_t>(std::clamp(track.track_number, 0, 65535));
+    segment.size[i] = track.file_size;
+    segment.mtime[i] = track.mtime_ns;
+    segment.art_offset[i] = track.art_offset;
+    segment.art_length[i] = track.art_length;
+    segment.flags[i] = ALIVE | (track.metadata_pending ? METADATA_PENDING : 0);
+}
+
+void TrackTable::remove(TrackId id)
+{
+    if (!alive(id))
+        return;
+
+    auto range = by_path.equal_range(hash_string(path(id)));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == id)
+        {
+            by_path.erase(it);
+            break;
+        }
+    }
+
+    dead_string_bytes += path(id).size() + strings.get(row(id).title[slot(id)]).size();
+    writable(id).flags[slot(id)] = 0;
+    live_rows--;
+    modifications++;
+}
+
+void TrackTable::add_play(TrackId id)
+{
+    if (alive(id))
+        writable(id).plays[slot(id)]++;
+}
+
+void TrackTable::clear()
+{
+    *this = TrackTable();
+}
+
+bool TrackTable::needs_compaction() const
+{
+    return dead_string_bytes > COMPACT_MIN_DEAD_BYTES && dead_string_bytes * 2 > strings.data_bytes();
+}
+
+void TrackTable::compact()
+{
+    StringPool fresh;
+    for (TrackId id = 0; id < rows; ++id)
+    {
+        Segment &segment = writable(id);
+        size_t i = slot(id);
+        uint32_t *columns[] = {segment.path, segment.title, segment.artist, segment.album, segment.year, segment.genre};
+
+        for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); ++c)
+        {
+            uint32_t &value = columns[c][i];
+            if (!(segment.flags[i] & ALIVE))
+                value = StringPool::EMPTY;
+            else if (c < 2) // Paths and titles are unique
+                value = fresh.append(strings.get(value));
+            else
+                value = fresh.intern(strings.get(value));
+        }
+    }
+
+    strings = std::move(fresh);
+    dead_string_bytes = 0;
+    modifications++;
+    lineage_id = next_lineage();
+}
+
+TrackTable TrackTable::snapshot()
+{
+    TrackTable copy;
+    copy.strings = strings.snapshot();
+    copy.segments = segments;
+    copy.rows = rows;
+    copy.live_rows = live_rows;
+    copy.dead_string_bytes = dead_string_bytes;
+    copy.lineage_id = lineage_id;
+    copy.modifications = modifications;
+    // Segments written so far are now shared; the next write copies them
+    generation++;
+    copy.generation = generation;
+    return copy;
+}
+
+std::optional<TrackId> TrackTable::find(std::string_view filepath) const
+{
+    auto range = by_path.equal_range(hash_string(filepath));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (path(it->second) == filepath)
+            return it->second;
+    }
+    return std::nullopt;
+}
+
+std::string_view TrackTable::title(TrackId id) const
+{
+    uint32_t title_id = row(id).title[slot(id)];
+    return title_id == StringPool::EMPTY ? file_name(path(id)) : strings.get(title_id);
+}
+
+size_t TrackTable::count_metadata_pending() const
+{
+    size_t count = 0;
+    for (TrackId id = 0; id < rows; ++id)
+    {
+        if ((row(id).flags[slot(id)] & (ALIVE | METADATA_PENDING)) == (ALIVE | METADATA_PENDING))
+            count++;
+    }
+    return count;
+}
+
+Track TrackTable::get(TrackId id) const
+{
+    Track track{std::string(path(id))};
+    track.title = std::string(title(id));
+    track.artist = std::string(artist(id));
+    track.album = std::string(album(id));
+    track.year = std::string(year(id));
+    track.genre = std::string(genre(id));
+    track.duration_ms = duration_ms(id);
+    track.bitrate = bitrate(id);
+    track.bpm = bpm(id);
+    track.disc = disc(id);
+    track.track_number = track_number(id);
+    track.play_count = play_count(id);
+    track.file_size = file_size(id);
+    track.mtime_ns = mtime_ns(id);
+    track.art_offset = art_offset(id);
+    track.art_length = art_length(id);
+    track.metadata_pending = metadata_pending(id);
+    return track;
+}
+
+size_t TrackTable::memory_bytes() const
+{
+    size_t lookup = by_path.size() * (sizeof(void *) * 2 + sizeof(size_t) + sizeof(TrackId)) +
+                    by_path.bucket_count() * sizeof(void *);
+    return segments.size() * sizeof(Segment) + lookup + strings.memory_bytes();
+}
@@ -1,5 +1,6 @@
 #include "tui_interface.h"
 #include <iomanip>
+#include <algorithm>
 
 TUIInterface::TUIInterface(Config &cfg,
                            std::shared_ptr<AudioEngine> audio,
@@ -18,6 +19,7 @@ void TUIInterface::run()
 {
     clear_screen();
     print_header();
+    preload_next_track();
 
     while (running)
     {
@@ -33,6 +35,7 @@ void TUIInterface::background_process()
     if(this->audio_engine->is_active()){
         // Check for auto-advance if track has ended
         if (audio_engine->has_track_ended() && playlist_mgr->is_auto_advance_enabled()) {
+            playlist_mgr->record_play();
             playlist_mgr->next();
             load_current_track();
             audio_engine->reset_track_ended();
@@ -79,10 +82,12 @@ void TUIInterface::update_display()
     std::cout << "Theme: " << config.get_theme_string() << "          \n";
     std::cout << "\n";
 
-    Track *current = playlist_mgr->get_current_track();
+    // One snapshot per frame keeps the title and position consistent
+    std::shared_ptr<const PlaylistSnapshot> playlist = playlist_mgr->snapshot();
+    std::optional<Track> current = playlist->current_track();
     if (current)
     {
-        std::cout << "Now Playing: " << current->title << "          \n";
+        std::cout << "Now Playing: " << current->title << (playlist->playing_queued ? " (queued)" : "") << "          \n";
     }
     else
     {
@@ -90,9 +95,17 @@ void TUIInterface::update_display()
     }
 
     std::cout << "\n";
-    std::cout << "Playlist: " << (playlist_mgr->get_current_index() + 1)
-              << " / " << playlist_mgr->get_track_count() << "          \n";
-    std::cout << "\n";
+    std::cout << "Playlist: " << (playlist->current_index + 1)
+              << " / " << playlist->size() << (playlist->shuffled ? " (shuffled)" : "") << "          \n";
+    if (!playlist->queue->empty())
+    {
+        std::cout << "Queue: " << playlist->queue->size() << " tracks, next "
+                  << playlist->tracks->title(playlist->queue->front().id) << "          \n";
+    }
+    else
+    {
+        std::cout << std::string(64, ' ') << "\n";
+    }
 
     // Audio levels
     FFTData fft = audio_engine->get_fft_data();
@@ -130,11 +143,11 @@ void TUIInterface::print_controls()
     {
         std::cout << "║   [Space] Play/Pause    [N] Next    [P] Previous               ║\n";
         std::cout << "║   [S] Shuffle           [L] List    [T] Theme                  ║\n";
-        std::cout << "║   [M] Mute                                                    ║\n";
+        std::cout << "║   [M] Mute              [/] Search  [C] Queue                  ║\n";
 
         if (config.mode == PlaybackMode::DJ)
         {
-            std::cout << "║   [N] Cue Next          [C] Queue                              ║\n";
+            std::cout << "║   Search: [C]+number queues, [X]+number cues next              ║\n";
         }
     }
 
@@ -202,9 +215,16 @@ void TUIInterface::handle_input()
             break;
 
         case 's':
-        case 'S': // Shuffle
-            playlist_mgr->shuffle();
-            load_current_track();
+        case 'S': // Shuffle on/off; the current track keeps playing
+            if (playlist_mgr->snapshot()->shuffled)
+            {
+                playlist_mgr->unshuffle();
+            }
+            else
+            {
+                playlist_mgr->shuffle();
+            }
+            preload_next_track(); // The track after this one has changed
             break;
 
         case 'l':
@@ -219,6 +239,21 @@ void TUIInterface::handle_input()
             }
             break;
 
+        case 'c':
+        case 'C': // Show and edit the play queue
+            if (config.mode != PlaybackMode::CODER)
+            {
+                show_queue();
+            }
+            break;
+
+        case '/': // Search the library
+            if (config.mode != PlaybackMode::CODER)
+            {
+                search_prompt();
+            }
+            break;
+
         case 't':
         case 'T': // Change theme
             cycle_theme();
@@ -266,11 +301,79 @@ void TUIInterface::handle_input()
 
 void TUIInterface::load_current_track()
 {
-    Track *track = playlist_mgr->get_current_track();
+    std::optional<Track> track = playlist_mgr->get_current_track();
     if (track)
     {
         audio_engine->load_track(track->filepath);
     }
+    preload_next_track();
+}
+
+void TUIInterface::preload_next_track()
+{
+    // Whatever plays next (queue head or playlist) is opened and its start
+    // decoded on the decoder thread, so the switch happens without touching
+    // the disk
+    std::optional<Track> next = playlist_mgr->get_next_track();
+    if (next && config.mode != PlaybackMode::CODER)
+    {
+        audio_engine->preload_track(next->filepath);
+    }
+}
+
+void TUIInterface::show_queue()
+{
+    clear_screen();
+    std::cout << "╔════════════════════════════════════════════════════════════════╗\n";
+    std::cout << "║                         PLAY QUEUE                             ║\n";
+    std::cout << "╚════════════════════════════════════════════════════════════════╝\n\n";
+
+    static const char *const priority_names[] = {"cued", "", "filler"};
+    std::shared_ptr<const PlaylistSnapshot> playlist = playlist_mgr->snapshot();
+    const std::vector<QueueEntry> &queue = *playlist->queue;
+    size_t shown = std::min<size_t>(queue.size(), 9);
+    if (queue.empty())
+    {
+        std::cout << "   Queue is empty; press C then a number in search to queue\n";
+    }
+    for (size_t i = 0; i < shown; ++i)
+    {
+        const char *priority = priority_names[static_cast<size_t>(queue[i].priority)];
+        std::cout << "   " << (i + 1) << ". " << playlist->tracks->title(queue[i].id);
+        if (*priority)
+        {
+            std::cout << " [" << priority << "]";
+        }
+        std::cout << "\n";
+    }
+    if (queue.size() > shown)
+    {
+        std::cout << "\n   ... and " << (queue.size() - shown) << " more tracks\n";
+    }
+
+    std::cout << "\n[1-9] Remove  [U]+number Move to top  [X] Clear  any other key to return...\n";
+
+    char c;
+    read(STDIN_FILENO, &c, 1);
+    if (c >= '1' && static_cast<size_t>(c - '1') < shown)
+    {
+        playlist_mgr->remove_queued(c - '1');
+    }
+    else if (c == 'u' || c == 'U')
+    {
+        read(STDIN_FILENO, &c, 1);
+        if (c >= '1' && static_cast<size_t>(c - '1') < shown)
+        {
+            playlist_mgr->move_queued(c - '1', 0);
+        }
+    }
+    else if (c == 'x' || c == 'X')
+    {
+        playlist_mgr->clear_queue();
+    }
+    preload_next_track();
+    clear_screen();
+    print_header();
 }
 
 void TUIInterface::show_track_list()
@@ -280,10 +383,13 @@ void TUIInterface::show_track_list()
     std::cout << "║                        TRACK LIST                              ║\n";
     std::cout << "╚════════════════════════════════════════════════════════════════╝\n\n";
 
-    auto tracks = playlist_mgr->get_all_tracks();
-    size_t current_idx = playlist_mgr->get_current_index();
+    // Only the visible rows are materialized
+    std::shared_ptr<const PlaylistSnapshot> playlist = playlist_mgr->snapshot();
+    size_t total = playlist->size();
+    size_t shown = std::min<size_t>(total, 20);
+    size_t current_idx = playlist->current_index;
 
-    for (size_t i = 0; i < tracks.size() && i < 20; ++i)
+    for (size_t i = 0; i < shown; ++i)
     {
         if (i == current_idx)
         {
@@ -293,12 +399,12 @@ void TUIInterface::show_track_list()
         {
             std::cout << "   ";
         }
-        std::cout << std::setw(3) << (i + 1) << ". " << tracks[i].title << "\n";
+        std::cout << std::setw(3) << (i + 1) << ". " << playlist->tracks->title((*playlist->order)[i]) << "\n";
     }
 
-    if (tracks.size() > 20)
+    if (total > shown)
     {
-        std::cout << "\n   ... and " << (tracks.size() - 20) << " more tracks\n";
+        std::cout << "\n   ... and " << (total - shown) << " more tracks\n";
     }
 
     std::cout << "\nPress any key to return...\n";
@@ -309,6 +415,78 @@ void TUIInterface::show_track_list()
     print_header();
 }
 
+void TUIInterface::search_prompt()
+{
+    clear_screen();
+    std::cout << "╔════════════════════════════════════════════════════════════════╗\n";
+    std::cout << "║                          SEARCH                                ║\n";
+    std::cout << "╚════════════════════════════════════════════════════════════════╝\n\n";
+
+    // Line-buffered input with echo for typing the query
+    restore_terminal();
+    std::cout << "Search: " << std::flush;
+    std::string query;
+    std::getline(std::cin, query);
+    setup_terminal();
+
+    std::vector<SearchHit> hits = playlist_mgr->search(query, 9);
+    std::shared_ptr<const PlaylistSnapshot> playlist = playlist_mgr->snapshot();
+    std::cout << "\n";
+    if (hits.empty())
+    {
+        std::cout << "   No matches\n";
+    }
+    for (size_t i = 0; i < hits.size(); ++i)
+    {
+        TrackId id = hits[i].id;
+        if (!playlist->tracks->alive(id))
+        {
+            continue;
+        }
+        std::cout << "   " << (i + 1) << ". " << playlist->tracks->title(id);
+        if (!playlist->tracks->artist(id).empty())
+        {
+            std::cout << " - " << playlist->tracks->artist(id);
+        }
+        std::cout << "\n";
+    }
+
+    if (hits.empty())
+    {
+        std::cout << "\nPress any key to return...\n";
+    }
+    else
+    {
+        std::cout << "\nPress 1-" << hits.size() << " to play, C or X then a number to queue or cue next,\n"
+                  << "any other key to return...\n";
+    }
+
+    char c;
+    read(STDIN_FILENO, &c, 1);
+    if (c >= '1' && static_cast<size_t>(c - '1') < hits.size())
+    {
+        if (playlist_mgr->jump_to_track(hits[c - '1'].id))
+        {
+            load_current_track();
+        }
+    }
+    else if (c == 'c' || c == 'C' || c == 'x' || c == 'X')
+    {
+        bool cue = (c == 'x' || c == 'X');
+        read(STDIN_FILENO, &c, 1);
+        if (c >= '1' && static_cast<size_t>(c - '1') < hits.size())
+        {
+            TrackId id = hits[c - '1'].id;
+            if (cue ? playlist_mgr->play_next(id) : playlist_mgr->enqueue(id))
+            {
+                preload_next_track();
+            }
+        }
+    }
+    clear_screen();
+    print_header();
+}
+
 void TUIInterface::cycle_theme()
 {
     int theme_val = static_cast<int>(config.theme);
@@ -0,0 +1,29 @@
+// check.h - Assertions for the unit tests that count failures and go on
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+inline int check_failures = 0;
+
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            check_failures++;                                                             \
+        }                                                                                 \
+    } while (0)
+
+// Exit status for main(): 0 if every check passed
+inline int check_result(const char *test)
+{
+    if (check_failures == 0)
+        printf("%s: all checks passed\n", test);
+    else
+        fprintf(stderr, "%s: %d checks failed\n", test, check_failures);
+    return check_failures == 0 ? 0 : 1;
+}
+
+#endif // CHECK_H
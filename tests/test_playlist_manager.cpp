@@ -0,0 +1,120 @@
+// test_playlist_manager.cpp - Playlist files versus library rescans
+//
+// A rescan (what the watcher runs after an inotify overflow) must leave a
+// playlist file that replaced the library alone, whether the playlist is
+// loaded before the rescan or while it is pending. Concurrent loads during
+// the background library load must each end cleanly.
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "playlist_manager.h"
+#include "check.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    void write_file(const fs::path &path, const std::string &contents)
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    // The constructor returns with the first batch; a rescan belongs after
+    // the whole library, as the watcher only starts then
+    bool wait_for_library(PlaylistManager &manager, size_t count)
+    {
+        for (int i = 0; i < 500 && manager.get_track_count() < count; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return manager.get_track_count() == count;
+    }
+
+    // Only the playlist's entries, and all of them
+    bool holds_playlist(PlaylistManager &manager, const std::set<std::string> &entries)
+    {
+        auto snapshot = manager.snapshot();
+        if (snapshot->size() != entries.size())
+            return false;
+        for (size_t i = 0; i < snapshot->size(); ++i)
+        {
+            if (!entries.count(snapshot->track_at(i)->filepath))
+                return false;
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    fs::path root = fs::temp_directory_path() / ("harmonic_test_playlist_" + std::to_string(getpid()));
+    fs::path music = root / "music";
+    fs::create_directories(music / "album");
+    for (int i = 0; i < 500; ++i)
+        write_file(music / "album" / ("track" + std::to_string(i) + ".mp3"), "not really audio");
+
+    std::set<std::string> entries;
+    std::string m3u = "#EXTM3U\n";
+    for (int i = 0; i < 3; ++i)
+    {
+        fs::path track = root / ("listed" + std::to_string(i) + ".mp3");
+        write_file(track, "not really audio");
+        entries.insert(track.string());
+        m3u += "#EXTINF:60,Artist - Listed " + std::to_string(i) + "\n" + track.string() + "\n";
+    }
+    fs::path playlist = root / "list.m3u";
+    write_file(playlist, m3u);
+
+    Config config;
+    config.music_directory = music.string();
+    config.library_index_file = "";
+    config.watch_library = false;
+    config.lazy_metadata = false;
+
+    // Loaded first: the rescan does nothing
+    {
+        PlaylistManager manager(config);
+        CHECK(wait_for_library(manager, 500));
+        CHECK(manager.load_playlist_file(playlist.string()));
+        manager.rescan_library();
+        CHECK(holds_playlist(manager, entries));
+    }
+
+    // Loaded while the rescan is pending or running: whichever wins, the
+    // playlist is what remains
+    for (int round = 0; round < 20; ++round)
+    {
+        PlaylistManager manager(config);
+        CHECK(wait_for_library(manager, 500));
+        std::thread rescan([&manager]() { manager.rescan_library(); });
+        std::this_thread::sleep_for(std::chrono::microseconds(round * 100));
+        CHECK(manager.load_playlist_file(playlist.string()));
+        rescan.join();
+        CHECK(holds_playlist(manager, entries));
+        manager.rescan_library();
+        CHECK(holds_playlist(manager, entries));
+    }
+
+    // Loaded from several threads while the library still loads in the
+    // background: the load is abandoned and joined exactly once
+    config.lazy_metadata = true;
+    for (int round = 0; round < 5; ++round)
+    {
+        PlaylistManager manager(config);
+        std::vector<std::thread> loaders;
+        for (int i = 0; i < 4; ++i)
+            loaders.emplace_back([&]() { CHECK(manager.load_playlist_file(playlist.string())); });
+        for (auto &loader : loaders)
+            loader.join();
+        CHECK(holds_playlist(manager, entries));
+    }
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return check_result("test_playlist_manager");
+}
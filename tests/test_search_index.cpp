@@ -0,0 +1,69 @@
+// test_search_index.cpp - Case and accent folding of search terms
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "playlist_manager.h" // Track
+#include "search_index.h"
+#include "check.h"
+
+namespace
+{
+    std::shared_ptr<const TrackTable> library()
+    {
+        auto table = std::make_shared<TrackTable>();
+        auto add = [&table](const std::string &path, const std::string &title, const std::string &artist)
+        {
+            Track track(path);
+            track.title = title;
+            track.artist = artist;
+            table->add(track);
+        };
+        add("/music/0.mp3", "Hyperballad", "Björk");              // Precomposed ö
+        add("/music/1.mp3", "Hoppípolla", "Sigur Ro\xCC\x81s");   // o + combining acute
+        add("/music/2.mp3", "Army of Me", "BJÖRK");
+        add("/music/3.mp3", "Bachelorette", "Bjork Tribute Band");
+        return table;
+    }
+
+    std::vector<TrackId> hits(const SearchIndex &index, const std::string &query)
+    {
+        std::vector<TrackId> ids;
+        for (const SearchHit &hit : index.search(query, 10))
+            ids.push_back(hit.id);
+        return ids;
+    }
+
+    bool same_set(std::vector<TrackId> a, std::vector<TrackId> b)
+    {
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        return a == b;
+    }
+}
+
+int main()
+{
+    SearchIndex index;
+    index.sync(library());
+
+    // Every spelling of the accented artist finds all three
+    const std::vector<TrackId> bjork = {0, 2, 3};
+    CHECK(same_set(hits(index, "bjork"), bjork));
+    CHECK(same_set(hits(index, "BJÖRK"), bjork));
+    CHECK(same_set(hits(index, "Björk"), bjork));
+    CHECK(same_set(hits(index, "bjo\xCC\x88rk"), bjork));
+    CHECK(same_set(hits(index, "bjö"), bjork));
+
+    // A combining accent does not split the word it belongs to
+    CHECK(same_set(hits(index, "ros"), {1}));
+    CHECK(same_set(hits(index, "sigur rós"), {1}));
+    CHECK(same_set(hits(index, "hoppipolla"), {1}));
+
+    std::vector<std::string> words;
+    SearchIndex::tokenize("Motörhead - Ace of Spades (Live)", words);
+    CHECK((words == std::vector<std::string>{"motorhead", "ace", "of", "spades", "live"}));
+
+    return check_result("test_search_index");
+}
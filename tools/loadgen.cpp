@@ -0,0 +1,935 @@
+// loadgen.cpp - Synthetic listener load generator for NetworkServer
+//
+// Opens N concurrent /stream listeners, /api/fft pollers and /ws/fft WebSocket
+// clients against a running instance, validates the audio framing each
+// listener receives and reports throughput, time-to-first-byte, stalls and
+// (optionally) server-side CPU usage.
+//
+//   harmonic_loadgen --port 8080 --streams 50 --fft 20 --ws 10 --duration 30
+//                    --server-pid $(pidof MusicStreamPlatform) --json
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions
+{
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int ws_port = 0; // 0 = port + 1, matching NetworkServer::start_websocket_server
+    int streams = 10;
+    int fft_clients = 5;
+    int ws_clients = 0;
+    int duration_s = 10;
+    int stall_ms = 250;
+    int fft_interval_ms = 50; // Same polling rate as templates/index.html
+    int server_pid = 0;
+    bool json = false;
+};
+
+enum class ClientKind
+{
+    STREAM,
+    FFT,
+    WEBSOCKET
+};
+
+struct ClientStats
+{
+    ClientKind kind = ClientKind::STREAM;
+    bool connected = false;
+    bool http_ok = false;
+    std::string content_type;
+    double ttfb_ms = -1.0;        // connect start -> first response byte
+    double first_audio_ms = -1.0; // connect start -> first payload byte
+    uint64_t bytes = 0;           // payload bytes (de-chunked)
+    uint64_t messages = 0;        // MP3 frames / PCM blocks / FFT responses / WS messages
+    uint64_t stalls = 0;
+    double longest_gap_ms = 0.0;
+    uint64_t framing_errors = 0;
+    std::string error;
+};
+
+static std::atomic<bool> g_stop(false);
+
+static double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static int connect_to(const std::string &host, int port, int recv_timeout_ms)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res)
+    {
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0)
+    {
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    if (connect(fd, res->ai_addr, res->ai_addrlen) < 0)
+    {
+        close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+    freeaddrinfo(res);
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct timeval tv;
+    tv.tv_sec = recv_timeout_ms / 1000;
+    tv.tv_usec = (recv_timeout_ms % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static bool send_all(int fd, const std::string &data)
+{
+    size_t off = 0;
+    while (off < data.size())
+    {
+        ssize_t n = send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        off += n;
+    }
+    return true;
+}
+
+static std::string header_value(const std::string &headers, const std::string &name)
+{
+    std::string lower = headers;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    std::string key = "\r\n" + name + ":";
+    size_t pos = lower.find(key);
+    if (pos == std::string::npos)
+        return "";
+    pos += key.size();
+    size_t end = headers.find("\r\n", pos);
+    std::string value = headers.substr(pos, end - pos);
+    value.erase(0, value.find_first_not_of(" \t"));
+    return value;
+}
+
+// Incremental validator for the MP3 elementary stream produced by LAME in
+// RADIO/DJ mode. Walks frame headers and counts sync losses.
+class Mp3FrameValidator
+{
+public:
+    void feed(const uint8_t *data, size_t size, ClientStats &stats)
+    {
+        pending.insert(pending.end(), data, data + size);
+
+        size_t pos = 0;
+        while (pos + 4 <= pending.size())
+        {
+            size_t frame_len = frame_length(&pending[pos]);
+            if (frame_len == 0)
+            {
+                // Lost sync: skip to the next candidate sync word
+                if (synced)
+                {
+                    stats.framing_errors++;
+                    synced = false;
+                }
+                pos++;
+                continue;
+            }
+            if (pos + frame_len > pending.size())
+                break;
+
+            synced = true;
+            stats.messages++;
+            pos += frame_len;
+        }
+        pending.erase(pending.begin(), pending.begin() + pos);
+    }
+
+private:
+    std::vector<uint8_t> pending;
+    bool synced = true;
+
+    static size_t frame_length(const uint8_t *h)
+    {
+        if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0)
+            return 0;
+
+        int version_bits = (h[1] >> 3) & 0x03; // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+        int layer_bits = (h[1] >> 1) & 0x03;   // 1 = Layer III
+        int bitrate_idx = (h[2] >> 4) & 0x0F;
+        int rate_idx = (h[2] >> 2) & 0x03;
+        int padding = (h[2] >> 1) & 0x01;
+
+        if (version_bits == 1 || layer_bits != 1 || bitrate_idx == 0 || bitrate_idx == 15 || rate_idx == 3)
+            return 0;
+
+        static const int bitrates_v1[] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320};
+        static const int bitrates_v2[] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160};
+        static const int rates_v1[] = {44100, 48000, 32000};
+
+        bool mpeg1 = version_bits == 3;
+        int bitrate = (mpeg1 ? bitrates_v1 : bitrates_v2)[bitrate_idx] * 1000;
+        int sample_rate = rates_v1[rate_idx] >> (mpeg1 ? 0 : (version_bits == 2 ? 1 : 2));
+        int coefficient = mpeg1 ? 144 : 72;
+
+        return static_cast<size_t>(coefficient * bitrate / sample_rate + padding);
+    }
+};
+
+// Decodes HTTP/1.1 chunked transfer encoding incrementally.
+class ChunkedDecoder
+{
+public:
+    // Returns false on a malformed chunk header or trailer.
+    bool feed(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+    {
+        buffer.insert(buffer.end(), data, data + size);
+        size_t pos = 0;
+
+        while (pos < buffer.size())
+        {
+            if (remaining == 0)
+            {
+                if (expect_crlf)
+                {
+                    if (buffer.size() - pos < 2)
+                        break;
+                    if (buffer[pos] != '\r' || buffer[pos + 1] != '\n')
+                        return false;
+                    pos += 2;
+                    expect_crlf = false;
+                    continue;
+                }
+
+                auto line_end = std::search(buffer.begin() + pos, buffer.end(), crlf, crlf + 2);
+                if (line_end == buffer.end())
+                {
+                    if (buffer.size() - pos > 32)
+                        return false; // No sane chunk-size line is this long
+                    break;
+                }
+
+                std::string size_line(buffer.begin() + pos, line_end);
+                char *end = nullptr;
+                unsigned long chunk = std::strtoul(size_line.c_str(), &end, 16);
+                if (end == size_line.c_str())
+                    return false;
+
+                pos = (line_end - buffer.begin()) + 2;
+                if (chunk == 0)
+                {
+                    finished = true;
+                    break;
+                }
+                remaining = chunk;
+                continue;
+            }
+
+            size_t take = std::min(remaining, buffer.size() - pos);
+            out.insert(out.end(), buffer.begin() + pos, buffer.begin() + pos + take);
+            pos += take;
+            remaining -= take;
+            if (remaining == 0)
+                expect_crlf = true;
+        }
+
+        buffer.erase(buffer.begin(), buffer.begin() + pos);
+        return true;
+    }
+
+    bool is_finished() const { return finished; }
+
+private:
+    static constexpr char crlf[2] = {'\r', '\n'};
+    std::vector<uint8_t> buffer;
+    size_t remaining = 0;
+    bool expect_crlf = false;
+    bool finished = false;
+};
+
+constexpr char ChunkedDecoder::crlf[2];
+
+// Reads until the end of the HTTP response headers. Any body bytes that
+// arrived with the headers are returned in `body`.
+static bool read_headers(int fd, Clock::time_point start, ClientStats &stats,
+                         std::string &headers, std::vector<uint8_t> &body)
+{
+    char buf[4096];
+    while (!g_stop)
+    {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+        {
+            stats.error = n == 0 ? "connection closed before headers" : "timeout waiting for headers";
+            return false;
+        }
+        if (stats.ttfb_ms < 0)
+            stats.ttfb_ms = ms_since(start);
+
+        headers.append(buf, n);
+        size_t end = headers.find("\r\n\r\n");
+        if (end != std::string::npos)
+        {
+            body.assign(headers.begin() + end + 4, headers.end());
+            headers.resize(end + 2);
+            stats.http_ok = headers.compare(0, 12, "HTTP/1.1 200") == 0 || headers.compare(0, 12, "HTTP/1.0 200") == 0;
+            stats.content_type = header_value(headers, "content-type");
+            return true;
+        }
+        if (headers.size() > 65536)
+        {
+            stats.error = "oversized response headers";
+            return false;
+        }
+    }
+    return false;
+}
+
+static void run_stream_client(const LoadOptions &opts, ClientStats &stats)
+{
+    Clock::time_point start = Clock::now();
+    int fd = connect_to(opts.host, opts.port, 1000);
+    if (fd < 0)
+    {
+        stats.error = "connect failed";
+        return;
+    }
+    stats.connected = true;
+
+    if (!send_all(fd, "GET /stream HTTP/1.1\r\nHost: " + opts.host + "\r\nIcy-MetaData: 0\r\n\r\n"))
+    {
+        stats.error = "send failed";
+        close(fd);
+        return;
+    }
+
+    std::string headers;
+    std::vector<uint8_t> initial;
+    if (!read_headers(fd, start, stats, headers, initial) || !stats.http_ok)
+    {
+        if (stats.error.empty())
+            stats.error = "unexpected status: " + headers.substr(0, headers.find("\r\n"));
+        close(fd);
+        return;
+    }
+
+    bool chunked = header_value(headers, "transfer-encoding").find("chunked") != std::string::npos;
+    bool is_wav = stats.content_type.find("audio/wav") != std::string::npos;
+    bool is_mp3 = stats.content_type.find("audio/mpeg") != std::string::npos;
+    if (!is_wav && !is_mp3)
+    {
+        stats.error = "unexpected content type: " + stats.content_type;
+        close(fd);
+        return;
+    }
+
+    ChunkedDecoder dechunk;
+    Mp3FrameValidator mp3;
+    std::vector<uint8_t> wav_header;
+    bool wav_header_ok = false;
+    uint64_t pcm_bytes = 0;
+
+    auto consume = [&](const uint8_t *data, size_t size)
+    {
+        std::vector<uint8_t> payload;
+        if (chunked)
+        {
+            if (!dechunk.feed(data, size, payload))
+            {
+                stats.framing_errors++;
+                return false;
+            }
+        }
+        else
+        {
+            payload.assign(data, data + size);
+        }
+        if (payload.empty())
+            return true;
+
+        if (stats.first_audio_ms < 0)
+            stats.first_audio_ms = ms_since(start);
+        stats.bytes += payload.size();
+
+        if (is_mp3)
+        {
+            mp3.feed(payload.data(), payload.size(), stats);
+            return true;
+        }
+
+        // WAV: validate the 44-byte header once, then PCM block alignment
+        size_t off = 0;
+        if (!wav_header_ok)
+        {
+            size_t need = 44 - wav_header.size();
+            size_t take = std::min(need, payload.size());
+            wav_header.insert(wav_header.end(), payload.begin(), payload.begin() + take);
+            off = take;
+            if (wav_header.size() == 44)
+            {
+                uint16_t channels, block_align, bits;
+                memcpy(&channels, &wav_header[22], 2);
+                memcpy(&block_align, &wav_header[32], 2);
+                memcpy(&bits, &wav_header[34], 2);
+                if (memcmp(&wav_header[0], "RIFF", 4) != 0 || memcmp(&wav_header[8], "WAVE", 4) != 0 ||
+                    memcmp(&wav_header[36], "data", 4) != 0 || channels != 2 || bits != 16 || block_align != 4)
+                {
+                    stats.framing_errors++;
+                    stats.error = "invalid WAV header";
+                    return false;
+                }
+                wav_header_ok = true;
+            }
+        }
+        pcm_bytes += payload.size() - off;
+        stats.messages = pcm_bytes / 4; // Stereo 16-bit frames
+        return true;
+    };
+
+    if (!initial.empty() && !consume(initial.data(), initial.size()))
+    {
+        close(fd);
+        return;
+    }
+
+    Clock::time_point deadline = start + std::chrono::seconds(opts.duration_s);
+    Clock::time_point last_data = Clock::now();
+    uint8_t buf[16384];
+
+    while (!g_stop && Clock::now() < deadline)
+    {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        double gap = ms_since(last_data);
+        if (n > 0)
+        {
+            if (gap > opts.stall_ms)
+                stats.stalls++;
+            stats.longest_gap_ms = std::max(stats.longest_gap_ms, gap);
+            last_data = Clock::now();
+            if (!consume(buf, n))
+                break;
+            if (chunked && dechunk.is_finished())
+                break; // Server ended the stream (e.g. track change)
+        }
+        else if (n == 0)
+        {
+            break;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            // Receive timeout; the stall is accounted when data resumes or at the end
+            continue;
+        }
+        else
+        {
+            stats.error = std::string("recv: ") + strerror(errno);
+            break;
+        }
+    }
+
+    double tail_gap = ms_since(last_data);
+    if (tail_gap > opts.stall_ms)
+        stats.stalls++;
+    stats.longest_gap_ms = std::max(stats.longest_gap_ms, tail_gap);
+
+    // A WAV stream must end on a whole stereo frame boundary
+    if (is_wav && wav_header_ok && pcm_bytes % 4 != 0 && g_stop)
+        stats.framing_errors++;
+
+    close(fd);
+}
+
+static void run_fft_client(const LoadOptions &opts, ClientStats &stats)
+{
+    Clock::time_point run_start = Clock::now();
+    Clock::time_point deadline = run_start + std::chrono::seconds(opts.duration_s);
+    double ttfb_sum = 0.0;
+
+    while (!g_stop && Clock::now() < deadline)
+    {
+        Clock::time_point start = Clock::now();
+        int fd = connect_to(opts.host, opts.port, 1000);
+        if (fd < 0)
+        {
+            stats.error = "connect failed";
+            std::this_thread::sleep_for(std::chrono::milliseconds(opts.fft_interval_ms));
+            continue;
+        }
+        stats.connected = true;
+
+        send_all(fd, "GET /api/fft HTTP/1.1\r\nHost: " + opts.host + "\r\nConnection: close\r\n\r\n");
+
+        ClientStats one;
+        std::string headers;
+        std::vector<uint8_t> body;
+        if (read_headers(fd, start, one, headers, body) && one.http_ok)
+        {
+            char buf[4096];
+            ssize_t n;
+            while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+                body.insert(body.end(), buf, buf + n);
+
+            std::string json(body.begin(), body.end());
+            size_t declared = std::strtoul(header_value(headers, "content-length").c_str(), nullptr, 10);
+            if (json.size() != declared || json.find("\"magnitudes\":[") == std::string::npos || json.back() != '}')
+                stats.framing_errors++;
+
+            double latency = ms_since(start);
+            if (latency > opts.stall_ms)
+                stats.stalls++;
+            stats.longest_gap_ms = std::max(stats.longest_gap_ms, latency);
+            ttfb_sum += one.ttfb_ms;
+            stats.http_ok = true;
+            stats.bytes += body.size();
+            stats.messages++;
+        }
+        else
+        {
+            stats.error = one.error.empty() ? "bad response" : one.error;
+        }
+        close(fd);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(opts.fft_interval_ms));
+    }
+
+    if (stats.messages > 0)
+        stats.ttfb_ms = ttfb_sum / stats.messages;
+}
+
+static std::string base64_encode(const uint8_t *data, size_t size)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < size; i += 3)
+    {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < size)
+            v |= data[i + 1] << 8;
+        if (i + 2 < size)
+            v |= data[i + 2];
+        out += table[(v >> 18) & 0x3F];
+        out += table[(v >> 12) & 0x3F];
+        out += i + 1 < size ? table[(v >> 6) & 0x3F] : '=';
+        out += i + 2 < size ? table[v & 0x3F] : '=';
+    }
+    return out;
+}
+
+static void run_ws_client(const LoadOptions &opts, ClientStats &stats)
+{
+    Clock::time_point start = Clock::now();
+    int port = opts.ws_port > 0 ? opts.ws_port : opts.port + 1;
+    int fd = connect_to(opts.host, port, 1000);
+    if (fd < 0)
+    {
+        stats.error = "connect failed (server built without HAS_WEBSOCKETPP?)";
+        return;
+    }
+    stats.connected = true;
+
+    uint8_t nonce[16];
+    std::random_device rd;
+    for (uint8_t &b : nonce)
+        b = static_cast<uint8_t>(rd());
+
+    std::stringstream req;
+    req << "GET /ws/fft HTTP/1.1\r\n";
+    req << "Host: " << opts.host << ":" << port << "\r\n";
+    req << "Upgrade: websocket\r\n";
+    req << "Connection: Upgrade\r\n";
+    req << "Sec-WebSocket-Key: " << base64_encode(nonce, sizeof(nonce)) << "\r\n";
+    req << "Sec-WebSocket-Version: 13\r\n\r\n";
+    send_all(fd, req.str());
+
+    std::string headers;
+    std::vector<uint8_t> pending;
+    if (!read_headers(fd, start, stats, headers, pending) || headers.size() < 12 || headers.compare(9, 3, "101") != 0)
+    {
+        if (stats.error.empty())
+            stats.error = "websocket upgrade rejected";
+        close(fd);
+        return;
+    }
+    stats.http_ok = true;
+
+    Clock::time_point deadline = start + std::chrono::seconds(opts.duration_s);
+    Clock::time_point last_data = Clock::now();
+    uint8_t buf[8192];
+
+    while (!g_stop && Clock::now() < deadline)
+    {
+        // Parse as many complete (unmasked, server-to-client) frames as are buffered
+        while (pending.size() >= 2)
+        {
+            uint8_t opcode = pending[0] & 0x0F;
+            bool masked = (pending[1] & 0x80) != 0;
+            uint64_t len = pending[1] & 0x7F;
+            size_t hdr = 2;
+            if (len == 126)
+            {
+                if (pending.size() < 4)
+                    break;
+                len = (pending[2] << 8) | pending[3];
+                hdr = 4;
+            }
+            else if (len == 127)
+            {
+                if (pending.size() < 10)
+                    break;
+                len = 0;
+                for (int i = 0; i < 8; ++i)
+                    len = (len << 8) | pending[2 + i];
+                hdr = 10;
+            }
+            if (masked || len > (1u << 24))
+            {
+                stats.framing_errors++;
+                pending.clear();
+                break;
+            }
+            if (pending.size() < hdr + len)
+                break;
+
+            if (opcode == 0x1)
+            {
+                std::string text(pending.begin() + hdr, pending.begin() + hdr + len);
+                if (text.find("\"magnitudes\":[") == std::string::npos)
+                    stats.framing_errors++;
+                if (stats.first_audio_ms < 0)
+                    stats.first_audio_ms = ms_since(start);
+                stats.messages++;
+                stats.bytes += len;
+            }
+            else if (opcode == 0x8)
+            {
+                deadline = Clock::now(); // Server closed
+            }
+            pending.erase(pending.begin(), pending.begin() + hdr + len);
+        }
+
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0)
+        {
+            double gap = ms_since(last_data);
+            if (gap > opts.stall_ms)
+                stats.stalls++;
+            stats.longest_gap_ms = std::max(stats.longest_gap_ms, gap);
+            last_data = Clock::now();
+            pending.insert(pending.end(), buf, buf + n);
+        }
+        else if (n == 0)
+        {
+            break;
+        }
+    }
+
+    close(fd);
+}
+
+// Server-side CPU accounting from /proc/<pid>/stat (utime + stime, in ticks)
+static bool read_process_ticks(int pid, uint64_t &ticks)
+{
+#ifdef __linux__
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    if (!stat.is_open())
+        return false;
+
+    std::string content((std::istreambuf_iterator<char>(stat)), std::istreambuf_iterator<char>());
+    size_t paren = content.rfind(')');
+    if (paren == std::string::npos)
+        return false;
+
+    std::istringstream fields(content.substr(paren + 2));
+    std::string field;
+    uint64_t utime = 0, stime = 0;
+    // Fields after the command name start at index 3 (state); utime/stime are 14/15
+    for (int i = 3; i <= 15 && fields >> field; ++i)
+    {
+        if (i == 14)
+            utime = std::stoull(field);
+        else if (i == 15)
+            stime = std::stoull(field);
+    }
+    ticks = utime + stime;
+    return true;
+#else
+    return false;
+#endif
+}
+
+static long read_process_rss_kb(int pid)
+{
+#ifdef __linux__
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+            return std::strtol(line.c_str() + 6, nullptr, 10);
+    }
+#endif
+    return -1;
+}
+
+static const char *kind_name(ClientKind kind)
+{
+    switch (kind)
+    {
+    case ClientKind::STREAM:
+        return "stream";
+    case ClientKind::FFT:
+        return "fft";
+    case ClientKind::WEBSOCKET:
+        return "websocket";
+    }
+    return "unknown";
+}
+
+struct KindSummary
+{
+    int clients = 0;
+    int connected = 0;
+    int failed = 0;
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    uint64_t stalls = 0;
+    uint64_t framing_errors = 0;
+    std::vector<double> ttfb;
+    double longest_gap_ms = 0.0;
+    std::string first_error;
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t idx = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[idx];
+}
+
+static void print_usage(const char *argv0)
+{
+    std::cout << "Usage: " << argv0 << " [options]\n"
+              << "  --host HOST          Server host (default 127.0.0.1)\n"
+              << "  --port PORT          Web port (default 8080)\n"
+              << "  --ws-port PORT       WebSocket port (default web port + 1)\n"
+              << "  --streams N          Concurrent /stream listeners (default 10)\n"
+              << "  --fft N              Concurrent /api/fft pollers (default 5)\n"
+              << "  --ws N               Concurrent /ws/fft WebSocket clients (default 0)\n"
+              << "  --duration SECONDS   Test duration (default 10)\n"
+              << "  --stall-ms MS        Inter-arrival gap counted as a stall (default 250)\n"
+              << "  --server-pid PID     Sample server CPU/RSS from /proc\n"
+              << "  --json               Emit a JSON report instead of text\n";
+}
+
+int main(int argc, char **argv)
+{
+    LoadOptions opts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto next_int = [&](int &out)
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << arg << std::endl;
+                exit(2);
+            }
+            out = std::atoi(argv[++i]);
+        };
+
+        if (arg == "--host" && i + 1 < argc)
+            opts.host = argv[++i];
+        else if (arg == "--port")
+            next_int(opts.port);
+        else if (arg == "--ws-port")
+            next_int(opts.ws_port);
+        else if (arg == "--streams")
+            next_int(opts.streams);
+        else if (arg == "--fft")
+            next_int(opts.fft_clients);
+        else if (arg == "--ws")
+            next_int(opts.ws_clients);
+        else if (arg == "--duration")
+            next_int(opts.duration_s);
+        else if (arg == "--stall-ms")
+            next_int(opts.stall_ms);
+        else if (arg == "--server-pid")
+            next_int(opts.server_pid);
+        else if (arg == "--json")
+            opts.json = true;
+        else
+        {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+
+    std::vector<ClientStats> stats;
+    auto add_clients = [&stats](ClientKind kind, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            stats.emplace_back();
+            stats.back().kind = kind;
+        }
+    };
+    add_clients(ClientKind::STREAM, opts.streams);
+    add_clients(ClientKind::FFT, opts.fft_clients);
+    add_clients(ClientKind::WEBSOCKET, opts.ws_clients);
+
+    uint64_t ticks_before = 0, ticks_after = 0;
+    bool have_cpu = opts.server_pid > 0 && read_process_ticks(opts.server_pid, ticks_before);
+
+    if (!opts.json)
+    {
+        std::cout << "Load test: " << opts.streams << " stream, " << opts.fft_clients << " fft, "
+                  << opts.ws_clients << " websocket clients against " << opts.host << ":" << opts.port
+                  << " for " << opts.duration_s << "s" << std::endl;
+    }
+
+    Clock::time_point run_start = Clock::now();
+    std::vector<std::thread> threads;
+    threads.reserve(stats.size());
+    for (auto &s : stats)
+    {
+        threads.emplace_back([&opts, &s]()
+                             {
+            switch (s.kind) {
+                case ClientKind::STREAM: run_stream_client(opts, s); break;
+                case ClientKind::FFT: run_fft_client(opts, s); break;
+                case ClientKind::WEBSOCKET: run_ws_client(opts, s); break;
+            } });
+    }
+    for (auto &t : threads)
+        t.join();
+    double elapsed_s = ms_since(run_start) / 1000.0;
+
+    double server_cpu_pct = -1.0;
+    long server_rss_kb = -1;
+    if (have_cpu && read_process_ticks(opts.server_pid, ticks_after))
+    {
+        server_cpu_pct = 100.0 * (ticks_after - ticks_before) / sysconf(_SC_CLK_TCK) / elapsed_s;
+        server_rss_kb = read_process_rss_kb(opts.server_pid);
+    }
+
+    KindSummary summaries[3];
+    for (const auto &s : stats)
+    {
+        KindSummary &k = summaries[static_cast<int>(s.kind)];
+        k.clients++;
+        if (s.connected && s.http_ok)
+            k.connected++;
+        if (!s.error.empty())
+        {
+            k.failed++;
+            if (k.first_error.empty())
+                k.first_error = s.error;
+        }
+        k.bytes += s.bytes;
+        k.messages += s.messages;
+        k.stalls += s.stalls;
+        k.framing_errors += s.framing_errors;
+        k.longest_gap_ms = std::max(k.longest_gap_ms, s.longest_gap_ms);
+        if (s.ttfb_ms >= 0)
+            k.ttfb.push_back(s.ttfb_ms);
+    }
+
+    uint64_t total_framing_errors = 0;
+    int total_failed = 0;
+
+    if (opts.json)
+    {
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "{\"duration_s\":" << elapsed_s << ",\"clients\":{";
+        for (int i = 0; i < 3; ++i)
+        {
+            const KindSummary &k = summaries[i];
+            if (i > 0)
+                std::cout << ",";
+            std::cout << "\"" << kind_name(static_cast<ClientKind>(i)) << "\":{"
+                      << "\"clients\":" << k.clients << ","
+                      << "\"connected\":" << k.connected << ","
+                      << "\"failed\":" << k.failed << ","
+                      << "\"bytes\":" << k.bytes << ","
+                      << "\"throughput_kbps\":" << (k.bytes * 8.0 / 1000.0 / elapsed_s) << ","
+                      << "\"messages\":" << k.messages << ","
+                      << "\"ttfb_ms_p50\":" << percentile(k.ttfb, 0.5) << ","
+                      << "\"ttfb_ms_p99\":" << percentile(k.ttfb, 0.99) << ","
+                      << "\"stalls\":" << k.stalls << ","
+                      << "\"longest_gap_ms\":" << k.longest_gap_ms << ","
+                      << "\"framing_errors\":" << k.framing_errors << "}";
+            total_framing_errors += k.framing_errors;
+            total_failed += k.failed;
+        }
+        std::cout << "},\"server\":{\"cpu_percent\":" << server_cpu_pct
+                  << ",\"rss_kb\":" << server_rss_kb << "}}" << std::endl;
+    }
+    else
+    {
+        std::cout << std::fixed << std::setprecision(1);
+        for (int i = 0; i < 3; ++i)
+        {
+            const KindSummary &k = summaries[i];
+            if (k.clients == 0)
+                continue;
+            std::cout << "\n[" << kind_name(static_cast<ClientKind>(i)) << "] "
+                      << k.connected << "/" << k.clients << " connected, " << k.failed << " failed\n"
+                      << "  throughput:     " << (k.bytes * 8.0 / 1000.0 / elapsed_s) << " kbps total, "
+                      << (k.clients ? k.bytes * 8.0 / 1000.0 / elapsed_s / k.clients : 0.0) << " kbps/client\n"
+                      << "  messages:       " << k.messages << "\n"
+                      << "  ttfb:           p50 " << percentile(k.ttfb, 0.5) << " ms, p99 "
+                      << percentile(k.ttfb, 0.99) << " ms\n"
+                      << "  stalls:         " << k.stalls << " (> " << opts.stall_ms << " ms), longest gap "
+                      << k.longest_gap_ms << " ms\n"
+                      << "  framing errors: " << k.framing_errors << "\n";
+            if (!k.first_error.empty())
+                std::cout << "  first error:    " << k.first_error << "\n";
+            total_framing_errors += k.framing_errors;
+            total_failed += k.failed;
+        }
+        if (server_cpu_pct >= 0)
+        {
+            std::cout << "\n[server] pid " << opts.server_pid << ": " << server_cpu_pct << "% CPU, "
+                      << server_rss_kb << " kB RSS\n";
+        }
+        std::cout << std::endl;
+    }
+
+    return (total_framing_errors > 0 || total_failed > 0) ? 1 : 0;
+}